@@ -0,0 +1,257 @@
+/* Banc d'essai de bout en bout : chaque script de charge est exécuté RUNS
+ * fois par minishell, bash --posix et dash (ceux qui sont installés).
+ * Pour chaque couple script/shell : médiane, p99 et minimum du temps
+ * écoulé, RSS maximale du fils (rusage de wait4) et, si le script déclare
+ * « # bench-bytes: N », le débit correspondant à la médiane.
+ *
+ * Un tableau lisible est écrit sur la sortie d'erreur, le JSON sur la
+ * sortie standard ou dans le fichier de -o.
+ *
+ * Usage : bench [-n RUNS] [-o FILE] [-m MINISHELL] SCRIPT... */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define DEFAULT_RUNS 10
+#define BYTES_TAG "# bench-bytes:"
+
+struct shell {
+    const char *label;
+    const char *program;
+    const char *option;     /* option avant le script, NULL sinon */
+};
+
+struct result {
+    double median_ms;
+    double p99_ms;
+    double min_ms;
+    long max_rss_kb;
+    int status;             /* premier code de sortie non nul, 0 sinon */
+};
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Vrai si program est un chemin exécutable ou se trouve dans PATH */
+static int find_program(const char *program)
+{
+    if (strchr(program, '/'))
+        return access(program, X_OK) == 0;
+
+    const char *path = getenv("PATH");
+    char candidate[4096];
+    while (path && *path)
+    {
+        size_t len = strcspn(path, ":");
+        snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)len, path, program);
+        if (len > 0 && access(candidate, X_OK) == 0)
+            return 1;
+        path += len + (path[len] == ':');
+    }
+    return 0;
+}
+
+/* Octets traités par le script, lus dans son en-tête ; 0 si absent */
+static long long script_bytes(const char *script)
+{
+    FILE *file = fopen(script, "r");
+    if (!file)
+        return 0;
+
+    char line[256];
+    long long bytes = 0;
+    while (fgets(line, sizeof(line), file) && line[0] == '#')
+    {
+        if (strncmp(line, BYTES_TAG, strlen(BYTES_TAG)) == 0)
+            bytes = atoll(line + strlen(BYTES_TAG));
+    }
+    fclose(file);
+    return bytes;
+}
+
+/* Nom du script sans répertoire ni extension */
+static void script_name(const char *script, char *name, size_t size)
+{
+    const char *base = strrchr(script, '/');
+    base = base ? base + 1 : script;
+    size_t len = strcspn(base, ".");
+    snprintf(name, size, "%.*s", (int)len, base);
+}
+
+/* Une exécution, sortie standard vers /dev/null. Renvoie la durée en ms. */
+static double run_once(const struct shell *shell, const char *script, int *status,
+                       long *max_rss_kb)
+{
+    double start = now_ms();
+    pid_t pid = fork();
+    if (pid == -1)
+        return -1;
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        if (null != -1)
+            dup2(null, STDOUT_FILENO);
+        if (shell->option)
+            execlp(shell->program, shell->program, shell->option, script, (char *)NULL);
+        else
+            execlp(shell->program, shell->program, script, (char *)NULL);
+        _exit(127);
+    }
+
+    int wstatus;
+    struct rusage usage;
+    if (wait4(pid, &wstatus, 0, &usage) == -1)
+        return -1;
+    double elapsed = now_ms() - start;
+
+    *status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 128 + WTERMSIG(wstatus);
+    if (usage.ru_maxrss > *max_rss_kb)
+        *max_rss_kb = usage.ru_maxrss;
+    return elapsed;
+}
+
+static int measure(const struct shell *shell, const char *script, int runs,
+                   double *times, struct result *result)
+{
+    int status = 0;
+    long max_rss_kb = 0;
+
+    result->status = 0;
+    if (run_once(shell, script, &status, &max_rss_kb) < 0)
+        return -1;
+
+    max_rss_kb = 0;
+    for (int i = 0; i < runs; i++)
+    {
+        times[i] = run_once(shell, script, &status, &max_rss_kb);
+        if (times[i] < 0)
+            return -1;
+        if (status && !result->status)
+            result->status = status;
+    }
+
+    qsort(times, runs, sizeof(double), compare_double);
+    size_t p99 = (size_t)(0.99 * runs + 0.999999);
+    result->median_ms = times[runs / 2];
+    result->p99_ms = times[p99 > 0 ? p99 - 1 : 0];
+    result->min_ms = times[0];
+    result->max_rss_kb = max_rss_kb;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int runs = DEFAULT_RUNS;
+    const char *output = NULL;
+    const char *minishell = "./minishell";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:o:m:")) != -1)
+    {
+        if (opt == 'n' && atoi(optarg) > 0)
+            runs = atoi(optarg);
+        else if (opt == 'o')
+            output = optarg;
+        else if (opt == 'm')
+            minishell = optarg;
+        else
+            optind = argc + 1;
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "usage: %s [-n RUNS] [-o FILE] [-m MINISHELL] SCRIPT...\n", argv[0]);
+        return 2;
+    }
+
+    struct shell candidates[] = {
+        { "minishell", minishell, NULL },
+        { "bash --posix", "bash", "--posix" },
+        { "dash", "dash", NULL },
+    };
+    struct shell shells[3];
+    size_t shell_count = 0;
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (find_program(candidates[i].program))
+            shells[shell_count++] = candidates[i];
+        else
+            fprintf(stderr, "bench: %s not found, skipped\n", candidates[i].program);
+    }
+
+    FILE *json = output ? fopen(output, "w") : stdout;
+    double *times = malloc(sizeof(double) * runs);
+    if (!json || !times)
+    {
+        perror("bench");
+        return 1;
+    }
+
+    fprintf(stderr, "%-14s %-14s %10s %10s %10s %10s %9s\n", "workload", "shell",
+            "median_ms", "p99_ms", "min_ms", "rss_kb", "MB/s");
+    fprintf(json, "{\n  \"runs\": %d,\n  \"results\": [", runs);
+
+    int failed = 0;
+    const char *separator = "";
+    for (int w = optind; w < argc; w++)
+    {
+        char name[256];
+        script_name(argv[w], name, sizeof(name));
+        long long bytes = script_bytes(argv[w]);
+
+        for (size_t s = 0; s < shell_count; s++)
+        {
+            struct result result;
+            if (measure(&shells[s], argv[w], runs, times, &result) == -1)
+            {
+                perror("bench");
+                failed = 1;
+                continue;
+            }
+            failed |= result.status != 0;
+
+            double rate = bytes ? bytes / (result.median_ms * 1e3) : 0;
+            fprintf(stderr, "%-14s %-14s %10.2f %10.2f %10.2f %10ld ", name,
+                    shells[s].label, result.median_ms, result.p99_ms, result.min_ms,
+                    result.max_rss_kb);
+            if (bytes)
+                fprintf(stderr, "%9.1f", rate);
+            else
+                fprintf(stderr, "%9s", "-");
+            fprintf(stderr, result.status ? "  exit %d\n" : "\n", result.status);
+
+            fprintf(json, "%s\n    { \"workload\": \"%s\", \"shell\": \"%s\", "
+                    "\"status\": %d, \"median_ms\": %.3f, \"p99_ms\": %.3f, "
+                    "\"min_ms\": %.3f, \"max_rss_kb\": %ld", separator, name,
+                    shells[s].label, result.status, result.median_ms, result.p99_ms,
+                    result.min_ms, result.max_rss_kb);
+            if (bytes)
+                fprintf(json, ", \"bytes\": %lld, \"mb_per_s\": %.1f", bytes, rate);
+            fprintf(json, " }");
+            separator = ",";
+        }
+    }
+
+    fprintf(json, "\n  ]\n}\n");
+    if (json != stdout)
+        fclose(json);
+    free(times);
+    return failed;
+}
@@ -0,0 +1,271 @@
+/* Microbenchmark du lexer et du parser, liés seuls depuis src/lexer et
+ * src/parser. Chaque corpus synthétique est généré en deux tailles : un
+ * débit qui baisse sur la grande taille trahit un coût non linéaire.
+ *
+ * Pour chaque corpus : tokens/s et Mo/s de lexer_next_token seul, Mo/s et
+ * nœuds/s de parse_input (lexing compris), allocations par ligne pendant
+ * l'analyse. Les allocations sont comptées en enveloppant malloc, calloc,
+ * realloc et strdup à l'édition de liens (-Wl,--wrap) : seuls les appels
+ * faits par le code du shell sont vus.
+ *
+ * Usage : parse [-s MIB] [-r REPEAT] */
+
+#include "../src/lexer/lexer.h"
+#include "../src/parser/parser.h"
+#include <time.h>
+
+#define DEFAULT_SIZE_MIB 1
+#define DEFAULT_REPEAT 3
+#define LARGE_FACTOR 8
+
+static unsigned long allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+char *__real_strdup(const char *str);
+
+void *__wrap_malloc(size_t size)
+{
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *str)
+{
+    allocations++;
+    return __real_strdup(str);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Générateurs : une ligne du corpus par appel, terminée par '\n' */
+
+static void gen_long_words(struct strbuf *out, size_t line)
+{
+    strbuf_append(out, "echo ", 5);
+    for (size_t i = 0; i < 2000; i++)
+        strbuf_putc(out, 'a' + (line + i) % 26);
+    strbuf_append(out, " \"quoted ", 9);
+    for (size_t i = 0; i < 1000; i++)
+        strbuf_putc(out, i % 50 ? 'q' : ' ');
+    strbuf_append(out, " $x\" 'single ", 13);
+    for (size_t i = 0; i < 1000; i++)
+        strbuf_putc(out, 's');
+    strbuf_append(out, "' tail\\ escaped\n", 16);
+}
+
+static void gen_operators(struct strbuf *out, size_t line)
+{
+    static const char *ops[] = { "&&", "||", ";", "|" };
+
+    for (size_t i = 0; i < 100; i++)
+    {
+        if (i > 0)
+            strbuf_append(out, ops[(line + i) % 4], strlen(ops[(line + i) % 4]));
+        strbuf_putc(out, 'a' + i % 26);
+    }
+    strbuf_putc(out, '\n');
+}
+
+static void gen_pipelines(struct strbuf *out, size_t line)
+{
+    (void)line;
+    strbuf_append(out, "cat", 3);
+    for (size_t i = 1; i < 200; i++)
+        strbuf_append(out, " | cat", 6);
+    strbuf_putc(out, '\n');
+}
+
+static void gen_redirections(struct strbuf *out, size_t line)
+{
+    static const char *ops[] = { " <in", " >out", " 2>err", " >>log" };
+    char number[32];
+
+    strbuf_append(out, "cmd arg", 7);
+    for (size_t i = 0; i < 100; i++)
+    {
+        const char *op = ops[(line + i) % 4];
+        int len = snprintf(number, sizeof(number), "%zu", i);
+        strbuf_append(out, op, strlen(op));
+        strbuf_append(out, number, len);
+    }
+    strbuf_putc(out, '\n');
+}
+
+struct corpus {
+    const char *name;
+    void (*generate)(struct strbuf *out, size_t line);
+};
+
+static size_t generate(const struct corpus *corpus, size_t size, struct strbuf *out)
+{
+    size_t lines = 0;
+
+    out->len = 0;
+    while (out->len < size)
+        corpus->generate(out, lines++);
+    return lines;
+}
+
+static size_t count_nodes(const struct ast_node *node)
+{
+    if (!node)
+        return 0;
+    switch (node->type)
+    {
+        case NODE_PIPELINE:
+        case NODE_AND_OR:
+        case NODE_SEQUENCE:
+        case NODE_NOT:
+        case NODE_TIME:
+            return 1 + count_nodes(node->data.binary.left) +
+                   count_nodes(node->data.binary.right);
+        case NODE_COMMAND:
+            return 1 + node->data.command->redirections_count;
+        default:
+            return 1;
+    }
+}
+
+/* Lexing seul : renvoie le nombre de tokens */
+static size_t lex_all(char *input)
+{
+    struct lexer *lexer = lexer_init(input);
+    size_t tokens = 0;
+
+    for (;;)
+    {
+        struct token *token = lexer_next_token(lexer);
+        if (!token || token->type == TOKEN_EOF)
+        {
+            token_free(token);
+            break;
+        }
+        tokens++;
+        token_free(token);
+    }
+    lexer_free(lexer);
+    return tokens;
+}
+
+/* Analyse complète : renvoie le nombre de nœuds, -1 sur erreur */
+static long parse_all(char *input)
+{
+    struct lexer *lexer = lexer_init(input);
+    struct parser *parser = parser_init(lexer);
+    long nodes = 0;
+
+    while (parser->current_token->type != TOKEN_EOF)
+    {
+        struct ast_node *ast = parse_input(parser);
+        if (!ast && parser->has_error)
+        {
+            nodes = -1;
+            break;
+        }
+        nodes += count_nodes(ast);
+        ast_node_free(ast);
+    }
+    parser_free(parser);
+    lexer_free(lexer);
+    return nodes;
+}
+
+static int run_corpus(const struct corpus *corpus, size_t size, int repeat,
+                      struct strbuf *text)
+{
+    size_t lines = generate(corpus, size, text);
+    double mib = text->len / (1024.0 * 1024.0);
+    double lex_time = 0;
+    double parse_time = 0;
+    size_t tokens = 0;
+    long nodes = 0;
+    unsigned long parse_allocations = 0;
+
+    for (int i = 0; i < repeat; i++)
+    {
+        double start = now_s();
+        tokens = lex_all(text->data);
+        double elapsed = now_s() - start;
+        if (i == 0 || elapsed < lex_time)
+            lex_time = elapsed;
+
+        allocations = 0;
+        start = now_s();
+        nodes = parse_all(text->data);
+        elapsed = now_s() - start;
+        parse_allocations = allocations;
+        if (nodes < 0)
+        {
+            fprintf(stderr, "parse: syntax error in corpus %s\n", corpus->name);
+            return -1;
+        }
+        if (i == 0 || elapsed < parse_time)
+            parse_time = elapsed;
+    }
+
+    printf("%-14s %8.1f %8zu %12.0f %9.1f %9.1f %12.0f %11.1f\n", corpus->name, mib,
+           lines, tokens / lex_time, mib / lex_time, mib / parse_time, nodes / parse_time,
+           (double)parse_allocations / lines);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t size_mib = DEFAULT_SIZE_MIB;
+    int repeat = DEFAULT_REPEAT;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:")) != -1)
+    {
+        if (opt == 's' && atoi(optarg) > 0)
+            size_mib = atoi(optarg);
+        else if (opt == 'r' && atoi(optarg) > 0)
+            repeat = atoi(optarg);
+        else
+        {
+            fprintf(stderr, "usage: %s [-s MIB] [-r REPEAT]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    static const struct corpus corpora[] = {
+        { "long_words", gen_long_words },
+        { "operators", gen_operators },
+        { "pipelines", gen_pipelines },
+        { "redirections", gen_redirections },
+    };
+    struct strbuf text = { NULL, 0, 0 };
+    int ret = 0;
+
+    printf("%-14s %8s %8s %12s %9s %9s %12s %11s\n", "corpus", "MiB", "lines",
+           "tokens/s", "lex_MB/s", "parse_MB/s", "nodes/s", "allocs/line");
+    for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++)
+    {
+        size_t size = size_mib * 1024 * 1024;
+        if (run_corpus(&corpora[i], size, repeat, &text) == -1 ||
+            run_corpus(&corpora[i], LARGE_FACTOR * size, repeat, &text) == -1)
+            ret = 1;
+    }
+
+    strbuf_free(&text);
+    return ret;
+}
@@ -0,0 +1,211 @@
+/* Temps de démarrage : exec jusqu'à la sortie de « SHELL -c true », comparé
+ * à dash et bash --posix. Pour chaque shell : médiane et minimum du temps
+ * fork + execve + wait4, défauts de page (rusage du fils) et nombre
+ * d'appels système d'une exécution suivie avec ptrace.
+ *
+ * Usage : startup [-n RUNS] [-c COMMAND] [SHELL...]
+ * Sans SHELL : ./minishell, dash et bash --posix. */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define DEFAULT_RUNS 1000
+#define WARMUP_RUNS 20
+
+struct shell {
+    const char *label;
+    char *argv[5];
+};
+
+struct result {
+    double median_us;
+    double min_us;
+    double minflt;      /* moyenne par exécution */
+    double majflt;
+    long syscalls;      /* -1 si ptrace n'est pas disponible */
+};
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void exec_shell(const struct shell *shell)
+{
+    execvp(shell->argv[0], shell->argv);
+    _exit(127);
+}
+
+/* Une exécution : durée en microsecondes et rusage du fils */
+static double run_once(const struct shell *shell, struct rusage *usage)
+{
+    double start = now_us();
+    pid_t pid = fork();
+    if (pid == -1)
+        return -1;
+    if (pid == 0)
+        exec_shell(shell);
+
+    int status;
+    if (wait4(pid, &status, 0, usage) == -1 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) == 127)
+        return -1;
+    return now_us() - start;
+}
+
+/* Appels système après l'execve, comptés aux arrêts d'entrée de PTRACE_SYSCALL */
+static long count_syscalls(const struct shell *shell)
+{
+    pid_t pid = fork();
+    if (pid == -1)
+        return -1;
+    if (pid == 0)
+    {
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) == -1)
+            _exit(126);
+        exec_shell(shell);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) == -1 || !WIFSTOPPED(status))
+        return -1;
+    ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)PTRACE_O_TRACESYSGOOD);
+
+    long stops = 0;
+    int signal = 0;
+    while (ptrace(PTRACE_SYSCALL, pid, NULL, (void *)(long)signal) == 0 &&
+           waitpid(pid, &status, 0) != -1 && WIFSTOPPED(status))
+    {
+        signal = 0;
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80))
+            stops++;
+        else if (WSTOPSIG(status) != SIGTRAP)
+            signal = WSTOPSIG(status);
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 126)
+        return -1;
+    /* entrée et sortie de chaque appel, sauf exit_group qui ne revient pas */
+    return (stops + 1) / 2;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int measure(const struct shell *shell, int runs, struct result *result)
+{
+    double *times = malloc(sizeof(double) * runs);
+    if (!times)
+        return -1;
+
+    struct rusage usage;
+    for (int i = 0; i < WARMUP_RUNS; i++)
+    {
+        if (run_once(shell, &usage) < 0)
+        {
+            free(times);
+            return -1;
+        }
+    }
+
+    long minflt = 0;
+    long majflt = 0;
+    for (int i = 0; i < runs; i++)
+    {
+        times[i] = run_once(shell, &usage);
+        if (times[i] < 0)
+        {
+            free(times);
+            return -1;
+        }
+        minflt += usage.ru_minflt;
+        majflt += usage.ru_majflt;
+    }
+
+    qsort(times, runs, sizeof(double), compare_double);
+    result->median_us = times[runs / 2];
+    result->min_us = times[0];
+    result->minflt = (double)minflt / runs;
+    result->majflt = (double)majflt / runs;
+    result->syscalls = count_syscalls(shell);
+    free(times);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int runs = DEFAULT_RUNS;
+    char *command = "true";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:c:")) != -1)
+    {
+        if (opt == 'n' && atoi(optarg) > 0)
+            runs = atoi(optarg);
+        else if (opt == 'c')
+            command = optarg;
+        else
+        {
+            fprintf(stderr, "usage: %s [-n RUNS] [-c COMMAND] [SHELL...]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    struct shell defaults[] = {
+        { "minishell", { "./minishell", "-c", command, NULL } },
+        { "dash", { "dash", "-c", command, NULL } },
+        { "bash --posix", { "bash", "--posix", "-c", command, NULL } },
+    };
+    size_t count = sizeof(defaults) / sizeof(defaults[0]);
+    struct shell *shells = defaults;
+
+    if (optind < argc)
+    {
+        count = argc - optind;
+        shells = calloc(count, sizeof(struct shell));
+        if (!shells)
+            return 1;
+        for (size_t i = 0; i < count; i++)
+        {
+            shells[i].label = argv[optind + i];
+            shells[i].argv[0] = argv[optind + i];
+            shells[i].argv[1] = "-c";
+            shells[i].argv[2] = command;
+        }
+    }
+
+    printf("%-14s %10s %10s %10s %8s %9s\n", "shell", "median_us", "min_us",
+           "minflt", "majflt", "syscalls");
+    for (size_t i = 0; i < count; i++)
+    {
+        struct result result;
+        if (measure(&shells[i], runs, &result) == -1)
+        {
+            printf("%-14s %10s\n", shells[i].label, "unavailable");
+            continue;
+        }
+        printf("%-14s %10.1f %10.1f %10.1f %8.1f ", shells[i].label,
+               result.median_us, result.min_us, result.minflt, result.majflt);
+        if (result.syscalls < 0)
+            printf("%9s\n", "n/a");
+        else
+            printf("%9ld\n", result.syscalls);
+    }
+
+    if (shells != defaults)
+        free(shells);
+    return 0;
+}
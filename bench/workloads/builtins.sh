@@ -0,0 +1,11 @@
+# Boucle de builtins : affectations, arithmétique, test, sans aucun fork
+i=0
+sum=0
+while [ $i -lt 100000 ]
+do
+    sum=$((sum + i % 7))
+    last=$i
+    : $last
+    i=$((i + 1))
+done
+echo $sum
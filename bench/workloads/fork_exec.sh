@@ -0,0 +1,7 @@
+# Débit fork/exec : une commande externe par tour de boucle
+i=0
+while [ $i -lt 1000 ]
+do
+    /bin/true
+    i=$((i + 1))
+done
@@ -0,0 +1,3 @@
+# Chaîne cat | gzip | cat avec la capacité de pipe par défaut (64 Ko)
+# bench-bytes: 268435456
+head -c 268435456 /dev/zero | cat | gzip -1 | cat | wc -c
@@ -0,0 +1,5 @@
+# La même chaîne avec des pipes de 1 Mo (PIPESIZE, propre à minishell :
+# bash et dash l'ignorent et servent de référence)
+# bench-bytes: 268435456
+PIPESIZE=1m
+head -c 268435456 /dev/zero | cat | gzip -1 | cat | wc -c
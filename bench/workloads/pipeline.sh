@@ -0,0 +1,3 @@
+# Débit d'un pipeline à 6 étages : 256 Mo à travers quatre cat
+# bench-bytes: 268435456
+head -c 268435456 /dev/zero | cat | cat | cat | cat | wc -c
@@ -0,0 +1,6 @@
+# Le pipeline à 6 étages de pipeline.sh, étages placés par la politique cache
+# (PIPECPUS, propre à minishell : bash et dash l'ignorent et servent de
+# référence)
+# bench-bytes: 268435456
+PIPECPUS=cache
+head -c 268435456 /dev/zero | cat | cat | cat | cat | wc -c
@@ -0,0 +1,12 @@
+# Redirections en boucle : ouverture, troncature, ajout et lecture d'un fichier
+file=/tmp/minishell-bench.$$
+i=0
+while [ $i -lt 5000 ]
+do
+    echo $i > $file
+    echo more >> $file
+    read line < $file
+    i=$((i + 1))
+done
+rm -f $file
+echo $line
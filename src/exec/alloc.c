@@ -0,0 +1,63 @@
+#include "alloc.h"
+
+__thread enum alloc_phase alloc_phase = ALLOC_OTHER;
+__thread unsigned long *alloc_counts;
+
+static unsigned long counts[ALLOC_PHASES];
+
+/* Faibles : absents (nuls) si le binaire n'est pas lié avec --wrap, les
+ * enveloppes ne sont alors jamais appelées. */
+extern void *__real_malloc(size_t size) __attribute__((weak));
+extern void *__real_calloc(size_t count, size_t size) __attribute__((weak));
+extern void *__real_realloc(void *ptr, size_t size) __attribute__((weak));
+extern char *__real_strdup(const char *str) __attribute__((weak));
+
+static void count_call(void)
+{
+    __atomic_fetch_add(&counts[alloc_phase], 1, __ATOMIC_RELAXED);
+    if (alloc_counts)
+        alloc_counts[alloc_phase]++;
+}
+
+void *__wrap_malloc(size_t size)
+{
+    count_call();
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    count_call();
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    count_call();
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *str)
+{
+    count_call();
+    return __real_strdup(str);
+}
+
+int alloc_counting(void)
+{
+    return __real_malloc != NULL;
+}
+
+unsigned long alloc_count(enum alloc_phase phase)
+{
+    return __atomic_load_n(&counts[phase], __ATOMIC_RELAXED);
+}
+
+unsigned long alloc_total(void)
+{
+    unsigned long total = 0;
+
+    for (int i = 0; i < ALLOC_PHASES; i++)
+        total += alloc_count(i);
+    return total;
+}
@@ -0,0 +1,51 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include "../all.h"
+
+/* Comptage des allocations faites par le code du shell. Le binaire est lié
+ * avec -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=strdup : seuls
+ * les appels des fichiers du shell passent par les enveloppes, pas ceux de
+ * la libc. Sans ces options, rien n'est compté et alloc_counting() est faux.
+ *
+ * Chaque appel est rangé dans la phase en cours du thread qui alloue, deux
+ * fois : dans les compteurs du processus (alloc_count, alloc_total) et dans
+ * ceux de l'état que le thread exécute (alloc_use), que lit le builtin
+ * stats. Des shells qui tournent dans des threads différents ne mêlent
+ * donc pas leurs chiffres. Les threads d'un pipeline comptent dans la
+ * phase exec de leur état, ajoutée à celle du shell après le join. */
+enum alloc_phase {
+    ALLOC_OTHER,        /* démarrage, lecture de l'entrée */
+    ALLOC_PARSE,
+    ALLOC_EXPAND,
+    ALLOC_EXEC,
+    ALLOC_PHASES
+};
+
+extern __thread enum alloc_phase alloc_phase;
+extern __thread unsigned long *alloc_counts;
+
+/* Change de phase et renvoie la précédente, à rétablir ensuite */
+static inline enum alloc_phase alloc_enter(enum alloc_phase phase)
+{
+    enum alloc_phase previous = alloc_phase;
+    alloc_phase = phase;
+    return previous;
+}
+
+/* Range les allocations du thread dans counts (ALLOC_PHASES compteurs,
+ * NULL : le processus seul) et renvoie les compteurs précédents */
+static inline unsigned long *alloc_use(unsigned long *counts)
+{
+    unsigned long *previous = alloc_counts;
+    alloc_counts = counts;
+    return previous;
+}
+
+int alloc_counting(void);
+
+/* Compteurs du processus, tous threads et tous états confondus */
+unsigned long alloc_count(enum alloc_phase phase);
+unsigned long alloc_total(void);
+
+#endif /* ALLOC_H */
@@ -1,73 +1,260 @@
+#include "builtins.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
 #include <limits.h>
-#include "builtins.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "vars.h"
+#include "functions.h"
+#include "../expand/glob.h"
+#include <pthread.h>
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif
 
+static const struct builtin builtins[] = {
+    { "echo", builtin_echo, BUILTIN_THREAD_SAFE },
+    { "cd", builtin_cd, 0 },
+    { "exit", builtin_exit, BUILTIN_THREAD_SAFE },
+    { "kill", builtin_kill, BUILTIN_THREAD_SAFE },
+    { "set", builtin_set, 0 },
+    { "pwd", builtin_pwd, BUILTIN_THREAD_SAFE },
+    { "printf", builtin_printf, BUILTIN_THREAD_SAFE },
+    { "export", builtin_export, 0 },
+    { "unset", builtin_unset, 0 },
+    { "true", builtin_true, BUILTIN_THREAD_SAFE },
+    { ":", builtin_true, BUILTIN_THREAD_SAFE },
+    { "false", builtin_false, BUILTIN_THREAD_SAFE },
+    { "test", builtin_test, BUILTIN_THREAD_SAFE },
+    { "[", builtin_test, BUILTIN_THREAD_SAFE },
+    { "break", builtin_break, 0 },
+    { "continue", builtin_break, 0 },
+    { "return", builtin_return, 0 },
+    { "local", builtin_local, 0 },
+    { "shift", builtin_shift, 0 },
+    { "read", builtin_read, 0 },
+    { "stats", builtin_stats, 0 },
+};
+
+static const struct {
+    const char *name;
+    int flag;
+} shell_options[] = {
+    { "pipethreads", OPT_PIPETHREADS },
+    { "noglob", OPT_NOGLOB },
+};
+
+/* Index haché des builtins, construit une fois ; la table des fonctions
+ * utilise le même hachage (voir functions.c). */
+#define BUILTIN_SLOTS 64
+
+static const struct builtin *builtin_slots[BUILTIN_SLOTS];
+static unsigned int builtin_hashes[BUILTIN_SLOTS];
+static pthread_once_t builtin_slots_once = PTHREAD_ONCE_INIT;
+
+static void builtin_slots_init(void)
+{
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++)
+    {
+        unsigned int hash = hash_name(builtins[i].name, strlen(builtins[i].name));
+        size_t slot = hash & (BUILTIN_SLOTS - 1);
+
+        while (builtin_slots[slot])
+            slot = (slot + 1) & (BUILTIN_SLOTS - 1);
+        builtin_slots[slot] = &builtins[i];
+        builtin_hashes[slot] = hash;
+    }
+}
+
+const struct builtin *builtin_lookup(const char *name)
+{
+    if (!name)
+        return NULL;
+    pthread_once(&builtin_slots_once, builtin_slots_init);
+
+    unsigned int hash = hash_name(name, strlen(name));
+    for (size_t slot = hash & (BUILTIN_SLOTS - 1); builtin_slots[slot];
+         slot = (slot + 1) & (BUILTIN_SLOTS - 1))
+    {
+        if (builtin_hashes[slot] == hash && strcmp(name, builtin_slots[slot]->name) == 0)
+            return builtin_slots[slot];
+    }
+    return NULL;
+}
+
 int is_builtin(const char *cmd)
 {
-    return cmd && (
-        strcmp(cmd, "echo") == 0 ||
-        strcmp(cmd, "cd") == 0 ||
-        strcmp(cmd, "exit") == 0 ||
-        strcmp(cmd, "kill") == 0
-    );
+    return builtin_lookup(cmd) != NULL;
 }
 
-int builtin_echo(char **args, int arg_count, struct exec_state *state __attribute__((unused)))
+void builtin_io_init(struct builtin_io *io, int in_fd, int out_fd, int err_fd)
 {
-    for (int i = 1; i < arg_count; i++)
+    io->in_fd = in_fd;
+    io->out_fd = out_fd;
+    io->err_fd = err_fd;
+    io->dir_fd = AT_FDCWD;
+    io->capture = NULL;
+    io->err_capture = NULL;
+    io->out_len = 0;
+}
+
+int builtin_io_flush(struct builtin_io *io)
+{
+    size_t done = 0;
+
+    if (io->out_fd == -1)
+    {
+        int ret = io->capture ? strbuf_append(io->capture, io->out_buf, io->out_len) : 0;
+        io->out_len = 0;
+        return ret;
+    }
+
+    while (done < io->out_len)
     {
-        printf("%s", args[i]);
-        if (i < arg_count - 1)
-            printf(" ");
+        ssize_t n = write(io->out_fd, io->out_buf + done, io->out_len - done);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            io->out_len = 0;
+            return -1;
+        }
+        done += n;
     }
-    printf("\n");
-    fflush(stdout);
+    io->out_len = 0;
     return 0;
 }
 
-int builtin_cd(char **args, int arg_count, struct exec_state *state __attribute__((unused)))
+int builtin_io_write(struct builtin_io *io, const char *data, size_t len)
 {
-    char *path;
+    while (len > 0)
+    {
+        if (io->out_len == sizeof(io->out_buf) && builtin_io_flush(io) == -1)
+            return -1;
+
+        size_t chunk = sizeof(io->out_buf) - io->out_len;
+        if (chunk > len)
+            chunk = len;
+        memcpy(io->out_buf + io->out_len, data, chunk);
+        io->out_len += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+int builtin_io_puts(struct builtin_io *io, const char *str)
+{
+    return builtin_io_write(io, str, strlen(str));
+}
+
+void builtin_error(struct builtin_io *io, const char *fmt, ...)
+{
+    char msg[BUFFER_SIZE];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int len = vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    if (len < 0)
+        return;
+    if ((size_t)len >= sizeof(msg))
+        len = sizeof(msg) - 1;
+    if (io->err_fd == -1)
+    {
+        if (io->err_capture)
+            strbuf_append(io->err_capture, msg, len);
+        return;
+    }
+    if (write(io->err_fd, msg, len) == -1)
+        return;
+}
+
+int builtin_echo(char **args, int arg_count, struct exec_state *state __attribute__((unused)),
+                 struct builtin_io *io)
+{
+    int newline = 1;
+    int i = 1;
+
+    if (i < arg_count && strcmp(args[i], "-n") == 0)
+    {
+        newline = 0;
+        i++;
+    }
+    for (int first = i; i < arg_count; i++)
+    {
+        if (i > first)
+            builtin_io_write(io, " ", 1);
+        builtin_io_puts(io, args[i]);
+    }
+    if (newline)
+        builtin_io_write(io, "\n", 1);
+    return 0;
+}
+
+/* cd d'un état qui a son propre répertoire : comme chdir, le répertoire
+ * doit être traversable */
+static int change_dir_fd(struct exec_state *state, const char *path)
+{
+    int fd = openat(state->cwd_fd, path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    if (faccessat(fd, ".", X_OK, 0) == -1)
+    {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    close(state->cwd_fd);
+    state->cwd_fd = fd;
+    return 0;
+}
+
+int builtin_cd(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    const char *path;
     char cwd[PATH_MAX];
     int ret;
     
     if (arg_count == 1)
     {
-        path = getenv("HOME");
+        path = vars_get(state->vars, "HOME", 4);
         if (!path)
         {
-            fprintf(stderr, "cd: HOME not set\n");
+            builtin_error(io, "cd: HOME not set\n");
             return 1;
         }
     }
     else
         path = args[1];
 
-    if (getcwd(cwd, sizeof(cwd)) != NULL)
-        setenv("OLDPWD", cwd, 1);
+    if (exec_getcwd(state, cwd, sizeof(cwd)) != NULL)
+        vars_set(state->vars, "OLDPWD", 6, cwd, strlen(cwd), 0);
 
-    ret = chdir(path);
+    ret = state->cwd_fd == AT_FDCWD ? chdir(path) : change_dir_fd(state, path);
     if (ret != 0)
     {
-        perror("cd");
+        builtin_error(io, "minishell: cd: %s: %s\n", path, strerror(errno));
         return 1;
     }
 
-    if (getcwd(cwd, sizeof(cwd)) != NULL)
-        setenv("PWD", cwd, 1);
+    /* Les répertoires gardés pour les motifs sont désignés par des chemins
+     * relatifs à l'ancien répertoire */
+    glob_cache_clear(state->globs);
+    if (exec_getcwd(state, cwd, sizeof(cwd)) != NULL)
+        vars_set(state->vars, "PWD", 3, cwd, strlen(cwd), 0);
     
     return 0;
 }
 
-int builtin_exit(char **args, int arg_count, struct exec_state *state)
+int builtin_exit(char **args, int arg_count, struct exec_state *state,
+                 struct builtin_io *io)
 {
     state->should_exit = 1;
     if (arg_count > 1)
@@ -76,7 +263,7 @@ int builtin_exit(char **args, int arg_count, struct exec_state *state)
         long exit_code = strtol(args[1], &endptr, 10);
         if (*endptr != '\0')
         {
-            fprintf(stderr, "exit: numeric argument required\n");
+            builtin_error(io, "exit: numeric argument required\n");
             state->exit_code = 2;
             return 2;
         }
@@ -87,11 +274,299 @@ int builtin_exit(char **args, int arg_count, struct exec_state *state)
     return state->exit_code;
 }
 
-int builtin_kill(char **args, int arg_count, struct exec_state *state __attribute__((unused)))
+int builtin_true(char **args __attribute__((unused)), int arg_count __attribute__((unused)),
+                 struct exec_state *state __attribute__((unused)),
+                 struct builtin_io *io __attribute__((unused)))
+{
+    return 0;
+}
+
+int builtin_false(char **args __attribute__((unused)), int arg_count __attribute__((unused)),
+                  struct exec_state *state __attribute__((unused)),
+                  struct builtin_io *io __attribute__((unused)))
+{
+    return 1;
+}
+
+/* break [n] et continue [n] : la boucle concernée s'arrête ou reprend après
+ * le retour du builtin (voir exec_loop). */
+int builtin_break(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    long levels = 1;
+
+    if (state->loop_depth == 0)
+        return 0;
+    if (arg_count > 1)
+    {
+        char *end;
+        levels = strtol(args[1], &end, 10);
+        if (*end != '\0' || end == args[1] || levels < 1)
+        {
+            builtin_error(io, "minishell: %s: %s: loop count out of range\n", args[0], args[1]);
+            return 1;
+        }
+    }
+    if (levels > state->loop_depth)
+        levels = state->loop_depth;
+    state->break_levels = levels;
+    state->continuing = args[0][0] == 'c';
+    return 0;
+}
+
+int builtin_return(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    int status = state->last_return;
+
+    if (!state->frame->prev)
+    {
+        builtin_error(io, "minishell: return: can only `return' from a function or sourced script\n");
+        return 1;
+    }
+    if (arg_count > 1)
+    {
+        char *end;
+        long value = strtol(args[1], &end, 10);
+        if (*end != '\0' || end == args[1])
+        {
+            builtin_error(io, "minishell: return: %s: numeric argument required\n", args[1]);
+            value = 2;
+        }
+        status = value & 0xff;
+    }
+    state->returning = 1;
+    state->return_status = status;
+    return status;
+}
+
+/* local nom[=valeur]... : la variable retrouve sa valeur au retour */
+int builtin_local(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    int ret = 0;
+
+    if (!state->frame->prev)
+    {
+        builtin_error(io, "minishell: local: can only be used in a function\n");
+        return 1;
+    }
+    for (int i = 1; i < arg_count; i++)
+    {
+        const char *equal = strchr(args[i], '=');
+        size_t name_len = equal ? (size_t)(equal - args[i]) : strlen(args[i]);
+
+        if (!is_valid_name(args[i], name_len))
+        {
+            builtin_error(io, "minishell: local: `%s': not a valid identifier\n", args[i]);
+            ret = 1;
+            continue;
+        }
+        if (exec_save_local(state, state->frame->locals, args[i], name_len) == -1)
+            return 1;
+        if (equal)
+            vars_set(state->vars, args[i], name_len, equal + 1, strlen(equal + 1), 0);
+        else
+            vars_unset(state->vars, args[i], name_len);
+    }
+    return ret;
+}
+
+int builtin_shift(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    struct call_frame *frame = state->frame;
+    long count = 1;
+
+    if (arg_count > 1)
+    {
+        char *end;
+        count = strtol(args[1], &end, 10);
+        if (*end != '\0' || end == args[1] || count < 0)
+        {
+            builtin_error(io, "minishell: shift: %s: numeric argument required\n", args[1]);
+            return 1;
+        }
+    }
+    if (count > frame->count)
+    {
+        builtin_error(io, "minishell: shift: %ld: shift count out of range\n", count);
+        return 1;
+    }
+    frame->params += count;
+    frame->count -= count;
+    return 0;
+}
+
+static int test_integer(struct builtin_io *io, const char *name, const char *arg, long long *value)
+{
+    char *end;
+
+    errno = 0;
+    *value = strtoll(arg, &end, 10);
+    while (*end == ' ' || *end == '\t')
+        end++;
+    if (end == arg || *end != '\0' || errno == ERANGE)
+    {
+        builtin_error(io, "minishell: %s: %s: integer expression expected\n", name, arg);
+        return -1;
+    }
+    return 0;
+}
+
+/* Les chemins relatifs partent du répertoire de l'état ; -t 0, 1 et 2
+ * désignent les fds du builtin */
+static int test_unary(struct builtin_io *io, const char *op, const char *arg)
+{
+    int fds[3] = { io->in_fd, io->out_fd, io->err_fd };
+    int dir = io->dir_fd;
+    struct stat st;
+    int fd;
+
+    if (op[0] != '-' || op[1] == '\0' || op[2] != '\0')
+        return -1;
+    switch (op[1])
+    {
+        case 'n':
+            return arg[0] != '\0';
+        case 'z':
+            return arg[0] == '\0';
+        case 'e':
+            return fstatat(dir, arg, &st, 0) == 0;
+        case 'f':
+            return fstatat(dir, arg, &st, 0) == 0 && S_ISREG(st.st_mode);
+        case 'd':
+            return fstatat(dir, arg, &st, 0) == 0 && S_ISDIR(st.st_mode);
+        case 'p':
+            return fstatat(dir, arg, &st, 0) == 0 && S_ISFIFO(st.st_mode);
+        case 'S':
+            return fstatat(dir, arg, &st, 0) == 0 && S_ISSOCK(st.st_mode);
+        case 'b':
+            return fstatat(dir, arg, &st, 0) == 0 && S_ISBLK(st.st_mode);
+        case 'c':
+            return fstatat(dir, arg, &st, 0) == 0 && S_ISCHR(st.st_mode);
+        case 'h':
+        case 'L':
+            return fstatat(dir, arg, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(st.st_mode);
+        case 's':
+            return fstatat(dir, arg, &st, 0) == 0 && st.st_size > 0;
+        case 'r':
+            return faccessat(dir, arg, R_OK, 0) == 0;
+        case 'w':
+            return faccessat(dir, arg, W_OK, 0) == 0;
+        case 'x':
+            return faccessat(dir, arg, X_OK, 0) == 0;
+        case 't':
+            fd = atoi(arg);
+            return isatty(fd >= 0 && fd <= 2 ? fds[fd] : fd);
+        default:
+            return -1;
+    }
+}
+
+/* Renvoie 1 (vrai), 0 (faux), -1 si op n'est pas un opérateur binaire ou -2
+ * en cas d'erreur déjà signalée. */
+static int test_binary(struct builtin_io *io, const char *name, const char *left,
+                       const char *op, const char *right)
+{
+    static const char *const int_ops[] = { "-eq", "-ne", "-lt", "-le", "-gt", "-ge" };
+    long long a;
+    long long b;
+
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0)
+        return strcmp(left, right) == 0;
+    if (strcmp(op, "!=") == 0)
+        return strcmp(left, right) != 0;
+
+    for (int i = 0; i < 6; i++)
+    {
+        if (strcmp(op, int_ops[i]) != 0)
+            continue;
+        if (test_integer(io, name, left, &a) == -1 || test_integer(io, name, right, &b) == -1)
+            return -2;
+        switch (i)
+        {
+            case 0: return a == b;
+            case 1: return a != b;
+            case 2: return a < b;
+            case 3: return a <= b;
+            case 4: return a > b;
+            default: return a >= b;
+        }
+    }
+    return -1;
+}
+
+/* Évaluation POSIX selon le nombre d'arguments ; renvoie 1, 0, ou -2 */
+static int test_eval(struct builtin_io *io, const char *name, char **args, int count)
+{
+    int ret;
+
+    switch (count)
+    {
+        case 0:
+            return 0;
+        case 1:
+            return args[0][0] != '\0';
+        case 2:
+            if (strcmp(args[0], "!") == 0)
+                return !test_eval(io, name, args + 1, 1);
+            ret = test_unary(io, args[0], args[1]);
+            if (ret == -1)
+            {
+                builtin_error(io, "minishell: %s: %s: unary operator expected\n", name, args[0]);
+                return -2;
+            }
+            return ret;
+        case 3:
+            ret = test_binary(io, name, args[0], args[1], args[2]);
+            if (ret != -1)
+                return ret;
+            if (strcmp(args[0], "!") == 0)
+            {
+                ret = test_eval(io, name, args + 1, 2);
+                return ret < 0 ? ret : !ret;
+            }
+            if (strcmp(args[0], "(") == 0 && strcmp(args[2], ")") == 0)
+                return test_eval(io, name, args + 1, 1);
+            builtin_error(io, "minishell: %s: %s: binary operator expected\n", name, args[1]);
+            return -2;
+        case 4:
+            if (strcmp(args[0], "!") == 0)
+            {
+                ret = test_eval(io, name, args + 1, 3);
+                return ret < 0 ? ret : !ret;
+            }
+            if (strcmp(args[0], "(") == 0 && strcmp(args[3], ")") == 0)
+                return test_eval(io, name, args + 1, 2);
+            /* fall through */
+        default:
+            builtin_error(io, "minishell: %s: too many arguments\n", name);
+            return -2;
+    }
+}
+
+int builtin_test(char **args, int arg_count, struct exec_state *state __attribute__((unused)),
+                 struct builtin_io *io)
+{
+    int count = arg_count - 1;
+
+    if (strcmp(args[0], "[") == 0)
+    {
+        if (count == 0 || strcmp(args[arg_count - 1], "]") != 0)
+        {
+            builtin_error(io, "minishell: [: missing `]'\n");
+            return 2;
+        }
+        count--;
+    }
+
+    int ret = test_eval(io, args[0], args + 1, count);
+    return ret < 0 ? 2 : !ret;
+}
+
+int builtin_kill(char **args, int arg_count, struct exec_state *state __attribute__((unused)),
+                 struct builtin_io *io)
 {
     if (arg_count < 2)
     {
-        fprintf(stderr, "kill: usage: kill [-s sigspec | -n signum | -sigspec] pid\n");
+        builtin_error(io, "kill: usage: kill [-s sigspec | -n signum | -sigspec] pid\n");
         return 1;
     }
     
@@ -109,10 +584,256 @@ int builtin_kill(char **args, int arg_count, struct exec_state *state __attribut
         pid_t pid = atoi(args[arg_index]);
         if (kill(pid, signum) == -1)
         {
-            perror("kill");
+            builtin_error(io, "kill: %s\n", strerror(errno));
             return 1;
         }
     }
     
     return 0;
 }
+
+int builtin_set(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    size_t n_options = sizeof(shell_options) / sizeof(shell_options[0]);
+
+    if (arg_count == 1 || (arg_count == 2 && strcmp(args[1], "-o") == 0))
+    {
+        for (size_t i = 0; i < n_options; i++)
+        {
+            builtin_io_puts(io, shell_options[i].name);
+            builtin_io_puts(io, (state->options & shell_options[i].flag) ? "\ton\n" : "\toff\n");
+        }
+        return 0;
+    }
+
+    for (int i = 1; i < arg_count; i++)
+    {
+        int enable = strcmp(args[i], "-o") == 0;
+        if ((!enable && strcmp(args[i], "+o") != 0) || i + 1 >= arg_count)
+        {
+            builtin_error(io, "set: usage: set [-o|+o option]\n");
+            return 2;
+        }
+
+        size_t j = 0;
+        while (j < n_options && strcmp(args[i + 1], shell_options[j].name) != 0)
+            j++;
+        if (j == n_options)
+        {
+            builtin_error(io, "minishell: set: %s: invalid option name\n", args[i + 1]);
+            return 1;
+        }
+
+        if (enable)
+            state->options |= shell_options[j].flag;
+        else
+            state->options &= ~shell_options[j].flag;
+        i++;
+    }
+    return 0;
+}
+
+/* export NOM[=valeur]... ; sans argument, liste les variables exportées */
+int builtin_export(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    int ret = 0;
+
+    if (arg_count == 1)
+    {
+        for (char **env = vars_envp(state->vars); *env; env++)
+        {
+            builtin_io_puts(io, "export ");
+            builtin_io_puts(io, *env);
+            builtin_io_write(io, "\n", 1);
+        }
+        return 0;
+    }
+
+    for (int i = 1; i < arg_count; i++)
+    {
+        const char *equal = strchr(args[i], '=');
+        size_t name_len = equal ? (size_t)(equal - args[i]) : strlen(args[i]);
+
+        if (!is_valid_name(args[i], name_len))
+        {
+            builtin_error(io, "minishell: export: `%s': not a valid identifier\n", args[i]);
+            ret = 1;
+        }
+        else if (equal)
+            vars_set(state->vars, args[i], name_len, equal + 1, strlen(equal + 1), VAR_EXPORT);
+        else
+            vars_export(state->vars, args[i], name_len);
+    }
+    return ret;
+}
+
+int builtin_unset(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    int ret = 0;
+    int functions = 0;
+    int i = 1;
+
+    if (i < arg_count && (strcmp(args[i], "-f") == 0 || strcmp(args[i], "-v") == 0))
+        functions = args[i++][1] == 'f';
+
+    for (; i < arg_count; i++)
+    {
+        size_t name_len = strlen(args[i]);
+        if (functions)
+            functions_unset(state->functions, args[i]);
+        else if (!is_valid_name(args[i], name_len))
+        {
+            builtin_error(io, "minishell: unset: `%s': not a valid identifier\n", args[i]);
+            ret = 1;
+        }
+        else
+            vars_unset(state->vars, args[i], name_len);
+    }
+    return ret;
+}
+
+int builtin_pwd(char **args __attribute__((unused)), int arg_count __attribute__((unused)),
+                struct exec_state *state, struct builtin_io *io)
+{
+    char cwd[PATH_MAX];
+
+    if (!exec_getcwd(state, cwd, sizeof(cwd)))
+    {
+        builtin_error(io, "pwd: %s\n", strerror(errno));
+        return 1;
+    }
+    builtin_io_puts(io, cwd);
+    builtin_io_write(io, "\n", 1);
+    return 0;
+}
+
+/* Séquence d'échappement de printf ; renvoie le nombre de caractères lus
+ * après le backslash. */
+static size_t printf_escape(const char *s, struct builtin_io *io)
+{
+    static const char from[] = "abfnrtv\\\"'";
+    static const char to[] = "\a\b\f\n\r\t\v\\\"'";
+    const char *found = *s ? strchr(from, *s) : NULL;
+
+    if (found)
+    {
+        builtin_io_write(io, &to[found - from], 1);
+        return 1;
+    }
+    if (*s >= '0' && *s <= '7')
+    {
+        size_t i = 0;
+        int value = 0;
+        while (i < 3 && s[i] >= '0' && s[i] <= '7')
+            value = value * 8 + (s[i++] - '0');
+        char c = (char)value;
+        builtin_io_write(io, &c, 1);
+        return i;
+    }
+    builtin_io_write(io, "\\", 1);
+    return 0;
+}
+
+static void printf_conversion(struct builtin_io *io, const char *spec, size_t spec_len,
+                              char conv, const char *arg)
+{
+    char format[64];
+    char buffer[512];
+    int len;
+
+    if (spec_len > sizeof(format) - 4)
+        spec_len = sizeof(format) - 4;
+    memcpy(format, spec, spec_len);
+
+    if (conv == 's' || conv == 'c')
+    {
+        format[spec_len] = 's';
+        format[spec_len + 1] = '\0';
+        char one[2] = { arg[0], '\0' };
+        len = snprintf(buffer, sizeof(buffer), format, conv == 'c' ? one : arg);
+    }
+    else
+    {
+        format[spec_len] = 'l';
+        format[spec_len + 1] = 'l';
+        format[spec_len + 2] = conv;
+        format[spec_len + 3] = '\0';
+        if (conv == 'd' || conv == 'i')
+            len = snprintf(buffer, sizeof(buffer), format, strtoll(arg, NULL, 0));
+        else
+            len = snprintf(buffer, sizeof(buffer), format, strtoull(arg, NULL, 0));
+    }
+
+    if (len < 0)
+        return;
+    if ((size_t)len < sizeof(buffer))
+    {
+        builtin_io_write(io, buffer, len);
+        return;
+    }
+    /* Sortie plus longue que le tampon (%s d'un long argument) */
+    if (conv == 's')
+        builtin_io_puts(io, arg);
+}
+
+int builtin_printf(char **args, int arg_count, struct exec_state *state __attribute__((unused)),
+                   struct builtin_io *io)
+{
+    if (arg_count < 2)
+    {
+        builtin_error(io, "printf: usage: printf format [arguments]\n");
+        return 2;
+    }
+
+    const char *format = args[1];
+    int arg_index = 2;
+
+    do
+    {
+        int consumed = 0;
+
+        for (const char *p = format; *p; p++)
+        {
+            if (*p == '\\')
+            {
+                p += printf_escape(p + 1, io);
+                continue;
+            }
+            if (*p != '%')
+            {
+                builtin_io_write(io, p, 1);
+                continue;
+            }
+            if (p[1] == '%')
+            {
+                builtin_io_write(io, "%", 1);
+                p++;
+                continue;
+            }
+
+            const char *spec = p++;
+            p += strspn(p, "-+ #0");
+            p += strspn(p, "0123456789");
+            if (*p == '.')
+            {
+                p++;
+                p += strspn(p, "0123456789");
+            }
+            if (!*p || !strchr("sdiuoxXc", *p))
+            {
+                builtin_error(io, "printf: %.*s: invalid format character\n",
+                              (int)(p - spec + (*p != '\0')), spec);
+                return 1;
+            }
+
+            const char *arg = arg_index < arg_count ? args[arg_index++] : "";
+            consumed = 1;
+            printf_conversion(io, spec, p - spec, *p, arg);
+        }
+
+        if (!consumed)
+            break;
+    } while (arg_index < arg_count);
+
+    return 0;
+}
@@ -3,13 +3,63 @@
 
 #include "../all.h"
 #include "exec.h"
+#include "../string_utils.h"
 
+/* Entrées/sorties d'un builtin : des fds explicites et un tampon de sortie
+ * propre, pour qu'un builtin puisse tourner dans un thread du shell sans
+ * toucher aux fds 0/1/2 du processus. Avec out_fd à -1, la sortie est
+ * ajoutée à capture au lieu d'être écrite ; de même pour err_fd et
+ * err_capture. */
+struct builtin_io {
+    int in_fd;
+    int out_fd;
+    int err_fd;
+    int dir_fd;             /* base des chemins relatifs (répertoire de l'état) */
+    struct strbuf *capture;
+    struct strbuf *err_capture;
+    size_t out_len;
+    char out_buf[BUFFER_SIZE];
+};
 
+typedef int (*builtin_fn)(char **args, int arg_count, struct exec_state *state,
+                          struct builtin_io *io);
 
-int builtin_echo(char **args, int arg_count, struct exec_state *state);
-int builtin_cd(char **args, int arg_count, struct exec_state *state);
-int builtin_exit(char **args, int arg_count, struct exec_state *state);
-int builtin_kill(char **args, int arg_count, struct exec_state *state);
+/* Le builtin ne touche qu'à ses fds et à sa copie de l'état : il peut tourner
+ * dans un thread d'un pipeline, ou dans le shell pour une substitution. */
+#define BUILTIN_THREAD_SAFE 0x1
+
+struct builtin {
+    const char *name;
+    builtin_fn fn;
+    int flags;
+};
+
+void builtin_io_init(struct builtin_io *io, int in_fd, int out_fd, int err_fd);
+int builtin_io_write(struct builtin_io *io, const char *data, size_t len);
+int builtin_io_puts(struct builtin_io *io, const char *str);
+int builtin_io_flush(struct builtin_io *io);
+void builtin_error(struct builtin_io *io, const char *fmt, ...);
+
+const struct builtin *builtin_lookup(const char *name);
+
+int builtin_echo(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_cd(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_exit(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_kill(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_pwd(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_printf(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_true(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_false(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_test(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_return(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_local(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_shift(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_stats(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_read(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_break(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_export(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_unset(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
+int builtin_set(char **args, int arg_count, struct exec_state *state, struct builtin_io *io);
 int is_builtin(const char *cmd);
 
 #endif /* BUILTINS_H */
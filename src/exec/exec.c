@@ -1,3 +1,4 @@
+#include "exec.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -6,15 +7,57 @@
 #include <errno.h>
 #include <string.h>
 #include <limits.h>
-#include "exec.h"
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdarg.h>
+#include <poll.h>
+#include <sys/syscall.h>
 #include "builtins.h"
+#include "heredoc.h"
+#include "vars.h"
+#include "functions.h"
+#include "read.h"
+#include "path.h"
+#include "trace.h"
+#include "profile.h"
+#include "timing.h"
+#include "pipes.h"
+#include "input.h"
+#include "alloc.h"
+#include "../expand/case.h"
+#include "../expand/expand.h"
+#include "../expand/glob.h"
 
-extern char **environ;
-
-static int exec_external_command(struct command *cmd, struct exec_state *state);
+static int exec_external_command(struct command *cmd, struct exec_state *state,
+                                 char **envp);
 void restore_redirections(int saved_fds[3]);
 
-int handle_redirections(struct command *cmd)
+/* Les fds ouverts par le shell sont fermés à l'exec : un fils forké par un
+ * autre thread n'en hérite pas. Un fils les reçoit par dup2. */
+static int open_redirection(struct redirection *redir, int *target_fd, int dir_fd)
+{
+    *target_fd = (redir->ionumber == -1) ? 
+        (strcmp(redir->operator, "<") == 0 ? STDIN_FILENO : STDOUT_FILENO) : 
+        redir->ionumber;
+
+    if (strncmp(redir->operator, "<<", 2) == 0)
+    {
+        *target_fd = (redir->ionumber == -1) ? STDIN_FILENO : redir->ionumber;
+        return heredoc_open(redir);
+    }
+    if (strcmp(redir->operator, "<") == 0)
+        return openat(dir_fd, redir->word, O_RDONLY | O_CLOEXEC);
+    if (strcmp(redir->operator, ">") == 0)
+        return openat(dir_fd, redir->word, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (strcmp(redir->operator, ">>") == 0)
+        return openat(dir_fd, redir->word, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    errno = EINVAL;
+    return -1;
+}
+
+int handle_redirections(struct command *cmd, int dir_fd)
 {
     int saved_fds[3];
     
@@ -25,43 +68,12 @@ int handle_redirections(struct command *cmd)
     for (int i = 0; i < cmd->redirections_count; i++)
     {
         struct redirection *redir = cmd->redirections[i];
-        int fd;
-        int target_fd = (redir->ionumber == -1) ? 
-            (strcmp(redir->operator, "<") == 0 ? STDIN_FILENO : STDOUT_FILENO) : 
-            redir->ionumber;
-            
-        if (strcmp(redir->operator, "<") == 0)
-        {
-            fd = open(redir->word, O_RDONLY);
-            if (fd == -1)
-            {
-                fprintf(stderr, "minishell: %s: No such file or directory\n", redir->word);
-                restore_redirections(saved_fds);
-                return 1;
-            }
-        }
-        else if (strcmp(redir->operator, ">") == 0)
-        {
-            fd = open(redir->word, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-            if (fd == -1)
-            {
-                perror("minishell");
-                restore_redirections(saved_fds);
-                return 1;
-            }
-        }
-        else if (strcmp(redir->operator, ">>") == 0)
-        {
-            fd = open(redir->word, O_WRONLY | O_CREAT | O_APPEND, 0644);
-            if (fd == -1)
-            {
-                perror("minishell");
-                restore_redirections(saved_fds);
-                return 1;
-            }
-        }
-        else
+        int target_fd;
+        int fd = open_redirection(redir, &target_fd, dir_fd);
+
+        if (fd == -1)
         {
+            fprintf(stderr, "minishell: %s: %s\n", redir->word, strerror(errno));
             restore_redirections(saved_fds);
             return 1;
         }
@@ -75,9 +87,61 @@ int handle_redirections(struct command *cmd)
         }
         close(fd);
     }
+    close(saved_fds[0]);
+    close(saved_fds[1]);
+    close(saved_fds[2]);
     return 0;
 }
 
+static void restore_shell_fds(struct exec_state *state, const int saved[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (state->fds[i] != saved[i])
+        {
+            close(state->fds[i]);
+            state->fds[i] = saved[i];
+        }
+    }
+}
+
+/* Redirections appliquées au shell lui-même (fonction, commande composée) :
+ * elles remplacent les fds standard de l'état, ceux du processus ne bougent
+ * pas. saved reçoit les fds à rétablir avec restore_shell_fds. */
+static int redirect_shell(struct command *cmd, struct exec_state *state, int saved[3])
+{
+    uint64_t start = stats_now();
+    int ret = 0;
+
+    memcpy(saved, state->fds, sizeof(state->fds));
+    for (int i = 0; i < cmd->redirections_count; i++)
+    {
+        struct redirection *redir = cmd->redirections[i];
+        int target_fd;
+        int fd = open_redirection(redir, &target_fd, state->cwd_fd);
+
+        if (fd == -1)
+        {
+            exec_error(state, "minishell: %s: %s\n", redir->word, strerror(errno));
+            restore_shell_fds(state, saved);
+            ret = 1;
+            break;
+        }
+        if (target_fd < 0 || target_fd > 2)
+        {
+            close(fd);
+            continue;
+        }
+        if (state->fds[target_fd] != saved[target_fd])
+            close(state->fds[target_fd]);
+        state->fds[target_fd] = fd;
+    }
+
+    state->stats.redirections += cmd->redirections_count;
+    state->stats.redirect_ns += stats_now() - start;
+    return ret;
+}
+
 void restore_redirections(int saved_fds[3])
 {
     dup2(saved_fds[0], STDIN_FILENO);
@@ -88,126 +152,355 @@ void restore_redirections(int saved_fds[3])
     close(saved_fds[2]);
 }
 
-static char *safe_strdup(const char *str)
+/* Redirections d'un builtin : appliquées à ses fds explicites, sans dup2 sur
+ * les fds du shell. */
+static int redirect_builtin_io(struct command *cmd, struct builtin_io *io)
 {
-    if (!str)
-        return NULL;
-    return strdup(str);
+    int *fds[3] = { &io->in_fd, &io->out_fd, &io->err_fd };
+
+    for (int i = 0; i < cmd->redirections_count; i++)
+    {
+        struct redirection *redir = cmd->redirections[i];
+        int target_fd;
+        int fd = open_redirection(redir, &target_fd, io->dir_fd);
+
+        if (fd == -1)
+        {
+            builtin_error(io, "minishell: %s: %s\n", redir->word, strerror(errno));
+            return 1;
+        }
+        if (target_fd < 0 || target_fd > 2)
+        {
+            close(fd);
+            continue;
+        }
+        *fds[target_fd] = fd;
+    }
+    return 0;
 }
 
-static int exec_external_command(struct command *cmd, struct exec_state *state)
+static void close_builtin_io(struct builtin_io *io, int in_fd, int out_fd, int err_fd)
 {
-    if (!cmd->name)
-        return 0;
+    if (io->in_fd != in_fd)
+        close(io->in_fd);
+    if (io->out_fd != out_fd)
+        close(io->out_fd);
+    if (io->err_fd != err_fd)
+        close(io->err_fd);
+}
 
-    char *full_path = NULL;
-    
-    if (cmd->name[0] == '/' || 
-        (cmd->name[0] == '.' && cmd->name[1] == '/') ||
-        (cmd->name[0] == '.' && cmd->name[1] == '.' && cmd->name[2] == '/'))
+static int run_builtin(const struct builtin *builtin, struct command *cmd,
+                       struct exec_state *state, int in_fd, int out_fd, int err_fd)
+{
+    struct builtin_io io;
+    int ret;
+
+    builtin_io_init(&io, in_fd, out_fd, err_fd);
+    io.dir_fd = state->cwd_fd;
+    if (out_fd == -1)
+        io.capture = state->capture;
+    if (err_fd == -1)
+        io.err_capture = state->capture_err;
+    state->stats.builtins++;
+    if (cmd->redirections_count > 0)
     {
-        full_path = safe_strdup(cmd->name);
+        uint64_t start = stats_now();
+        ret = redirect_builtin_io(cmd, &io);
+        state->stats.redirections += cmd->redirections_count;
+        state->stats.redirect_ns += stats_now() - start;
     }
     else
+        ret = 0;
+    if (ret == 0)
+    {
+        ret = builtin->fn(cmd->args, cmd->args_count, state, &io);
+        builtin_io_flush(&io);
+    }
+    close_builtin_io(&io, in_fd, out_fd, err_fd);
+    return ret;
+}
+
+static int wait_status(int status)
+{
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return 1;
+}
+
+/* waitpid, ou wait4 sous time pour relever l'usage du fils */
+static pid_t wait_child(pid_t pid, int *status, const char *name, struct exec_state *state)
+{
+    if (!state->timing)
+        return waitpid(pid, status, 0);
+
+    struct rusage usage;
+    pid_t ret = wait4(pid, status, 0, &usage);
+    if (ret != -1)
+        time_record(state->timing, name, pid, wait_status(*status), &usage);
+    return ret;
+}
+
+/* Sauvegarde la valeur courante d'une variable, sauf si elle l'est déjà
+ * depuis la sauvegarde d'indice from */
+int exec_save_local(struct exec_state *state, size_t from, const char *name, size_t name_len)
+{
+    struct local_stack *locals = &state->locals;
+
+    for (size_t i = from; i < locals->count; i++)
     {
-        char *path = getenv("PATH");
-        if (!path)
-            path = "/bin:/usr/bin";
+        if (locals->saves[i].name_len == name_len &&
+            memcmp(locals->text.data + locals->saves[i].name, name, name_len) == 0)
+            return 0;
+    }
+    if (locals->count == locals->capacity)
+    {
+        size_t capacity = locals->capacity ? 2 * locals->capacity : 16;
+        struct local_save *saves = realloc(locals->saves, sizeof(struct local_save) * capacity);
+        if (!saves)
+            return -1;
+        locals->saves = saves;
+        locals->capacity = capacity;
+    }
 
-        char *path_copy = safe_strdup(path);
-        char *dir = strtok(path_copy, ":");
-        
-        while (dir)
+    struct local_save *save = &locals->saves[locals->count];
+    const char *value = vars_get(state->vars, name, name_len);
+
+    save->name = locals->text.len;
+    save->name_len = name_len;
+    save->exported = vars_is_exported(state->vars, name, name_len);
+    if (strbuf_append(&locals->text, name, name_len) == -1 ||
+        strbuf_putc(&locals->text, '\0') == -1)
+        return -1;
+    save->value = SIZE_MAX;
+    if (value)
+    {
+        save->value = locals->text.len;
+        if (strbuf_append(&locals->text, value, strlen(value) + 1) == -1)
+            return -1;
+    }
+    locals->count++;
+    return 0;
+}
+
+/* Rétablit les variables sauvegardées depuis la sauvegarde d'indice count */
+static void restore_locals(struct exec_state *state, size_t count, size_t text_len)
+{
+    struct local_stack *locals = &state->locals;
+
+    while (locals->count > count)
+    {
+        struct local_save *save = &locals->saves[--locals->count];
+        const char *name = locals->text.data + save->name;
+
+        if (save->value == SIZE_MAX)
         {
-            char tmp[4096];
-            snprintf(tmp, sizeof(tmp), "%s/%s", dir, cmd->name);
-            if (access(tmp, X_OK) == 0)
-            {
-                full_path = safe_strdup(tmp);
-                break;
-            }
-            dir = strtok(NULL, ":");
+            vars_unset(state->vars, name, save->name_len);
+            continue;
         }
-        free(path_copy);
+        const char *value = locals->text.data + save->value;
+        if (vars_is_exported(state->vars, name, save->name_len) != save->exported)
+            vars_unset(state->vars, name, save->name_len);
+        vars_set(state->vars, name, save->name_len, value, strlen(value),
+                 save->exported ? VAR_EXPORT : 0);
     }
-    
+    locals->text.len = text_len;
+}
+
+/* Affectations en préfixe d'une fonction ou d'un builtin : elles ne valent
+ * que le temps de la commande */
+static void assign_temporary(struct command *cmd, struct exec_state *state, int flags)
+{
+    size_t from = state->locals.count;
+
+    for (int i = 0; i < cmd->assignments_count; i++)
+    {
+        const char *assignment = cmd->assignments[i];
+        size_t name_len = strchr(assignment, '=') - assignment;
+        if (exec_save_local(state, from, assignment, name_len) == 0)
+            vars_assign(state->vars, assignment, flags);
+    }
+}
+
+/* Appel sans fork : le corps, déjà analysé, s'exécute dans le shell avec
+ * un cadre pour ses paramètres positionnels et ses variables locales. */
+static int exec_function(struct function_def *function, struct command *cmd,
+                         struct exec_state *state)
+{
+    struct call_frame frame;
+    int ret;
+
+    if (state->call_depth >= FUNCTION_MAX_DEPTH)
+    {
+        exec_error(state, "minishell: %s: maximum function nesting level exceeded (%d)\n",
+                   cmd->name, FUNCTION_MAX_DEPTH);
+        return 1;
+    }
+
+    frame.params = cmd->args + 1;
+    frame.count = cmd->args_count - 1;
+    frame.locals = state->locals.count;
+    frame.locals_text = state->locals.text.len;
+    frame.prev = state->frame;
+
+    function->refs++;
+    state->frame = &frame;
+
+    assign_temporary(cmd, state, VAR_EXPORT);
+    state->call_depth++;
+    if (cmd->redirections_count > 0)
+    {
+        int saved_fds[3];
+        if (redirect_shell(cmd, state, saved_fds) != 0)
+            ret = 1;
+        else
+        {
+            ret = exec_ast(function->body, state);
+            restore_shell_fds(state, saved_fds);
+        }
+    }
+    else
+        ret = exec_ast(function->body, state);
+
+    if (state->returning)
+    {
+        state->returning = 0;
+        ret = state->return_status;
+    }
+    restore_locals(state, frame.locals, frame.locals_text);
+    state->call_depth--;
+    state->frame = frame.prev;
+    function_def_release(function);
+    state->last_return = ret;
+    return ret;
+}
+
+static int exec_external_command(struct command *cmd, struct exec_state *state,
+                                 char **envp)
+{
+    int in_place = state->exec_in_place;
+
+    state->exec_in_place = 0;
+    if (!cmd->name)
+        return 0;
+
+    struct function_def *function = functions_lookup(state->functions, cmd->name);
+    if (function)
+        return exec_function(function, cmd, state);
+
+    const char *full_path = cmd->name;
+    if (!(cmd->name[0] == '/' ||
+          (cmd->name[0] == '.' && cmd->name[1] == '/') ||
+          (cmd->name[0] == '.' && cmd->name[1] == '.' && cmd->name[2] == '/')))
+    {
+        uint64_t start = stats_now();
+        const char *path = vars_get(state->vars, "PATH", 4);
+        full_path = path_search(&state->paths, path ? path : "/bin:/usr/bin", cmd->name,
+                                state->cwd_fd, &state->stats.path_probes);
+        state->stats.path_ns += stats_now() - start;
+    }
+
     if (!full_path)
     {
-        fprintf(stderr, "minishell: %s: command not found\n", cmd->name);
+        exec_error(state, "minishell: %s: command not found\n", cmd->name);
         state->last_return = 127;
         return 127;
     }
 
-    pid_t pid = fork();
+    uint64_t start = stats_now();
+    pid_t pid = in_place ? 0 : fork();
     if (pid == -1)
     {
-        perror("minishell: fork");
-        free(full_path);
+        exec_error(state, "minishell: fork: %s\n", strerror(errno));
         state->last_return = 1;
         return 1;
     }
         
     if (pid == 0)
     {
-        if (handle_redirections(cmd) != 0)
-            exit(1);
+        exec_enter_child(state);
+        /* Les /dev/fd/N des substitutions de processus survivent à execve */
+        for (size_t i = 0; i < state->procsubs.count; i++)
+            fcntl(state->procsubs.subs[i].fd, F_SETFD, 0);
+        if (handle_redirections(cmd, AT_FDCWD) != 0)
+            _exit(1);
+        if (trace_enabled())
+            trace_span(TRACE_CHILD, cmd->name, start, cmd->redirections_count);
             
-        execv(full_path, cmd->args);
+        execve(full_path, cmd->args, envp);
         
+        /* Dans le fils, 2 est déjà l'erreur de l'état (exec_enter_child) */
         if (errno == EACCES)
         {
             fprintf(stderr, "minishell: %s: Permission denied\n", cmd->name);
-            exit(126);
+            _exit(126);
         }
         fprintf(stderr, "minishell: %s: command not found\n", cmd->name);
-        exit(127);
+        _exit(127);
     }
     
-    free(full_path);
+    /* Les redirections d'une commande externe se font dans le fils */
+    state->stats.fork_ns += stats_now() - start;
+    state->stats.forks++;
+    state->stats.execs++;
+    state->stats.redirections += cmd->redirections_count;
+    if (trace_enabled())
+        trace_span(TRACE_FORK, cmd->name, start, pid);
+    start = stats_now();
     int status;
-    waitpid(pid, &status, 0);
-    state->last_return = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+    wait_child(pid, &status, cmd->name, state);
+    state->stats.wait_ns += stats_now() - start;
+    state->last_return = wait_status(status);
+    if (trace_enabled())
+        trace_span(TRACE_WAIT, cmd->name, start, state->last_return);
     return state->last_return;
 }
 
+/* Les affectations seules modifient la table des variables ; en préfixe
+ * d'une commande, elles ne valent que pour l'environnement de celle-ci. */
 static int exec_command_with_env(struct command *cmd, struct exec_state *state)
 {
-    char **old_env = environ;
-    int ret;
-
-    if (!cmd->name && cmd->assignments_count > 0)
+    if (!cmd->name)
     {
         for (int i = 0; i < cmd->assignments_count; i++)
         {
-            char *assignment = safe_strdup(cmd->assignments[i]);
-            putenv(assignment);
+            if (vars_assign(state->vars, cmd->assignments[i], 0) == -1)
+                return 1;
         }
-        return 0;
+        /* Statut de la dernière substitution, rangé par command_substitute */
+        return state->substituted ? state->last_return : 0;
     }
 
-    if (cmd->assignments_count > 0)
-    {
-        char **new_env = malloc(sizeof(char *) * (cmd->assignments_count + 1));
-        for (int i = 0; i < cmd->assignments_count; i++)
-        {
-            new_env[i] = safe_strdup(cmd->assignments[i]);
-        }
-        new_env[cmd->assignments_count] = NULL;
-        environ = new_env;
-    }
+    char **envp = vars_envp(state->vars);
+    if (cmd->assignments_count == 0)
+        return exec_external_command(cmd, state, envp);
 
-    ret = exec_external_command(cmd, state);
+    size_t count = 0;
+    while (envp[count])
+        count++;
 
-    if (cmd->assignments_count > 0)
+    char **new_env = malloc(sizeof(char *) * (count + cmd->assignments_count + 1));
+    if (!new_env)
+        return 1;
+
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++)
     {
-        for (int i = 0; i < cmd->assignments_count; i++)
-        {
-            free(environ[i]);
-        }
-        free(environ);
-        environ = old_env;
+        const char *equal = strchr(envp[i], '=');
+        size_t name_len = equal ? (size_t)(equal - envp[i] + 1) : strlen(envp[i]);
+        int overridden = 0;
+        for (int j = 0; j < cmd->assignments_count && !overridden; j++)
+            overridden = strncmp(envp[i], cmd->assignments[j], name_len) == 0;
+        if (!overridden)
+            new_env[n++] = envp[i];
     }
+    for (int i = 0; i < cmd->assignments_count; i++)
+        new_env[n++] = cmd->assignments[i];
+    new_env[n] = NULL;
 
+    int ret = exec_external_command(cmd, state, new_env);
+    free(new_env);
     return ret;
 }
 
@@ -217,71 +510,533 @@ struct exec_state *exec_init(char **env)
     if (!state)
         return NULL;
         
-    state->env = env;
+    state->name = "minishell";
+    state->vars = vars_init(env);
+    if (!state->vars)
+    {
+        free(state);
+        return NULL;
+    }
+    state->fds[0] = STDIN_FILENO;
+    state->fds[1] = STDOUT_FILENO;
+    state->fds[2] = STDERR_FILENO;
+    state->cwd_fd = AT_FDCWD;
+    state->shell_pid = 0;
+    state->last_bg_pid = 0;
     state->last_return = 0;
+    state->substituted = 0;
+    state->exec_in_place = 0;
     state->should_exit = 0;
     state->exit_code = 0;
-    
+    state->options = 0;
+    state->capture = NULL;
+    state->capture_err = NULL;
+    state->globs = NULL;
+    state->loop_depth = 0;
+    state->break_levels = 0;
+    state->continuing = 0;
+    state->functions = NULL;
+    state->toplevel.params = NULL;
+    state->toplevel.count = 0;
+    state->toplevel.locals = 0;
+    state->toplevel.locals_text = 0;
+    state->toplevel.prev = NULL;
+    state->frame = &state->toplevel;
+    state->call_depth = 0;
+    state->returning = 0;
+    state->return_status = 0;
+    memset(&state->locals, 0, sizeof(state->locals));
+    memset(&state->procsubs, 0, sizeof(state->procsubs));
+    state->reads = NULL;
+    state->paths = NULL;
+    memset(&state->stats, 0, sizeof(state->stats));
+    state->input_line = 1;
+    state->line = 0;
+    state->profile = NULL;
+    state->timing = NULL;
+    state->input = NULL;
     return state;
 }
 
 void exec_free(struct exec_state *state)
 {
     if (state)
+    {
+        input_cache_free(state->input);
+        vars_free(state->vars);
+        glob_cache_free(state->globs);
+        functions_free(state->functions);
+        read_cache_free(state->reads);
+        path_cache_free(state->paths);
+        profile_finish(state->profile, NULL);
+        free(state->locals.saves);
+        strbuf_free(&state->locals.text);
+        exec_release_procsubs(state, 0);
+        free(state->procsubs.subs);
+        if (state->cwd_fd != AT_FDCWD)
+            close(state->cwd_fd);
         free(state);
+    }
+}
+
+int exec_own_cwd(struct exec_state *state)
+{
+    int fd = openat(state->cwd_fd, ".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    if (state->cwd_fd != AT_FDCWD)
+        close(state->cwd_fd);
+    state->cwd_fd = fd;
+    return 0;
+}
+
+/* Le chemin d'un fd de répertoire se lit dans /proc, sans fchdir qui
+ * changerait celui du processus pour tous les threads */
+char *exec_getcwd(const struct exec_state *state, char *buf, size_t size)
+{
+    if (state->cwd_fd == AT_FDCWD)
+        return getcwd(buf, size);
+
+    char link[64];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", state->cwd_fd);
+    ssize_t n = readlink(link, buf, size);
+    if (n == -1)
+        return NULL;
+    if ((size_t)n == size)
+    {
+        errno = ERANGE;
+        return NULL;
+    }
+    buf[n] = '\0';
+    return buf;
+}
+
+void exec_write_err(struct exec_state *state, const char *data, size_t len)
+{
+    if (state->fds[2] == -1)
+    {
+        if (state->capture_err)
+            strbuf_append(state->capture_err, data, len);
+        return;
+    }
+    while (len > 0)
+    {
+        ssize_t n = write(state->fds[2], data, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        data += n;
+        len -= n;
+    }
+}
+
+void exec_error(struct exec_state *state, const char *fmt, ...)
+{
+    char msg[BUFFER_SIZE];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int len = vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    if (len < 0)
+        return;
+    if ((size_t)len >= sizeof(msg))
+        len = sizeof(msg) - 1;
+    exec_write_err(state, msg, len);
+}
+
+void exec_release_procsubs(struct exec_state *state, size_t mark)
+{
+    struct process_subs *procsubs = &state->procsubs;
+
+    for (size_t i = mark; i < procsubs->count; i++)
+        close(procsubs->subs[i].fd);
+    for (size_t i = mark; i < procsubs->count; i++)
+    {
+        while (waitpid(procsubs->subs[i].pid, NULL, 0) == -1 && errno == EINTR)
+            continue;
+    }
+    if (procsubs->count > mark)
+        procsubs->count = mark;
+}
+
+void exec_enter_child(struct exec_state *state)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (state->fds[i] != i && state->fds[i] != -1)
+            dup2(state->fds[i], i);
+        state->fds[i] = i;
+    }
+    if (state->cwd_fd != AT_FDCWD && fchdir(state->cwd_fd) == 0)
+    {
+        close(state->cwd_fd);
+        state->cwd_fd = AT_FDCWD;
+    }
+}
+
+/* Ouverte quand tous les étages sont lancés : un thread ne ferme ses fds
+ * qu'ensuite, aucun fork ne pouvant plus alors hériter de ces numéros */
+struct stage_gate {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int open;
+};
+
+struct pipeline_stage {
+    struct ast_node *node;
+    const struct builtin *builtin;
+    int in_fd;
+    int out_fd;
+    pid_t pid;
+    pthread_t thread;
+    int threaded;
+    int status;
+    const cpu_set_t *cpus;      /* PIPECPUS : NULL si l'étage reste libre */
+    struct stage_gate *gate;
+    struct strbuf err;          /* erreurs capturées, ajoutées après le join */
+    uint64_t started;           /* stats_now() au fork, pour blk% */
+    struct exec_state state;
+};
+
+static size_t count_pipeline_stages(struct ast_node *node)
+{
+    size_t count = 1;
+
+    while (node->type == NODE_PIPELINE)
+    {
+        count++;
+        node = node->data.binary.left;
+    }
+    return count;
+}
+
+/* Un étage peut tourner en thread s'il s'agit d'un builtin qui ne touche qu'à
+ * ses propres fds (pas de cd, pas de set). Sous time, chaque étage est un
+ * processus pour avoir son propre rusage. */
+static const struct builtin *stage_thread_builtin(struct ast_node *node,
+                                                  struct exec_state *state)
+{
+    if (!(state->options & OPT_PIPETHREADS) || state->timing ||
+        node->type != NODE_COMMAND || node->data.command->flags)
+        return NULL;
+
+    const struct builtin *builtin = builtin_lookup(node->data.command->name);
+    if (!builtin || !(builtin->flags & BUILTIN_THREAD_SAFE))
+        return NULL;
+    return builtin;
+}
+
+static void *pipeline_stage_thread(void *arg)
+{
+    struct pipeline_stage *stage = arg;
+    sigset_t set;
+
+    /* EPIPE plutôt qu'un SIGPIPE qui tuerait tout le shell */
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    alloc_enter(ALLOC_EXEC);
+    alloc_use(stage->state.stats.allocs);
+    if (stage->cpus)
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), stage->cpus);
+
+    uint64_t start = stats_now();
+    stage->status = run_builtin(stage->builtin, stage->node->data.command, &stage->state,
+                                stage->in_fd, stage->out_fd, stage->state.fds[2]);
+    if (trace_enabled())
+        trace_span(TRACE_EXEC, stage->builtin->name, start, stage->status);
+
+    /* Ses bouts de pipe sont à lui une fois la porte ouverte : le parent les
+     * a retirés de pipes[] et ne les fermera pas */
+    pthread_mutex_lock(&stage->gate->lock);
+    while (!stage->gate->open)
+        pthread_cond_wait(&stage->gate->cond, &stage->gate->lock);
+    pthread_mutex_unlock(&stage->gate->lock);
+    if (stage->in_fd != stage->state.fds[0])
+        close(stage->in_fd);
+    if (stage->out_fd != stage->state.fds[1])
+        close(stage->out_fd);
+    return NULL;
+}
+
+static void close_pipes(int *pipes, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (pipes[i] != -1)
+            close(pipes[i]);
+    }
+}
+
+static void fork_pipeline_stage(struct pipeline_stage *stage, int *pipes, size_t pipe_count,
+                                struct exec_state *state)
+{
+    exec_shell_pid(state);
+    uint64_t start = stats_now();
+    stage->pid = fork();
+    stage->started = start;
+    if (stage->pid != 0)
+    {
+        state->stats.fork_ns += stats_now() - start;
+        state->stats.forks += stage->pid > 0;
+        if (trace_enabled())
+            trace_span(TRACE_FORK, "pipeline stage", start, stage->pid);
+        return;
+    }
+
+    exec_enter_child(state);
+    if (stage->cpus)
+        sched_setaffinity(0, sizeof(cpu_set_t), stage->cpus);
+    if (stage->in_fd != STDIN_FILENO)
+        dup2(stage->in_fd, STDIN_FILENO);
+    if (stage->out_fd != STDOUT_FILENO && stage->out_fd != -1)
+        dup2(stage->out_fd, STDOUT_FILENO);
+    close_pipes(pipes, pipe_count);
+    state->capture = NULL;
+    state->capture_err = NULL;
+
+    /* Une commande simple s'exécute dans l'étage même, sans second fork :
+     * le pid attendu et relevé par time est celui de la commande */
+    state->exec_in_place = stage->node->type == NODE_COMMAND;
+
+    /* _exit : un exit() viderait les tampons stdio hérités, dont celui du
+     * script en cours de lecture, et déplacerait son offset partagé. */
+    _exit(exec_ast(stage->node, state));
+}
+
+static const char *node_name(const struct ast_node *node);
+
+/* Sous time : un pidfd par étage, le shell dort dans poll jusqu'à la fin
+ * d'un étage. Le pidfd devient lisible quand l'étage est zombie, avant
+ * wait4 : son schedstat est encore lisible et donne son temps bloqué
+ * (pipes.h). Renvoie -1 sans pidfd ou si la mémoire manque, rien n'étant
+ * alors attendu. */
+static int wait_timed(struct pipeline_stage *stages, size_t count, struct exec_state *state)
+{
+#ifdef SYS_pidfd_open
+    struct pollfd *fds = calloc(count, sizeof(struct pollfd));
+    struct rusage *usages = calloc(count, sizeof(struct rusage));
+    struct pipe_stall *stalls = calloc(count, sizeof(struct pipe_stall));
+    size_t remaining = 0;
+    int opened = fds && usages && stalls;
+
+    for (size_t i = 0; opened && i < count; i++)
+        fds[i].fd = -1;
+    for (size_t i = 0; opened && i < count; i++)
+    {
+        fds[i].events = POLLIN;
+        stages[i].status = 1;
+        if (stages[i].pid <= 0)
+            continue;
+        fds[i].fd = syscall(SYS_pidfd_open, stages[i].pid, 0);
+        opened = fds[i].fd != -1;
+        remaining += opened;
+    }
+    if (!opened)
+    {
+        for (size_t i = 0; fds && i < count; i++)
+        {
+            if (fds[i].fd != -1)
+                close(fds[i].fd);
+        }
+        free(fds);
+        free(usages);
+        free(stalls);
+        return -1;
+    }
+
+    while (remaining > 0)
+    {
+        /* Si poll échoue, les étages restants sont attendus sans relevé */
+        int polled = poll(fds, count, -1);
+        if (polled == -1 && errno == EINTR)
+            continue;
+        for (size_t i = 0; i < count; i++)
+        {
+            int status;
+            if (fds[i].fd == -1 || (polled != -1 && !(fds[i].revents & POLLIN)))
+                continue;
+            if (polled != -1)
+                pipe_stall_read(stages[i].pid, stats_now() - stages[i].started, &stalls[i]);
+            pid_t pid;
+            do
+                pid = wait4(stages[i].pid, &status, 0, &usages[i]);
+            while (pid == -1 && errno == EINTR);
+            stages[i].status = pid > 0 ? wait_status(status) : 1;
+            close(fds[i].fd);
+            fds[i].fd = -1;
+            remaining--;
+        }
+    }
+
+    /* Relevés dans l'ordre du pipeline, pas dans celui des fins */
+    for (size_t i = 0; i < count; i++)
+    {
+        if (stages[i].pid <= 0)
+            continue;
+        time_record(state->timing, node_name(stages[i].node), stages[i].pid,
+                    stages[i].status, &usages[i]);
+        time_record_stall(state->timing, &stalls[i]);
+    }
+    free(fds);
+    free(usages);
+    free(stalls);
+    return 0;
+#else
+    (void)stages;
+    (void)count;
+    (void)state;
+    return -1;
+#endif
 }
 
 int exec_pipeline(struct ast_node *node, struct exec_state *state)
 {
     if (node->type != NODE_PIPELINE)
         return exec_command(node->data.command, state);
-        
-    int pipefd[2];
-    if (pipe(pipefd) == -1)
-        return 1;
-        
-    pid_t pid1 = fork();
-    if (pid1 == -1)
+
+    size_t count = count_pipeline_stages(node);
+    size_t pipe_count = 2 * (count - 1);
+    struct pipeline_stage *stages = calloc(count, sizeof(struct pipeline_stage));
+    int *pipes = malloc(sizeof(int) * pipe_count);
+    if (!stages || !pipes)
     {
-        close(pipefd[0]);
-        close(pipefd[1]);
+        free(stages);
+        free(pipes);
         return 1;
     }
-    
-    if (pid1 == 0)
+
+    for (size_t i = count; i > 0; i--)
     {
-        close(pipefd[0]);
-        dup2(pipefd[1], STDOUT_FILENO);
-        close(pipefd[1]);
-        
-        exit(exec_ast(node->data.binary.left, state));
+        if (node->type == NODE_PIPELINE)
+        {
+            stages[i - 1].node = node->data.binary.right;
+            node = node->data.binary.left;
+        }
+        else
+            stages[i - 1].node = node;
     }
-    
-    pid_t pid2 = fork();
-    if (pid2 == -1)
+
+    long capacity = pipe_capacity(vars_get(state->vars, "PIPESIZE", 8));
+    for (size_t i = 0; i < pipe_count; i += 2)
     {
-        close(pipefd[0]);
-        close(pipefd[1]);
-        return 1;
+        if (pipe2(pipes + i, O_CLOEXEC) == -1)
+        {
+            exec_error(state, "minishell: pipe: %s\n", strerror(errno));
+            close_pipes(pipes, i);
+            free(pipes);
+            free(stages);
+            return 1;
+        }
+        if (capacity > 0)
+            fcntl(pipes[i + 1], F_SETPIPE_SZ, (int)capacity);
     }
-    
-    if (pid2 == 0)
+
+    /* Placement : un CPU_SET par étage, appliqué par l'étage lui-même */
+    const char *cpus = vars_get(state->vars, "PIPECPUS", 8);
+    cpu_set_t *placement = cpus && *cpus ? malloc(count * sizeof(cpu_set_t)) : NULL;
+    if (placement && pipe_placement(cpus, placement, count) == 0)
     {
-        close(pipefd[1]);
-        dup2(pipefd[0], STDIN_FILENO);
-        close(pipefd[0]);
-        
-        exit(exec_ast(node->data.binary.right, state));
+        free(placement);
+        placement = NULL;
     }
-    
-    close(pipefd[0]);
-    close(pipefd[1]);
-    
-    int status1, status2;
-    waitpid(pid1, &status1, 0);
-    waitpid(pid2, &status2, 0);
-    
-    return WEXITSTATUS(status2);
+
+    int timed = state->timing != NULL;
+    struct stage_gate gate = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0 };
+
+    for (size_t i = 0; i < count; i++)
+    {
+        struct pipeline_stage *stage = &stages[i];
+
+        stage->in_fd = i > 0 ? pipes[2 * (i - 1)] : state->fds[0];
+        stage->out_fd = i < count - 1 ? pipes[2 * i + 1] : state->fds[1];
+        stage->builtin = stage_thread_builtin(stage->node, state);
+        if (placement && CPU_COUNT(&placement[i]) > 0)
+            stage->cpus = &placement[i];
+
+        if (stage->builtin && vars_load(state->vars) == -1)
+            stage->builtin = NULL;
+        if (stage->builtin)
+        {
+            /* Seul le dernier étage écrit dans la capture ; les erreurs
+             * de plusieurs threads ne peuvent pas s'y ajouter ensemble :
+             * chacun a son tampon, versé dans capture_err après le join */
+            stage->state = *state;
+            stage->state.capture = stage->out_fd == -1 ? state->capture : NULL;
+            stage->state.capture_err = state->capture_err ? &stage->err : NULL;
+            memset(&stage->state.stats, 0, sizeof(stage->state.stats));
+            stage->gate = &gate;
+            stage->threaded = pthread_create(&stage->thread, NULL,
+                                             pipeline_stage_thread, stage) == 0;
+        }
+        if (!stage->threaded)
+        {
+            fork_pipeline_stage(stage, pipes, pipe_count, state);
+            if (stage->pid == -1)
+                exec_error(state, "minishell: fork: %s\n", strerror(errno));
+            if (i > 0)
+            {
+                close(pipes[2 * (i - 1)]);
+                pipes[2 * (i - 1)] = -1;
+            }
+            if (i < count - 1)
+            {
+                close(pipes[2 * i + 1]);
+                pipes[2 * i + 1] = -1;
+            }
+        }
+    }
+
+    /* Tous les forks sont faits : les threads deviennent seuls propriétaires
+     * de leurs bouts de pipe, que le parent oublie */
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!stages[i].threaded)
+            continue;
+        if (i > 0)
+            pipes[2 * (i - 1)] = -1;
+        if (i < count - 1)
+            pipes[2 * i + 1] = -1;
+    }
+    pthread_mutex_lock(&gate.lock);
+    gate.open = 1;
+    pthread_cond_broadcast(&gate.cond);
+    pthread_mutex_unlock(&gate.lock);
+
+    uint64_t start = stats_now();
+    if (timed && wait_timed(stages, count, state) == -1)
+        timed = 0;
+    for (size_t i = 0; !timed && i < count; i++)
+    {
+        int status;
+
+        if (stages[i].threaded)
+        {
+            pthread_join(stages[i].thread, NULL);
+            stats_add(&state->stats, &stages[i].state.stats);
+            if (stages[i].err.len > 0)
+                strbuf_append(state->capture_err, stages[i].err.data, stages[i].err.len);
+            strbuf_free(&stages[i].err);
+        }
+        else if (stages[i].pid > 0 &&
+                 wait_child(stages[i].pid, &status, node_name(stages[i].node), state) != -1)
+            stages[i].status = wait_status(status);
+        else
+            stages[i].status = 1;
+    }
+    state->stats.wait_ns += stats_now() - start;
+    if (trace_enabled())
+        trace_span(TRACE_WAIT, "pipeline", start, stages[count - 1].status);
+
+    int ret = stages[count - 1].status;
+    pthread_cond_destroy(&gate.cond);
+    pthread_mutex_destroy(&gate.lock);
+    free(placement);
+    free(pipes);
+    free(stages);
+    return ret;
 }
 
 int exec_and_or(struct ast_node *node, struct exec_state *state)
@@ -291,6 +1046,8 @@ int exec_and_or(struct ast_node *node, struct exec_state *state)
         
     int left_status = exec_ast(node->data.binary.left, state);
     state->last_return = left_status;
+    if (exec_interrupted(state))
+        return left_status;
     
     if (strcmp(node->data.binary.operator, "&&") == 0)
     {
@@ -306,33 +1063,285 @@ int exec_and_or(struct ast_node *node, struct exec_state *state)
     }
 }
 
+/* Après le corps d'une boucle : vrai s'il faut en sortir. Un break n ou un
+ * continue n remonte n niveaux de boucles, le continue reprenant la boucle
+ * du dernier niveau. */
+static int loop_should_stop(struct exec_state *state)
+{
+    if (state->should_exit || state->returning)
+        return 1;
+    if (!state->break_levels)
+        return 0;
+    if (state->break_levels == 1 && state->continuing)
+    {
+        state->break_levels = 0;
+        state->continuing = 0;
+        return 0;
+    }
+    if (--state->break_levels == 0)
+        state->continuing = 0;
+    return 1;
+}
+
+static int exec_loop(struct compound *compound, int until, struct exec_state *state)
+{
+    int ret = 0;
+
+    state->loop_depth++;
+    for (;;)
+    {
+        int condition = exec_ast(compound->condition, state);
+        if (loop_should_stop(state) || (condition == 0) == until)
+            break;
+        ret = exec_ast(compound->body, state);
+        if (loop_should_stop(state))
+            break;
+    }
+    state->loop_depth--;
+    return ret;
+}
+
+/* La variable est mise à jour sur place à chaque tour : pas d'allocation
+ * tant que les valeurs tiennent dans son entrée. */
+static int exec_for(struct compound *compound, struct command *words, struct exec_state *state)
+{
+    const char *name = compound->variable;
+    size_t name_len = strlen(name);
+    char **values = words->args;
+    int count = words->args_count;
+    int ret = 0;
+
+    /* Sans in : les paramètres positionnels, tels qu'au début de la boucle */
+    if (!compound->has_words)
+    {
+        values = state->frame->params;
+        count = state->frame->count;
+    }
+
+    state->loop_depth++;
+    for (int i = 0; i < count; i++)
+    {
+        if (vars_set(state->vars, name, name_len, values[i], strlen(values[i]), 0) == -1)
+        {
+            ret = 1;
+            break;
+        }
+        ret = exec_ast(compound->body, state);
+        if (loop_should_stop(state))
+            break;
+    }
+    state->loop_depth--;
+    return ret;
+}
+
+int exec_compound(struct ast_node *node, struct exec_state *state)
+{
+    struct compound *compound = node->data.compound;
+    struct command *cmd = compound->command;
+    struct command *run = cmd;
+    size_t procsubs = state->procsubs.count;
+    int saved_fds[3];
+    int ret;
+
+    if (cmd->flags)
+    {
+        enum alloc_phase phase = alloc_enter(ALLOC_EXPAND);
+        run = expand_command(cmd, state);
+        alloc_enter(phase);
+        if (!run)
+        {
+            exec_release_procsubs(state, procsubs);
+            return 1;
+        }
+    }
+
+    /* Les redirections valent pour toute la commande, dans le shell même */
+    if (run->redirections_count > 0)
+    {
+        if (redirect_shell(run, state, saved_fds) != 0)
+        {
+            if (run != cmd)
+                expand_command_release(cmd, run);
+            exec_release_procsubs(state, procsubs);
+            return 1;
+        }
+    }
+
+    switch (node->type)
+    {
+        case NODE_IF:
+            ret = exec_ast(compound->condition, state);
+            if (exec_interrupted(state))
+                break;
+            if (ret == 0)
+                ret = exec_ast(compound->body, state);
+            else
+                ret = compound->else_branch ? exec_ast(compound->else_branch, state) : 0;
+            break;
+        case NODE_WHILE:
+        case NODE_UNTIL:
+            ret = exec_loop(compound, node->type == NODE_UNTIL, state);
+            break;
+        case NODE_GROUP:
+            ret = exec_ast(compound->body, state);
+            break;
+        case NODE_CASE:
+        {
+            int arm = case_matcher_match(compound->matcher, run->args[0], run->args);
+            ret = arm >= 0 ? exec_ast(compound->arms[arm], state) : 0;
+            break;
+        }
+        default:
+            ret = exec_for(compound, run, state);
+            break;
+    }
+
+    if (run->redirections_count > 0)
+        restore_shell_fds(state, saved_fds);
+    if (run != cmd)
+        expand_command_release(cmd, run);
+    exec_release_procsubs(state, procsubs);
+    return ret;
+}
+
+static int exec_simple_command(struct command *cmd, struct exec_state *state);
+
+/* La ligne de la commande sert aux substitutions qu'elle contient et au
+ * profil, qui lui attribue le temps passé ici */
 int exec_command(struct command *cmd, struct exec_state *state)
 {
+    state->line = cmd->line;
+    if (!state->profile)
+        return exec_simple_command(cmd, state);
+
+    profile_enter(state->profile, cmd->line, cmd->name ? cmd->name : "(assignment)",
+                  state->stats.forks);
+    int ret = exec_simple_command(cmd, state);
+    profile_leave(state->profile, state->stats.forks);
+    return ret;
+}
+
+static int exec_simple_command(struct command *cmd, struct exec_state *state)
+{
+    struct command *run = cmd;
+    size_t procsubs = state->procsubs.count;
+    int in_place = state->exec_in_place;
     int ret;
 
-    if (is_builtin(cmd->name))
+    /* Les substitutions de l'expansion ne doivent pas remplacer l'étage */
+    state->exec_in_place = 0;
+    state->substituted = 0;
+    if (cmd->flags)
     {
-        if (strcmp(cmd->name, "echo") == 0)
-            ret = builtin_echo(cmd->args, cmd->args_count, state);
-        else if (strcmp(cmd->name, "cd") == 0)
-            ret = builtin_cd(cmd->args, cmd->args_count, state);
-        else if (strcmp(cmd->name, "exit") == 0)
-            ret = builtin_exit(cmd->args, cmd->args_count, state);
-        else if (strcmp(cmd->name, "kill") == 0)
-            ret = builtin_kill(cmd->args, cmd->args_count, state);
-        else
-            ret = 1;
+        enum alloc_phase phase = alloc_enter(ALLOC_EXPAND);
+        run = expand_command(cmd, state);
+        alloc_enter(phase);
+        if (!run)
+        {
+            exec_release_procsubs(state, procsubs);
+            state->last_return = 1;
+            return 1;
+        }
+        if (state->profile)
+            profile_name(state->profile, run->name ? run->name : "(assignment)");
     }
+
+    const struct builtin *builtin = builtin_lookup(run->name);
+    if (builtin && run->assignments_count > 0)
+    {
+        size_t locals = state->locals.count;
+        size_t text_len = state->locals.text.len;
+
+        assign_temporary(run, state, 0);
+        ret = run_builtin(builtin, run, state, state->fds[0], state->fds[1], state->fds[2]);
+        restore_locals(state, locals, text_len);
+    }
+    else if (builtin)
+        ret = run_builtin(builtin, run, state, state->fds[0], state->fds[1], state->fds[2]);
     else
     {
-        ret = exec_command_with_env(cmd, state);
+        state->exec_in_place = in_place;
+        ret = exec_command_with_env(run, state);
     }
 
+    if (run != cmd)
+        expand_command_release(cmd, run);
+    exec_release_procsubs(state, procsubs);
     state->last_return = ret;
     return ret;
 }
 
+static const char *const node_names[] = {
+    [NODE_COMMAND] = "command",
+    [NODE_PIPELINE] = "pipeline",
+    [NODE_AND_OR] = "and_or",
+    [NODE_SEQUENCE] = "sequence",
+    [NODE_REDIRECTION] = "redirection",
+    [NODE_ASSIGNMENT] = "assignment",
+    [NODE_IF] = "if",
+    [NODE_WHILE] = "while",
+    [NODE_UNTIL] = "until",
+    [NODE_FOR] = "for",
+    [NODE_GROUP] = "group",
+    [NODE_CASE] = "case",
+    [NODE_FUNCTION] = "function",
+    [NODE_NOT] = "not",
+    [NODE_TIME] = "time",
+};
+
+static const char *node_name(const struct ast_node *node)
+{
+    if (node->type == NODE_COMMAND && node->data.command->name)
+        return node->data.command->name;
+    return node_names[node->type];
+}
+
+static int exec_node(struct ast_node *node, struct exec_state *state);
+
+/* time : les mesures imbriquées ne vont qu'au time le plus proche */
+static int exec_time(struct ast_node *node, struct exec_state *state)
+{
+    const char *option = node->data.binary.operator;
+    int format = !option ? TIME_FORMAT_DEFAULT
+               : option[1] == 'p' ? TIME_FORMAT_POSIX : TIME_FORMAT_JSON;
+    struct time_report *outer = state->timing;
+    struct time_report report;
+
+    time_begin(&report);
+    state->timing = &report;
+    int ret = exec_ast(node->data.binary.left, state);
+    state->timing = outer;
+
+    /* Le rapport est formaté en mémoire puis écrit sur l'erreur de l'état */
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    if (out)
+    {
+        time_end(&report, format, out);
+        fclose(out);
+        exec_write_err(state, text, len);
+        free(text);
+    }
+    else
+        time_end(&report, format, stderr);
+    return ret;
+}
+
+/* Chaque nœud exécuté est un span de la trace, nommé d'après la commande
+ * pour une commande simple */
 int exec_ast(struct ast_node *node, struct exec_state *state)
+{
+    if (!node || !trace_enabled())
+        return exec_node(node, state);
+
+    uint64_t start = stats_now();
+    int ret = exec_node(node, state);
+    trace_span(TRACE_EXEC, node_name(node), start, ret);
+    return ret;
+}
+
+static int exec_node(struct ast_node *node, struct exec_state *state)
 {
     if (!node)
         return 0;
@@ -342,23 +1351,7 @@ int exec_ast(struct ast_node *node, struct exec_state *state)
     switch (node->type)
     {
         case NODE_COMMAND:
-            if (is_builtin(node->data.command->name))
-            {
-                if (strcmp(node->data.command->name, "echo") == 0)
-                    ret = builtin_echo(node->data.command->args, node->data.command->args_count, state);
-                else if (strcmp(node->data.command->name, "cd") == 0)
-                    ret = builtin_cd(node->data.command->args, node->data.command->args_count, state);
-                else if (strcmp(node->data.command->name, "exit") == 0)
-                    ret = builtin_exit(node->data.command->args, node->data.command->args_count, state);
-                else if (strcmp(node->data.command->name, "kill") == 0)
-                    ret = builtin_kill(node->data.command->args, node->data.command->args_count, state);
-                else
-                    ret = 1;
-            }
-            else
-                ret = exec_command_with_env(node->data.command, state);
-            state->last_return = ret;
-            return ret;
+            return exec_command(node->data.command, state);
         case NODE_PIPELINE:
             ret = exec_pipeline(node, state);
             state->last_return = ret;
@@ -368,8 +1361,33 @@ int exec_ast(struct ast_node *node, struct exec_state *state)
             state->last_return = ret;
             return ret;
         case NODE_SEQUENCE:
-            exec_ast(node->data.binary.left, state);
-            ret = exec_ast(node->data.binary.right, state);
+            ret = exec_ast(node->data.binary.left, state);
+            if (!exec_interrupted(state))
+                ret = exec_ast(node->data.binary.right, state);
+            state->last_return = ret;
+            return ret;
+        case NODE_NOT:
+            ret = !exec_ast(node->data.binary.left, state);
+            state->last_return = ret;
+            return ret;
+        case NODE_TIME:
+            ret = exec_time(node, state);
+            state->last_return = ret;
+            return ret;
+        case NODE_FUNCTION:
+            if (!state->functions)
+                state->functions = calloc(1, sizeof(struct function_table));
+            ret = !state->functions ||
+                  functions_define(state->functions, node->data.function) == -1;
+            state->last_return = ret;
+            return ret;
+        case NODE_IF:
+        case NODE_WHILE:
+        case NODE_UNTIL:
+        case NODE_FOR:
+        case NODE_GROUP:
+        case NODE_CASE:
+            ret = exec_compound(node, state);
             state->last_return = ret;
             return ret;
         default:
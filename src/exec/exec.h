@@ -3,25 +3,165 @@
 
 #include "../all.h"
 #include "../parser/parser.h"
+#include "../string_utils.h"
+#include "stats.h"
 
+/* Options du shell (set -o / +o) */
+#define OPT_PIPETHREADS 0x1 /* builtins d'un pipeline exécutés en threads */
+#define OPT_NOGLOB 0x2      /* pas de développement des chemins */
+
+/* Profondeur maximale des appels de fonctions imbriqués */
+#define FUNCTION_MAX_DEPTH 1000
+
+struct var_table;
+struct glob_cache;
+struct function_table;
+struct read_cache;
+struct path_cache;
+struct profile;
+struct time_report;
+struct input_cache;
+
+/* Appel de fonction en cours. Les paramètres positionnels pointent dans les
+ * arguments déjà expansés de la commande d'appel : rien n'est copié. */
+struct call_frame {
+    char **params;          /* $1, $2... */
+    int count;              /* $# */
+    size_t locals;          /* sauvegardes de local à l'entrée de l'appel */
+    size_t locals_text;
+    struct call_frame *prev;
+};
+
+/* Valeur masquée par local, rétablie au retour de la fonction. Le nom et
+ * l'ancienne valeur sont rangés dans text ; les deux tableaux servent d'un
+ * appel à l'autre sans être réalloués. */
+struct local_save {
+    size_t name;
+    size_t name_len;
+    size_t value;           /* SIZE_MAX si la variable n'existait pas */
+    int exported;
+};
+
+struct local_stack {
+    struct local_save *saves;
+    size_t count;
+    size_t capacity;
+    struct strbuf text;
+};
+
+/* Substitution de processus <(...) ou >(...) : le bout du pipe gardé par le
+ * shell, nommé /dev/fd/N dans la commande, et le fils qui exécute le texte.
+ * Le fd est O_CLOEXEC dans le shell ; seul le fils d'une commande externe
+ * le garde ouvert à travers exec. */
+struct process_sub {
+    int fd;
+    pid_t pid;
+};
+
+struct process_subs {
+    struct process_sub *subs;
+    size_t count;
+    size_t capacity;
+};
+
+/* Un état est autonome : son environnement est sa table de variables (rien
+ * ne passe par environ ni setenv), ses fds standard et son répertoire
+ * courant sont des fds à lui. Plusieurs états peuvent donc tourner en même
+ * temps dans des threads d'un même processus, s'ils ont chacun leur
+ * répertoire (exec_own_cwd). */
 struct exec_state {
-    char **env;
+    char *name;             /* $0 */
+    struct var_table *vars; /* variables du shell, exportées ou non */
+    int fds[3];             /* entrée, sortie et erreur du shell, redirigées
+                               par une fonction ou une commande composée ;
+                               -1 : ajoutées à capture, capture_err */
+    int cwd_fd;             /* AT_FDCWD : celui du processus */
+    pid_t shell_pid;        /* $$, 0 tant qu'il n'a pas servi */
+    pid_t last_bg_pid;      /* $! */
     int last_return;
+    int substituted;        /* l'expansion en cours a exécuté un $(...) */
+    int exec_in_place;      /* étage de pipeline : sa commande externe remplace le fils */
     int should_exit;
     int exit_code;
+    int options;
+    struct strbuf *capture; /* sortie des builtins capturée ($(...) sans fork) */
+    struct strbuf *capture_err; /* leurs erreurs, capturées par libminishell */
+    struct glob_cache *globs; /* répertoires lus pendant la liste en cours */
+    int loop_depth;         /* boucles en cours d'exécution */
+    int break_levels;       /* niveaux de boucles à quitter (break, continue) */
+    int continuing;         /* le dernier niveau reprend : continue */
+    struct function_table *functions; /* créée à la première définition */
+    struct call_frame *frame; /* appel en cours, ou toplevel hors fonction */
+    struct call_frame toplevel;
+    int call_depth;
+    int returning;          /* return exécuté : remonter jusqu'à l'appel */
+    int return_status;
+    struct local_stack locals;
+    struct process_subs procsubs; /* ouvertes par les commandes en cours */
+    struct read_cache *reads; /* tampons du builtin read, créés au premier read */
+    struct path_cache *paths; /* répertoires de PATH, découpés à la première commande */
+    struct shell_stats stats;
+    size_t input_line;      /* ligne de l'entrée où reprend l'analyse */
+    size_t line;            /* ligne de la commande en cours */
+    struct profile *profile; /* --profile, NULL sinon */
+    struct time_report *timing; /* mesure de time en cours, NULL sinon */
+    struct input_cache *input; /* analyseur et dernière entrée, au premier appel */
 };
 
+/* Vrai si le reste de la liste en cours ne doit pas être exécuté */
+static inline int exec_interrupted(const struct exec_state *state)
+{
+    return state->should_exit || state->break_levels || state->returning;
+}
+
+/* $$ : le pid n'est demandé qu'au premier usage, ou juste avant un fork
+ * dont le fils exécute du shell et doit garder celui du parent */
+static inline pid_t exec_shell_pid(struct exec_state *state)
+{
+    if (!state->shell_pid)
+        state->shell_pid = getpid();
+    return state->shell_pid;
+}
+
 /* Fonctions principales de l'exécuteur */
 struct exec_state *exec_init(char **env);
 void exec_free(struct exec_state *state);
 int exec_ast(struct ast_node *node, struct exec_state *state);
 
+/* Donne à l'état un fd sur le répertoire courant : ses cd ne changent plus
+ * celui du processus, ses chemins relatifs sont résolus par openat et ses
+ * fils s'y placent avant exec. */
+int exec_own_cwd(struct exec_state *state);
+
+/* Répertoire courant de l'état, comme getcwd */
+char *exec_getcwd(const struct exec_state *state, char *buf, size_t size);
+
+/* Dans un fils qui exécute la suite : les fds standard de l'état deviennent
+ * 0, 1 et 2, et son répertoire le répertoire courant du processus */
+void exec_enter_child(struct exec_state *state);
+
+/* Diagnostic du shell : écrit sur l'erreur de l'état, ou ajouté à
+ * capture_err quand elle est capturée (fds[2] vaut -1), comme builtin_error.
+ * exec_write_err fait de même pour un texte déjà formaté. */
+void exec_error(struct exec_state *state, const char *fmt, ...);
+void exec_write_err(struct exec_state *state, const char *data, size_t len);
+
+/* Sauvegarde une variable pour la rétablir à la fin de l'appel en cours ;
+ * rien à faire si elle l'est déjà depuis la sauvegarde d'indice from */
+int exec_save_local(struct exec_state *state, size_t from, const char *name, size_t name_len);
+
+/* Ferme les substitutions de processus ouvertes depuis mark, puis attend
+ * leurs fils : un >(...) voit ainsi la fin de son entrée avant d'être
+ * attendu. Appelé quand la commande qui les a développées est terminée. */
+void exec_release_procsubs(struct exec_state *state, size_t mark);
+
 /* Fonctions d'exécution spécifiques */
 int exec_command(struct command *cmd, struct exec_state *state);
 int exec_pipeline(struct ast_node *node, struct exec_state *state);
 int exec_and_or(struct ast_node *node, struct exec_state *state);
+int exec_compound(struct ast_node *node, struct exec_state *state);
 
 /* Utilitaires */
-int handle_redirections(struct command *cmd);
+int handle_redirections(struct command *cmd, int dir_fd);
 
 #endif /* EXEC_H */
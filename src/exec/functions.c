@@ -0,0 +1,112 @@
+#include "functions.h"
+
+#define FUNCTIONS_MIN_CAPACITY 16
+
+static struct function_slot *find_slot(struct function_table *functions, const char *name,
+                                       size_t len, unsigned int hash)
+{
+    size_t mask = functions->capacity - 1;
+    size_t i = hash & mask;
+
+    while (functions->slots[i].function)
+    {
+        struct function_slot *slot = &functions->slots[i];
+        if (slot->hash == hash && strncmp(slot->function->name, name, len) == 0 &&
+            slot->function->name[len] == '\0')
+            return slot;
+        i = (i + 1) & mask;
+    }
+    return &functions->slots[i];
+}
+
+static int grow_table(struct function_table *functions)
+{
+    size_t old_capacity = functions->capacity;
+    struct function_slot *old_slots = functions->slots;
+    size_t capacity = old_capacity ? old_capacity * 2 : FUNCTIONS_MIN_CAPACITY;
+    struct function_slot *slots = calloc(capacity, sizeof(struct function_slot));
+    if (!slots)
+        return -1;
+
+    functions->slots = slots;
+    functions->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        struct function_def *function = old_slots[i].function;
+        if (function)
+            *find_slot(functions, function->name, strlen(function->name),
+                       old_slots[i].hash) = old_slots[i];
+    }
+    free(old_slots);
+    return 0;
+}
+
+void functions_free(struct function_table *functions)
+{
+    if (!functions)
+        return;
+    for (size_t i = 0; i < functions->capacity; i++)
+        function_def_release(functions->slots[i].function);
+    free(functions->slots);
+    free(functions);
+}
+
+struct function_def *functions_lookup(struct function_table *functions, const char *name)
+{
+    if (!functions || functions->count == 0 || !name)
+        return NULL;
+
+    size_t len = strlen(name);
+    return find_slot(functions, name, len, hash_name(name, len))->function;
+}
+
+/* Une redéfinition remplace l'ancienne, qui reste valide pour un appel en
+ * cours tant que celui-ci garde sa référence. */
+int functions_define(struct function_table *functions, struct function_def *function)
+{
+    if (2 * (functions->count + 1) > functions->capacity && grow_table(functions) == -1)
+        return -1;
+
+    size_t len = strlen(function->name);
+    unsigned int hash = hash_name(function->name, len);
+    struct function_slot *slot = find_slot(functions, function->name, len, hash);
+
+    function->refs++;
+    if (slot->function)
+        function_def_release(slot->function);
+    else
+        functions->count++;
+    slot->function = function;
+    slot->hash = hash;
+    return 0;
+}
+
+int functions_unset(struct function_table *functions, const char *name)
+{
+    if (!functions || functions->count == 0)
+        return 0;
+
+    size_t len = strlen(name);
+    struct function_slot *slot = find_slot(functions, name, len, hash_name(name, len));
+    if (!slot->function)
+        return 0;
+
+    function_def_release(slot->function);
+    slot->function = NULL;
+    functions->count--;
+
+    /* Recule les entrées suivantes pour ne pas couper leur chaîne de sondage */
+    size_t mask = functions->capacity - 1;
+    size_t hole = slot - functions->slots;
+    for (size_t i = (hole + 1) & mask; functions->slots[i].function; i = (i + 1) & mask)
+    {
+        size_t home = functions->slots[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            functions->slots[hole] = functions->slots[i];
+            functions->slots[i].function = NULL;
+            hole = i;
+        }
+    }
+    return 0;
+}
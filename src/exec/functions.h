@@ -0,0 +1,27 @@
+#ifndef FUNCTIONS_H
+#define FUNCTIONS_H
+
+#include "../all.h"
+#include "../string_utils.h"
+#include "../parser/parser.h"
+
+/* Table des fonctions du shell, à adressage ouvert comme celle des
+ * variables. Elle garde une référence sur chaque définition : le corps
+ * analysé survit à la ligne qui l'a déclaré. */
+struct function_slot {
+    struct function_def *function;
+    unsigned int hash;
+};
+
+struct function_table {
+    struct function_slot *slots;
+    size_t capacity;
+    size_t count;
+};
+
+void functions_free(struct function_table *functions);
+struct function_def *functions_lookup(struct function_table *functions, const char *name);
+int functions_define(struct function_table *functions, struct function_def *function);
+int functions_unset(struct function_table *functions, const char *name);
+
+#endif /* FUNCTIONS_H */
@@ -0,0 +1,114 @@
+#include "heredoc.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static int write_all(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Petit corps : il tient entièrement dans le pipe, le shell le remplit et
+ * ferme l'extrémité d'écriture avant que le lecteur ne démarre. */
+static int heredoc_pipe(const char *body, size_t len)
+{
+    int pipefd[2];
+
+    if (pipe2(pipefd, O_CLOEXEC) == -1)
+        return -1;
+    if (write_all(pipefd[1], body, len) == -1)
+    {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return -1;
+    }
+    close(pipefd[1]);
+    return pipefd[0];
+}
+
+/* L'écrivain ne garde que son bout du pipe : un bout de pipe du pipeline
+ * hérité du shell retarderait la fin de fichier de son lecteur. */
+static void close_other_fds(int keep)
+{
+#ifdef SYS_close_range
+    if ((keep == 0 || syscall(SYS_close_range, 0, keep - 1, 0) == 0) &&
+        syscall(SYS_close_range, keep + 1, ~0U, 0) == 0)
+        return;
+#endif
+    long max = sysconf(_SC_OPEN_MAX);
+    for (long fd = 0; fd < max; fd++)
+    {
+        if (fd != keep)
+            close(fd);
+    }
+}
+
+/* Sans memfd, un processus écrivain alimente le pipe : rien ne passe par le
+ * disque. Double fork pour que l'écrivain n'ait pas à être attendu. */
+static int heredoc_pipe_writer(const char *body, size_t len)
+{
+    int pipefd[2];
+
+    if (pipe2(pipefd, O_CLOEXEC) == -1)
+        return -1;
+
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return -1;
+    }
+    if (pid == 0)
+    {
+        if (fork() != 0)
+            _exit(0);
+        close_other_fds(pipefd[1]);
+        signal(SIGPIPE, SIG_DFL);
+        _exit(write_all(pipefd[1], body, len) == -1);
+    }
+    close(pipefd[1]);
+    waitpid(pid, NULL, 0);
+    return pipefd[0];
+}
+
+/* Gros corps : fichier anonyme scellé, que le lecteur peut mmap ou lseek. */
+static int heredoc_memfd(const char *body, size_t len)
+{
+    int fd = memfd_create("minishell-heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+        return -1;
+
+    if (write_all(fd, body, len) == -1 || lseek(fd, 0, SEEK_SET) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    return fd;
+}
+
+int heredoc_open(struct redirection *redir)
+{
+    const char *body = redir->heredoc ? redir->heredoc : "";
+    size_t len = redir->heredoc ? redir->heredoc_len : 0;
+
+    if (len <= HEREDOC_PIPE_MAX)
+        return heredoc_pipe(body, len);
+
+    int fd = heredoc_memfd(body, len);
+    if (fd == -1)
+        fd = heredoc_pipe_writer(body, len);
+    return fd;
+}
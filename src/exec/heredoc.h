@@ -0,0 +1,13 @@
+#ifndef HEREDOC_H
+#define HEREDOC_H
+
+#include "../all.h"
+#include "../parser/parser.h"
+
+/* Au-delà de PIPE_BUF, l'écriture dans un pipe vide pourrait bloquer : le
+ * corps passe alors par un fichier anonyme en mémoire (memfd). */
+#define HEREDOC_PIPE_MAX PIPE_BUF
+
+int heredoc_open(struct redirection *redir);
+
+#endif /* HEREDOC_H */
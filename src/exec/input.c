@@ -0,0 +1,178 @@
+#include "input.h"
+#include "exec.h"
+#include "alloc.h"
+#include "trace.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../expand/glob.h"
+
+static void report_syntax_error(struct parser *parser, struct exec_state *state)
+{
+    struct token *token = parser->current_token;
+    const char *near = token->value ? token->value : "newline";
+
+    exec_error(state, "minishell: syntax error near unexpected token `%s'\n", near);
+    state->last_return = 2;
+}
+
+static void drop_cached(struct input_cache *cache)
+{
+    ast_node_free(cache->ast);
+    cache->ast = NULL;
+}
+
+/* Lexer et parser repris sur la nouvelle entrée, créés au premier appel */
+static struct parser *start_parser(struct input_cache *cache, char *input)
+{
+    if (!cache->lexer)
+    {
+        cache->lexer = lexer_init(input);
+        if (!cache->lexer)
+            return NULL;
+    }
+    else
+        lexer_reset(cache->lexer, input);
+
+    if (!cache->parser)
+        cache->parser = parser_init(cache->lexer);
+    else
+        parser_reset(cache->parser);
+    return cache->parser;
+}
+
+static int run_cached(struct input_cache *cache, const char *input, size_t len,
+                      struct exec_state *state)
+{
+    if (!cache->ast || len != cache->text.len || memcmp(input, cache->text.data, len) != 0)
+        return 0;
+
+    enum alloc_phase phase = alloc_enter(ALLOC_EXEC);
+    exec_ast(cache->ast, state);
+    alloc_enter(phase);
+    glob_cache_clear(state->globs);
+    state->stats.lines += cache->counted;
+    state->input_line += cache->lines;
+    return 1;
+}
+
+/* Garde l'arbre de l'entrée si elle n'a donné qu'une liste, sans erreur */
+static void keep_cached(struct input_cache *cache, struct ast_node *ast, const char *input,
+                        size_t len, size_t lines, size_t counted)
+{
+    drop_cached(cache);
+    strbuf_reset(&cache->text);
+    if (len > INPUT_CACHE_MAX || strbuf_append(&cache->text, input, len) == -1)
+    {
+        ast_node_free(ast);
+        return;
+    }
+    cache->ast = ast;
+    cache->lines = lines;
+    cache->counted = counted;
+}
+
+static size_t process_input(char *input, int at_eof, struct exec_state *state)
+{
+    if (!state->input && !(state->input = calloc(1, sizeof(struct input_cache))))
+        return 0;
+
+    struct input_cache *cache = state->input;
+    size_t length = strlen(input);
+    if (run_cached(cache, input, length, state))
+        return length;
+
+    struct parser *parser = start_parser(cache, input);
+    if (!parser)
+        return 0;
+    struct lexer *lexer = cache->lexer;
+    lexer->line = state->input_line;
+
+    size_t consumed = 0;
+    size_t consumed_line = lexer->line;
+    size_t counted = 0;
+    size_t lists = 0;
+    int failed = 0;
+    struct ast_node *kept = NULL;
+    while (!state->should_exit)
+    {
+        size_t line = lexer->line;
+        size_t tokens = lexer->tokens;
+        size_t nodes = parser->nodes;
+        uint64_t start = stats_now();
+        enum alloc_phase phase = alloc_enter(ALLOC_PARSE);
+        struct ast_node *ast = parse_input(parser);
+        alloc_enter(phase);
+        state->stats.parse_ns += stats_now() - start;
+        if (trace_enabled())
+            trace_span(TRACE_PARSE, "parse", start, line);
+        if (parser->incomplete && !at_eof)
+        {
+            ast_node_free(ast);
+            failed = 1;
+            break;
+        }
+        counted += lexer->line - line;
+        state->stats.tokens += lexer->tokens - tokens;
+        state->stats.nodes += parser->nodes - nodes;
+        /* dernière ligne sans '\n' (chaîne de -c, fin de script) */
+        if (parser->current_token->type == TOKEN_EOF && lexer->length > 0 &&
+            input[lexer->length - 1] != '\n')
+            counted++;
+
+        if (ast)
+        {
+            phase = alloc_enter(ALLOC_EXEC);
+            exec_ast(ast, state);
+            alloc_enter(phase);
+            glob_cache_clear(state->globs);
+            ast_node_free(kept);
+            kept = ast;
+            lists++;
+        }
+        else if (parser->has_error)
+        {
+            report_syntax_error(parser, state);
+            parser_skip_line(parser);
+            failed = 1;
+        }
+
+        consumed_line = lexer->line;
+        if (parser->current_token->type == TOKEN_EOF)
+        {
+            consumed = lexer->length;
+            break;
+        }
+        consumed = lexer->position;
+    }
+
+    state->stats.lines += counted;
+    if (lists == 1 && !failed && consumed == length)
+        keep_cached(cache, kept, input, length, consumed_line - state->input_line, counted);
+    else
+    {
+        drop_cached(cache);
+        ast_node_free(kept);
+    }
+    state->input_line = consumed_line;
+    return consumed;
+}
+
+/* Les allocations de l'entrée sont comptées dans les stats de l'état */
+size_t input_process(char *input, int at_eof, struct exec_state *state)
+{
+    unsigned long *counts = alloc_use(state->stats.allocs);
+    size_t consumed = process_input(input, at_eof, state);
+    alloc_use(counts);
+    return consumed;
+}
+
+void input_cache_free(struct input_cache *cache)
+{
+    if (!cache)
+        return;
+    drop_cached(cache);
+    strbuf_free(&cache->text);
+    parser_free(cache->parser);
+    lexer_free(cache->lexer);
+    free(cache);
+}
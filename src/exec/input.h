@@ -0,0 +1,37 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "../all.h"
+#include "../string_utils.h"
+
+struct exec_state;
+struct lexer;
+struct parser;
+struct ast_node;
+
+/* Au-delà, une entrée n'est pas gardée : un bloc de script ne se répète pas */
+#define INPUT_CACHE_MAX 4096
+
+/* Lexer et parser servent d'une entrée à l'autre. Une entrée courte qui
+ * tient en une seule liste de commandes est gardée avec son arbre : si
+ * l'entrée suivante est identique (la même ligne, tapée ou envoyée en
+ * boucle), elle est exécutée sans être réanalysée, et la mémoire de travail
+ * de ses commandes est déjà dimensionnée. Une fois en régime, répéter une
+ * ligne de builtins n'alloue plus rien. */
+struct input_cache {
+    struct lexer *lexer;
+    struct parser *parser;
+    struct strbuf text;         /* entrée dont l'arbre est gardé */
+    struct ast_node *ast;
+    size_t lines;               /* lignes avancées dans l'entrée */
+    size_t counted;             /* lignes comptées par le builtin stats */
+};
+
+/* Exécute les commandes complètes de l'entrée et renvoie le nombre d'octets
+ * consommés. Sauf en fin d'entrée, une commande incomplète (here-document
+ * sans délimiteur) est laissée dans le tampon en attendant la suite. */
+size_t input_process(char *input, int at_eof, struct exec_state *state);
+
+void input_cache_free(struct input_cache *cache);
+
+#endif /* INPUT_H */
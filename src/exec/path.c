@@ -0,0 +1,209 @@
+#include "path.h"
+#include <dirent.h>
+
+#define PATH_HITS_MIN_CAPACITY 64
+
+static void clear_hits(struct path_cache *cache)
+{
+    for (size_t i = 0; i < cache->hits_capacity; i++)
+        free(cache->hits[i].name);
+    free(cache->hits);
+    cache->hits = NULL;
+    cache->hits_capacity = 0;
+    cache->hits_count = 0;
+}
+
+static struct path_hit *find_hit(struct path_cache *cache, const char *name, size_t len,
+                                 unsigned int hash)
+{
+    size_t mask = cache->hits_capacity - 1;
+    size_t i = hash & mask;
+
+    while (cache->hits[i].name)
+    {
+        struct path_hit *hit = &cache->hits[i];
+        if (hit->hash == hash && strncmp(hit->name, name, len) == 0 && hit->name[len] == '\0')
+            return hit;
+        i = (i + 1) & mask;
+    }
+    return &cache->hits[i];
+}
+
+static int grow_hits(struct path_cache *cache)
+{
+    size_t old_capacity = cache->hits_capacity;
+    struct path_hit *old_hits = cache->hits;
+    size_t capacity = old_capacity ? old_capacity * 2 : PATH_HITS_MIN_CAPACITY;
+    struct path_hit *hits = calloc(capacity, sizeof(struct path_hit));
+    if (!hits)
+        return -1;
+
+    cache->hits = hits;
+    cache->hits_capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old_hits[i].name)
+            *find_hit(cache, old_hits[i].name, strlen(old_hits[i].name),
+                      old_hits[i].hash) = old_hits[i];
+    }
+    free(old_hits);
+    return 0;
+}
+
+/* Retient name dans dir ; un nom déjà connu garde son chemin si replace
+ * est nul. Un échec de mémoire laisse seulement la table incomplète. */
+static void remember(struct path_cache *cache, const char *dir, size_t dir_len,
+                     const char *name, size_t name_len, int replace)
+{
+    if (2 * (cache->hits_count + 1) > cache->hits_capacity && grow_hits(cache) == -1)
+        return;
+
+    unsigned int hash = hash_name(name, name_len);
+    struct path_hit *hit = find_hit(cache, name, name_len, hash);
+    if (hit->name && !replace)
+        return;
+
+    char *block = malloc(2 * name_len + dir_len + 3);
+    if (!block)
+        return;
+    memcpy(block, name, name_len + 1);
+    char *full = block + name_len + 1;
+    memcpy(full, dir, dir_len);
+    full[dir_len] = '/';
+    memcpy(full + dir_len + 1, name, name_len + 1);
+
+    if (hit->name)
+        free(hit->name);
+    else
+        cache->hits_count++;
+    hit->name = block;
+    hit->path = full;
+    hit->hash = hash;
+}
+
+void path_cache_free(struct path_cache *cache)
+{
+    if (!cache)
+        return;
+    clear_hits(cache);
+    strbuf_free(&cache->source);
+    strbuf_free(&cache->dirs);
+    strbuf_free(&cache->candidate);
+    free(cache);
+}
+
+/* Les composants vides sont ignorés, comme le faisait strtok */
+static int split_path(struct path_cache *cache, const char *path)
+{
+    size_t len = strlen(path);
+
+    clear_hits(cache);
+    cache->source.len = 0;
+    cache->dirs.len = 0;
+    cache->count = 0;
+    if (strbuf_append(&cache->source, path, len) == -1 ||
+        strbuf_reserve(&cache->dirs, len + 1) == -1)
+    {
+        cache->source.len = 0;
+        return -1;
+    }
+
+    for (const char *dir = path; *dir; )
+    {
+        size_t dir_len = strcspn(dir, ":");
+        if (dir_len > 0)
+        {
+            memcpy(cache->dirs.data + cache->dirs.len, dir, dir_len);
+            cache->dirs.len += dir_len;
+            cache->dirs.data[cache->dirs.len++] = '\0';
+            cache->count++;
+        }
+        dir += dir_len;
+        if (*dir == ':')
+            dir++;
+    }
+    return 0;
+}
+
+/* Cache à jour pour path, créé au premier appel */
+static struct path_cache *load_cache(struct path_cache **cache, const char *path)
+{
+    if (!*cache)
+    {
+        *cache = calloc(1, sizeof(struct path_cache));
+        if (!*cache)
+            return NULL;
+    }
+
+    struct path_cache *c = *cache;
+    if ((!c->source.data || strcmp(c->source.data, path) != 0) && split_path(c, path) == -1)
+        return NULL;
+    return c;
+}
+
+const char *path_search(struct path_cache **cache, const char *path, const char *name,
+                        int dir_fd, unsigned long *probes)
+{
+    struct path_cache *c = load_cache(cache, path);
+    if (!c)
+        return NULL;
+
+    size_t name_len = strlen(name);
+    if (c->hits_count > 0)
+    {
+        struct path_hit *hit = find_hit(c, name, name_len, hash_name(name, name_len));
+        (*probes) += hit->name != NULL;
+        if (hit->name && faccessat(AT_FDCWD, hit->path, X_OK, 0) == 0)
+            return hit->path;
+    }
+
+    const char *dir = c->dirs.data;
+    for (size_t i = 0; i < c->count; i++)
+    {
+        size_t dir_len = strlen(dir);
+        c->candidate.len = 0;
+        if (strbuf_append(&c->candidate, dir, dir_len) == -1 ||
+            strbuf_putc(&c->candidate, '/') == -1 ||
+            strbuf_append(&c->candidate, name, name_len) == -1)
+            return NULL;
+        (*probes)++;
+        if (faccessat(dir_fd, c->candidate.data, X_OK, 0) == 0)
+        {
+            if (dir[0] == '/')
+                remember(c, dir, dir_len, name, name_len, 1);
+            return c->candidate.data;
+        }
+        dir += dir_len + 1;
+    }
+    return NULL;
+}
+
+long path_preload(struct path_cache **cache, const char *path)
+{
+    struct path_cache *c = load_cache(cache, path);
+    if (!c)
+        return -1;
+
+    const char *dir = c->dirs.data;
+    for (size_t i = 0; i < c->count; i++)
+    {
+        size_t dir_len = strlen(dir);
+        int fd = dir[0] == '/' ? open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+        DIR *stream = fd != -1 ? fdopendir(fd) : NULL;
+        struct dirent *entry;
+
+        if (!stream && fd != -1)
+            close(fd);
+        while (stream && (entry = readdir(stream)))
+        {
+            if (entry->d_name[0] == '.' || entry->d_type == DT_DIR ||
+                faccessat(fd, entry->d_name, X_OK, 0) != 0)
+                continue;
+            remember(c, dir, dir_len, entry->d_name, strlen(entry->d_name), 0);
+        }
+        if (stream)
+            closedir(stream);
+        dir += dir_len + 1;
+    }
+    return c->hits_count;
+}
@@ -0,0 +1,43 @@
+#ifndef PATH_H
+#define PATH_H
+
+#include "../all.h"
+#include "../string_utils.h"
+
+/* Répertoires de PATH, découpés à la première recherche d'une commande et
+ * gardés tant que la valeur de PATH ne change pas, avec les commandes déjà
+ * trouvées. Comme la table hash de bash, une commande trouvée reste à son
+ * chemin tant qu'il est exécutable, même si une autre de même nom apparaît
+ * plus tôt dans PATH ; changer PATH vide la table. */
+struct path_hit {
+    char *name;             /* nom, puis chemin, dans le même bloc */
+    const char *path;
+    unsigned int hash;
+};
+
+struct path_cache {
+    struct strbuf source;   /* valeur de PATH au découpage */
+    struct strbuf dirs;     /* répertoires séparés par des '\0' */
+    size_t count;
+    struct strbuf candidate; /* chemin essayé, renvoyé par path_search */
+    struct path_hit *hits;  /* adressage ouvert, seulement les répertoires absolus */
+    size_t hits_capacity;
+    size_t hits_count;
+};
+
+/* Cherche une commande dans les répertoires de path, les répertoires
+ * relatifs partant de dir_fd. Renvoie son chemin, valable jusqu'à la
+ * recherche suivante, ou NULL. Le cache est créé au premier appel ; chaque
+ * répertoire essayé, ou chemin déjà connu revérifié, incrémente *probes. */
+const char *path_search(struct path_cache **cache, const char *path, const char *name,
+                        int dir_fd, unsigned long *probes);
+
+/* Remplit la table avec les exécutables des répertoires absolus de path,
+ * le premier répertoire l'emportant, pour qu'aucune recherche ne parcoure
+ * plus PATH. Sert au mode serveur, dont les fils héritent de la table.
+ * Renvoie le nombre de commandes connues, ou -1. */
+long path_preload(struct path_cache **cache, const char *path);
+
+void path_cache_free(struct path_cache *cache);
+
+#endif /* PATH_H */
@@ -0,0 +1,275 @@
+#include "pipes.h"
+#include <pthread.h>
+#include <ctype.h>
+
+static long pipe_max_size;
+static pthread_once_t pipe_max_size_once = PTHREAD_ONCE_INIT;
+
+/* Lue une fois : la limite ne change qu'avec sysctl */
+static void read_pipe_max_size(void)
+{
+    FILE *file = fopen(PIPE_MAX_SIZE_FILE, "r");
+    if (!file)
+        return;
+    if (fscanf(file, "%ld", &pipe_max_size) != 1)
+        pipe_max_size = 0;
+    fclose(file);
+}
+
+long pipe_capacity(const char *value)
+{
+    if (!value || !*value)
+        return 0;
+
+    char *end;
+    errno = 0;
+    long capacity = strtol(value, &end, 10);
+    if (end == value || errno == ERANGE || capacity <= 0)
+        return 0;
+    if (*end == 'k' || *end == 'K')
+        capacity = capacity > LONG_MAX / 1024 ? LONG_MAX : capacity * 1024;
+    else if (*end == 'm' || *end == 'M')
+        capacity = capacity > LONG_MAX / (1024 * 1024) ? LONG_MAX : capacity * 1024 * 1024;
+    else if (*end != '\0')
+        return 0;
+    if (*end && end[1] != '\0')
+        return 0;
+
+    pthread_once(&pipe_max_size_once, read_pipe_max_size);
+    if (pipe_max_size > 0 && capacity > pipe_max_size)
+        capacity = pipe_max_size;
+    return capacity > INT_MAX ? INT_MAX : capacity;
+}
+
+int pipe_stall_read(pid_t pid, uint64_t life_ns, struct pipe_stall *stall)
+{
+    char path[64];
+    unsigned long long run_ns;
+    unsigned long long queued_ns;
+
+    snprintf(path, sizeof(path), PIPE_SCHEDSTAT_FILE, (long)pid);
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+    int fields = fscanf(file, "%llu %llu", &run_ns, &queued_ns);
+    fclose(file);
+    if (fields != 2)
+        return -1;
+
+    /* Les horloges diffèrent un peu : le temps bloqué est borné à 0 */
+    stall->life_ns = life_ns;
+    stall->blocked_ns = run_ns + queued_ns < life_ns ? life_ns - run_ns - queued_ns : 0;
+    return 0;
+}
+
+/* Liste de CPU au format du noyau : "0-3,8" ; -1 si elle est invalide */
+static int parse_cpulist(const char *list, size_t len, cpu_set_t *set)
+{
+    const char *end = list + len;
+
+    CPU_ZERO(set);
+    while (list < end)
+    {
+        char *next;
+        if (!isdigit((unsigned char)*list))
+            return -1;
+        long first = strtol(list, &next, 10);
+        long last = first;
+        if (next < end && *next == '-')
+        {
+            list = next + 1;
+            if (list == end || !isdigit((unsigned char)*list))
+                return -1;
+            last = strtol(list, &next, 10);
+        }
+        if (first >= CPU_SETSIZE || last >= CPU_SETSIZE || last < first)
+            return -1;
+        if (next > end || (next < end && *next != ','))
+            return -1;
+        for (long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, set);
+        list = next < end ? next + 1 : end;
+        if (next < end && list == end)
+            return -1;
+    }
+    return 0;
+}
+
+/* Première ligne d'un fichier de sysfs, sans son '\n' ; -1 si illisible */
+static ssize_t read_sysfs(const char *path, char *buffer, size_t size)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+    char *line = fgets(buffer, size, file);
+    fclose(file);
+    if (!line)
+        return -1;
+    size_t len = strcspn(buffer, "\n");
+    buffer[len] = '\0';
+    return len;
+}
+
+static int read_sysfs_cpulist(const char *path, cpu_set_t *set)
+{
+    char buffer[BUFFER_SIZE];
+    ssize_t len = read_sysfs(path, buffer, sizeof(buffer));
+    return len <= 0 ? -1 : parse_cpulist(buffer, len, set);
+}
+
+static int first_cpu(const cpu_set_t *set)
+{
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, set))
+            return cpu;
+    }
+    return -1;
+}
+
+struct cpu_place {
+    int cpu;
+    int domain;     /* premier CPU qui partage son dernier niveau de cache */
+    int sibling;    /* rang parmi les threads SMT de son cœur */
+};
+
+static struct cpu_place *cpu_order;
+static size_t cpu_order_count;
+static pthread_once_t cpu_order_once = PTHREAD_ONCE_INIT;
+
+/* Le cache de plus haut niveau du CPU : index0 à indexN dans sysfs */
+static int cpu_domain(int cpu)
+{
+    char path[PATH_MAX];
+    char level[32];
+    int best = 0;
+    int domain = 0;
+
+    for (int index = 0; ; index++)
+    {
+        snprintf(path, sizeof(path), PIPE_SYSFS_CPU "/cpu%d/cache/index%d/level", cpu, index);
+        if (read_sysfs(path, level, sizeof(level)) <= 0)
+            break;
+        if (atoi(level) <= best)
+            continue;
+
+        cpu_set_t shared;
+        snprintf(path, sizeof(path), PIPE_SYSFS_CPU "/cpu%d/cache/index%d/shared_cpu_list",
+                 cpu, index);
+        if (read_sysfs_cpulist(path, &shared) == 0 && first_cpu(&shared) != -1)
+        {
+            best = atoi(level);
+            domain = first_cpu(&shared);
+        }
+    }
+    return domain;
+}
+
+static int cpu_sibling(int cpu)
+{
+    char path[PATH_MAX];
+    cpu_set_t siblings;
+    int rank = 0;
+
+    snprintf(path, sizeof(path), PIPE_SYSFS_CPU "/cpu%d/topology/thread_siblings_list", cpu);
+    if (read_sysfs_cpulist(path, &siblings) == -1)
+        return 0;
+    for (int i = 0; i < cpu; i++)
+        rank += CPU_ISSET(i, &siblings) != 0;
+    return rank;
+}
+
+static int compare_places(const void *a, const void *b)
+{
+    const struct cpu_place *left = a;
+    const struct cpu_place *right = b;
+
+    if (left->domain != right->domain)
+        return left->domain < right->domain ? -1 : 1;
+    if (left->sibling != right->sibling)
+        return left->sibling < right->sibling ? -1 : 1;
+    return (left->cpu > right->cpu) - (left->cpu < right->cpu);
+}
+
+/* Lu une fois : la topologie ne change pas pendant la vie du shell */
+static void read_cpu_order(void)
+{
+    cpu_set_t online;
+
+    if (read_sysfs_cpulist(PIPE_SYSFS_CPU "/online", &online) == -1 &&
+        sched_getaffinity(0, sizeof(online), &online) == -1)
+        return;
+    cpu_order = malloc(CPU_COUNT(&online) * sizeof(struct cpu_place));
+    if (!cpu_order)
+        return;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &online))
+            continue;
+        struct cpu_place *place = &cpu_order[cpu_order_count++];
+        place->cpu = cpu;
+        place->domain = cpu_domain(cpu);
+        place->sibling = cpu_sibling(cpu);
+    }
+    qsort(cpu_order, cpu_order_count, sizeof(struct cpu_place), compare_places);
+}
+
+/* Politique cache : l'étage i sur le i-ème CPU autorisé de l'ordre, en
+ * recommençant au premier si le pipeline a plus d'étages que de CPU */
+static size_t place_cache(cpu_set_t *sets, size_t count)
+{
+    cpu_set_t allowed;
+    int *cpus;
+    size_t n = 0;
+
+    pthread_once(&cpu_order_once, read_cpu_order);
+    if (cpu_order_count == 0 || sched_getaffinity(0, sizeof(allowed), &allowed) == -1)
+        return 0;
+    cpus = malloc(cpu_order_count * sizeof(int));
+    if (!cpus)
+        return 0;
+    for (size_t i = 0; i < cpu_order_count; i++)
+    {
+        if (CPU_ISSET(cpu_order[i].cpu, &allowed))
+            cpus[n++] = cpu_order[i].cpu;
+    }
+    for (size_t i = 0; n > 0 && i < count; i++)
+        CPU_SET(cpus[i % n], &sets[i]);
+    free(cpus);
+    return n > 0 ? count : 0;
+}
+
+size_t pipe_placement(const char *value, cpu_set_t *sets, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        CPU_ZERO(&sets[i]);
+    if (!value || !*value)
+        return 0;
+    if (strcmp(value, PIPE_PLACE_CACHE) == 0)
+        return place_cache(sets, count);
+
+    /* Toute la valeur est vérifiée, même au-delà du dernier étage */
+    size_t placed = 0;
+    for (size_t i = 0; ; i++)
+    {
+        const char *end = strchrnul(value, ':');
+        cpu_set_t set;
+        if (end > value)
+        {
+            if (parse_cpulist(value, end - value, &set) == -1)
+            {
+                for (size_t j = 0; j < count; j++)
+                    CPU_ZERO(&sets[j]);
+                return 0;
+            }
+            if (i < count)
+            {
+                sets[i] = set;
+                placed++;
+            }
+        }
+        if (*end == '\0')
+            return placed;
+        value = end + 1;
+    }
+}
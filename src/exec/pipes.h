@@ -0,0 +1,52 @@
+#ifndef PIPES_H
+#define PIPES_H
+
+#include "../all.h"
+#include <sched.h>
+#include <stdint.h>
+
+/* Capacité des pipes d'un pipeline et mesure de leurs blocages.
+ *
+ * La variable PIPESIZE donne la capacité de chaque pipe créé pour un
+ * pipeline (F_SETPIPE_SZ) : un nombre d'octets, suivi de k ou m. Une
+ * capacité plus grande laisse les étages avancer par gros blocs au lieu de
+ * s'attendre tous les 64 Ko. Sans PIPESIZE, le noyau garde sa capacité par
+ * défaut. */
+#define PIPE_MAX_SIZE_FILE "/proc/sys/fs/pipe-max-size"
+
+/* Capacité demandée par une valeur de PIPESIZE, bornée par pipe-max-size ;
+ * 0 si la valeur est absente ou invalide */
+long pipe_capacity(const char *value);
+
+/* Sous time, le temps bloqué d'un étage est relevé à sa fin, sans
+ * échantillonnage : sa durée de vie moins le temps passé sur un CPU ou à en
+ * attendre un, d'après le schedstat de son zombie. C'est le temps où il
+ * dormait : sur ses pipes pour un étage de pipeline, ou sur un disque.
+ * ru_nvcsw compte ces sommeils. */
+#define PIPE_SCHEDSTAT_FILE "/proc/%ld/schedstat"
+
+struct pipe_stall {
+    uint64_t blocked_ns;
+    uint64_t life_ns;           /* 0 : pas de relevé */
+};
+
+/* pid doit être terminé mais pas encore attendu ; -1 si schedstat est
+ * illisible */
+int pipe_stall_read(pid_t pid, uint64_t life_ns, struct pipe_stall *stall);
+
+/* Placement des étages sur les CPU (PIPECPUS), appliqué par chaque étage
+ * avec sched_setaffinity avant son exec. Deux formes :
+ *   cache        chaque étage sur un CPU, les étages voisins sur des CPU
+ *                voisins dans l'ordre de PIPE_SYSFS_CPU : même dernier niveau
+ *                de cache d'abord, cœurs distincts avant les threads SMT
+ *   0-1:2::4,6   une liste de CPU par étage, séparées par ':' ; une liste
+ *                vide ou absente laisse l'étage libre
+ * Une valeur invalide ne place rien. */
+#define PIPE_SYSFS_CPU "/sys/devices/system/cpu"
+#define PIPE_PLACE_CACHE "cache"
+
+/* Remplit sets[0..count) d'après value ; un ensemble vide laisse l'étage
+ * libre. Renvoie le nombre d'étages placés. */
+size_t pipe_placement(const char *value, cpu_set_t *sets, size_t count);
+
+#endif /* PIPES_H */
@@ -0,0 +1,304 @@
+#include "profile.h"
+#include "stats.h"
+#include <sys/resource.h>
+
+#define PROFILE_REPORT_LINES 20
+#define PROFILE_MIN_STACKS 64
+
+/* CPU des fils déjà attendus, en microsecondes */
+static void children_cpu(uint64_t *user_us, uint64_t *sys_us)
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_CHILDREN, &usage) == -1)
+    {
+        *user_us = 0;
+        *sys_us = 0;
+        return;
+    }
+    *user_us = usage.ru_utime.tv_sec * 1000000ull + usage.ru_utime.tv_usec;
+    *sys_us = usage.ru_stime.tv_sec * 1000000ull + usage.ru_stime.tv_usec;
+}
+
+struct profile *profile_new(const char *folded_path)
+{
+    struct profile *profile = calloc(1, sizeof(struct profile));
+    if (!profile)
+        return NULL;
+    if (folded_path && !(profile->folded_path = strdup(folded_path)))
+    {
+        free(profile);
+        return NULL;
+    }
+    profile->start = stats_now();
+    return profile;
+}
+
+static struct profile_line *get_line(struct profile *profile, size_t line)
+{
+    if (line >= profile->line_capacity)
+    {
+        size_t capacity = profile->line_capacity ? profile->line_capacity : 64;
+        while (capacity <= line)
+            capacity *= 2;
+        struct profile_line *lines = realloc(profile->lines,
+                                             capacity * sizeof(struct profile_line));
+        if (!lines)
+            return NULL;
+        memset(lines + profile->line_capacity, 0,
+               (capacity - profile->line_capacity) * sizeof(struct profile_line));
+        profile->lines = lines;
+        profile->line_capacity = capacity;
+    }
+    return &profile->lines[line];
+}
+
+static struct profile_stack *find_stack(struct profile *profile, const char *key,
+                                        size_t len, unsigned int hash)
+{
+    size_t mask = profile->stack_capacity - 1;
+    size_t i = hash & mask;
+
+    while (profile->stacks[i].key)
+    {
+        struct profile_stack *stack = &profile->stacks[i];
+        if (stack->hash == hash && strncmp(stack->key, key, len) == 0 && !stack->key[len])
+            return stack;
+        i = (i + 1) & mask;
+    }
+    return &profile->stacks[i];
+}
+
+static int grow_stacks(struct profile *profile)
+{
+    size_t old_capacity = profile->stack_capacity;
+    struct profile_stack *old = profile->stacks;
+    size_t capacity = old_capacity ? 2 * old_capacity : PROFILE_MIN_STACKS;
+    struct profile_stack *stacks = calloc(capacity, sizeof(struct profile_stack));
+    if (!stacks)
+        return -1;
+
+    profile->stacks = stacks;
+    profile->stack_capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old[i].key)
+            *find_stack(profile, old[i].key, strlen(old[i].key), old[i].hash) = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+/* Ajoute le temps propre du cadre à sa pile repliée */
+static void add_stack(struct profile *profile, uint64_t ns)
+{
+    if (2 * (profile->stack_count + 1) > profile->stack_capacity &&
+        grow_stacks(profile) == -1)
+        return;
+
+    const char *key = profile->path.data;
+    size_t len = profile->path.len;
+    unsigned int hash = hash_name(key, len);
+    struct profile_stack *stack = find_stack(profile, key, len, hash);
+    if (!stack->key)
+    {
+        stack->key = my_strndup(key, len);
+        if (!stack->key)
+            return;
+        stack->hash = hash;
+        profile->stack_count++;
+    }
+    stack->ns += ns;
+}
+
+/* « ; » sépare les cadres, le dernier espace précède le compte */
+static void append_frame(struct profile *profile, const char *name, size_t line)
+{
+    char label[32];
+
+    if (profile->path.len > 0)
+        strbuf_putc(&profile->path, ';');
+    for (const char *c = name; *c; c++)
+        strbuf_putc(&profile->path, *c == ';' || *c == ' ' ? '_' : *c);
+    snprintf(label, sizeof(label), ":%zu", line);
+    strbuf_append(&profile->path, label, strlen(label));
+}
+
+void profile_enter(struct profile *profile, size_t line, const char *name,
+                   unsigned long forks)
+{
+    if (profile->depth == profile->frame_capacity)
+    {
+        size_t capacity = profile->frame_capacity ? 2 * profile->frame_capacity : 16;
+        struct profile_frame *frames = realloc(profile->frames,
+                                               capacity * sizeof(struct profile_frame));
+        if (!frames)
+        {
+            profile->lost++;
+            return;
+        }
+        profile->frames = frames;
+        profile->frame_capacity = capacity;
+    }
+
+    struct profile_frame *frame = &profile->frames[profile->depth++];
+    struct profile_line *entry = get_line(profile, line);
+
+    memset(frame, 0, sizeof(*frame));
+    frame->line = line;
+    frame->forks = forks;
+    frame->path_len = profile->path.len;
+    if (entry && !entry->name)
+    {
+        entry->name = strdup(name);
+        frame->named = 1;
+    }
+    append_frame(profile, name, line);
+
+    children_cpu(&frame->user_us, &frame->sys_us);
+    frame->start = stats_now();
+}
+
+void profile_name(struct profile *profile, const char *name)
+{
+    if (profile->lost > 0 || profile->depth == 0)
+        return;
+
+    struct profile_frame *frame = &profile->frames[profile->depth - 1];
+    struct profile_line *entry = get_line(profile, frame->line);
+    if (entry && frame->named)
+    {
+        char *copy = strdup(name);
+        if (copy)
+        {
+            free(entry->name);
+            entry->name = copy;
+        }
+    }
+
+    /* Les cadres des substitutions, déjà sortis, gardent l'ancien nom */
+    profile->path.len = frame->path_len;
+    append_frame(profile, name, frame->line);
+}
+
+void profile_leave(struct profile *profile, unsigned long forks)
+{
+    if (profile->lost > 0)
+    {
+        profile->lost--;
+        return;
+    }
+
+    uint64_t now = stats_now();
+    uint64_t user_us;
+    uint64_t sys_us;
+    children_cpu(&user_us, &sys_us);
+
+    struct profile_frame *frame = &profile->frames[--profile->depth];
+    uint64_t elapsed = now - frame->start;
+    uint64_t user = user_us - frame->user_us;
+    uint64_t sys = sys_us - frame->sys_us;
+    unsigned long forked = forks - frame->forks;
+
+    struct profile_line *entry = get_line(profile, frame->line);
+    if (entry)
+    {
+        entry->wall_ns += elapsed - frame->nested_ns;
+        entry->user_us += user - frame->nested_user_us;
+        entry->sys_us += sys - frame->nested_sys_us;
+        entry->forks += forked - frame->nested_forks;
+        entry->calls++;
+    }
+    add_stack(profile, elapsed - frame->nested_ns);
+    profile->path.len = frame->path_len;
+    if (profile->path.data)
+        profile->path.data[profile->path.len] = '\0';
+
+    if (profile->depth > 0)
+    {
+        struct profile_frame *parent = frame - 1;
+        parent->nested_ns += elapsed;
+        parent->nested_user_us += user;
+        parent->nested_sys_us += sys;
+        parent->nested_forks += forked;
+    }
+}
+
+static const struct profile_line *sort_lines;
+
+static int compare_lines(const void *a, const void *b)
+{
+    uint64_t x = sort_lines[*(const size_t *)a].wall_ns;
+    uint64_t y = sort_lines[*(const size_t *)b].wall_ns;
+    return (x < y) - (x > y);
+}
+
+static void report(struct profile *profile, FILE *out)
+{
+    size_t count = 0;
+    size_t *order = malloc(sizeof(size_t) * (profile->line_capacity + 1));
+    if (!order)
+        return;
+    for (size_t i = 0; i < profile->line_capacity; i++)
+    {
+        if (profile->lines[i].calls)
+            order[count++] = i;
+    }
+    sort_lines = profile->lines;
+    qsort(order, count, sizeof(size_t), compare_lines);
+
+    double total_ms = (stats_now() - profile->start) / 1e6;
+    fprintf(out, "minishell profile: %.3f ms wall, %zu lines\n", total_ms, count);
+    fprintf(out, "%6s %9s %11s %7s %10s %10s %7s  %s\n", "line", "calls", "self_ms",
+            "self%", "child_usr", "child_sys", "forks", "command");
+    for (size_t i = 0; i < count && i < PROFILE_REPORT_LINES; i++)
+    {
+        const struct profile_line *line = &profile->lines[order[i]];
+        double ms = line->wall_ns / 1e6;
+        fprintf(out, "%6zu %9lu %11.3f %6.1f%% %10.3f %10.3f %7lu  %s\n", order[i],
+                line->calls, ms, total_ms > 0 ? 100 * ms / total_ms : 0,
+                line->user_us / 1e3, line->sys_us / 1e3, line->forks,
+                line->name ? line->name : "");
+    }
+    free(order);
+}
+
+/* Format replié : « cadre;cadre;... microsecondes » par ligne */
+static void write_folded(struct profile *profile)
+{
+    FILE *file = fopen(profile->folded_path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "minishell: %s: %s\n", profile->folded_path, strerror(errno));
+        return;
+    }
+    for (size_t i = 0; i < profile->stack_capacity; i++)
+    {
+        const struct profile_stack *stack = &profile->stacks[i];
+        if (stack->key && stack->ns >= 1000)
+            fprintf(file, "%s %llu\n", stack->key, (unsigned long long)(stack->ns / 1000));
+    }
+    fclose(file);
+}
+
+void profile_finish(struct profile *profile, FILE *out)
+{
+    if (!profile)
+        return;
+
+    if (out)
+        report(profile, out);
+    if (out && profile->folded_path)
+        write_folded(profile);
+
+    for (size_t i = 0; i < profile->line_capacity; i++)
+        free(profile->lines[i].name);
+    for (size_t i = 0; i < profile->stack_capacity; i++)
+        free(profile->stacks[i].key);
+    free(profile->lines);
+    free(profile->frames);
+    free(profile->stacks);
+    strbuf_free(&profile->path);
+    free(profile->folded_path);
+    free(profile);
+}
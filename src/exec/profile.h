@@ -0,0 +1,73 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "../all.h"
+#include "../string_utils.h"
+#include <stdint.h>
+
+/* Profil par ligne du script (--profile). Chaque commande simple exécutée
+ * est un cadre : son temps propre (sans les commandes qu'elle appelle, corps
+ * de fonction ou substitution), le CPU des fils attendus pendant ce temps
+ * et ses forks vont à sa ligne. La pile des cadres actifs donne aussi les
+ * piles « repliées » des outils de flamegraph. */
+struct profile_line {
+    uint64_t wall_ns;       /* temps propre */
+    uint64_t user_us;       /* CPU des fils */
+    uint64_t sys_us;
+    unsigned long forks;
+    unsigned long calls;
+    char *name;             /* première commande vue sur la ligne, expansée */
+};
+
+struct profile_frame {
+    uint64_t start;
+    uint64_t user_us;       /* CPU des fils au début du cadre */
+    uint64_t sys_us;
+    unsigned long forks;
+    uint64_t nested_ns;     /* déjà attribué aux cadres appelés */
+    uint64_t nested_user_us;
+    uint64_t nested_sys_us;
+    unsigned long nested_forks;
+    size_t line;
+    size_t path_len;        /* longueur de la pile repliée avant ce cadre */
+    int named;              /* le nom de sa ligne vient de ce cadre */
+};
+
+struct profile_stack {
+    char *key;
+    uint64_t ns;
+    unsigned int hash;
+};
+
+struct profile {
+    struct profile_line *lines;
+    size_t line_capacity;
+    struct profile_frame *frames;
+    size_t depth;
+    size_t frame_capacity;
+    size_t lost;            /* cadres non empilés faute de mémoire */
+    struct strbuf path;     /* pile repliée courante : « nom:ligne;... » */
+    struct profile_stack *stacks;
+    size_t stack_count;
+    size_t stack_capacity;
+    char *folded_path;      /* NULL : pas de sortie repliée */
+    uint64_t start;
+};
+
+struct profile *profile_new(const char *folded_path);
+
+/* Entrée et sortie d'une commande ; forks est le compteur de forks du shell */
+void profile_enter(struct profile *profile, size_t line, const char *name,
+                   unsigned long forks);
+void profile_leave(struct profile *profile, unsigned long forks);
+
+/* Nom définitif du cadre courant, son argv[0] une fois la commande expansée :
+ * profile_enter reçoit le mot tel qu'écrit ($cmd), l'expansion ayant lieu
+ * dans le cadre pour que ses substitutions lui soient attribuées */
+void profile_name(struct profile *profile, const char *name);
+
+/* Rapport des lignes les plus coûteuses sur out, piles repliées dans le
+ * fichier demandé, puis libération. Avec out à NULL, libère seulement. */
+void profile_finish(struct profile *profile, FILE *out);
+
+#endif /* PROFILE_H */
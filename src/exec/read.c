@@ -0,0 +1,279 @@
+#include "read.h"
+#include "builtins.h"
+#include "vars.h"
+
+void read_cache_free(struct read_cache *cache)
+{
+    if (!cache)
+        return;
+    for (int i = 0; i < READ_BUFFERS; i++)
+        free(cache->buffers[i]);
+    strbuf_free(&cache->line);
+    strbuf_free(&cache->literal);
+    free(cache);
+}
+
+/* Tampon du fichier ouvert sur fd. Sur un fichier, les données gardées ne
+ * servent que si personne n'a déplacé la position depuis le dernier read. */
+static struct read_buffer *get_buffer(struct read_cache *cache, int fd)
+{
+    struct read_buffer *buffer = NULL;
+    struct read_buffer *oldest = NULL;
+    struct stat st;
+
+    if (fstat(fd, &st) == -1)
+        return NULL;
+
+    for (int i = 0; i < READ_BUFFERS && !buffer; i++)
+    {
+        struct read_buffer *candidate = cache->buffers[i];
+        if (!candidate)
+        {
+            candidate = malloc(sizeof(struct read_buffer));
+            if (!candidate)
+                return NULL;
+            candidate->dev = st.st_dev;
+            candidate->ino = st.st_ino;
+            candidate->len = 0;
+            candidate->start = 0;
+            candidate->offset = -1;
+            cache->buffers[i] = candidate;
+            buffer = candidate;
+        }
+        else if (candidate->dev == st.st_dev && candidate->ino == st.st_ino)
+            buffer = candidate;
+        else if (!oldest || candidate->used < oldest->used)
+            oldest = candidate;
+    }
+    if (!buffer)
+    {
+        buffer = oldest;
+        buffer->dev = st.st_dev;
+        buffer->ino = st.st_ino;
+        buffer->len = 0;
+        buffer->start = 0;
+        buffer->offset = -1;
+    }
+    buffer->used = ++cache->clock;
+
+    off_t position = lseek(fd, 0, SEEK_CUR);
+    buffer->seekable = position != -1;
+    if (buffer->seekable && position != buffer->offset + (off_t)buffer->start)
+    {
+        buffer->offset = position;
+        buffer->start = 0;
+        buffer->len = 0;
+    }
+    return buffer;
+}
+
+/* Lit un nouveau bloc après les données restantes ; renvoie 0 en fin de
+ * fichier, -1 en cas d'erreur. */
+static ssize_t fill_buffer(struct read_buffer *buffer, int fd)
+{
+    if (buffer->start > 0)
+    {
+        memmove(buffer->data, buffer->data + buffer->start, buffer->len - buffer->start);
+        buffer->len -= buffer->start;
+        buffer->offset += buffer->start;
+        buffer->start = 0;
+    }
+
+    ssize_t n;
+    do
+        n = read(fd, buffer->data + buffer->len, READ_BUFFER_SIZE - buffer->len);
+    while (n == -1 && errno == EINTR);
+    if (n > 0)
+        buffer->len += n;
+    return n;
+}
+
+/* Ajoute à line les octets jusqu'au prochain '\n', exclu. Renvoie 1 si la
+ * ligne est complète, 0 en fin d'entrée, -1 en cas d'erreur. */
+static int read_line(struct read_buffer *buffer, int fd, struct strbuf *line)
+{
+    for (;;)
+    {
+        char *data = buffer->data + buffer->start;
+        size_t available = buffer->len - buffer->start;
+        char *newline = memchr(data, '\n', available);
+
+        if (newline)
+        {
+            if (strbuf_append(line, data, newline - data) == -1)
+                return -1;
+            buffer->start += newline - data + 1;
+            return 1;
+        }
+        if (strbuf_append(line, data, available) == -1)
+            return -1;
+        buffer->start = buffer->len;
+
+        ssize_t n = fill_buffer(buffer, fd);
+        if (n <= 0)
+            return n == 0 ? 0 : -1;
+    }
+}
+
+static int is_separator(struct read_cache *cache, const char *ifs, size_t i)
+{
+    char c = cache->line.data[i];
+    return !cache->literal.data[i] && c != '\0' && strchr(ifs, c);
+}
+
+/* Retire les '\\' de la ligne et marque les caractères qu'ils protègent */
+static int unescape_line(struct read_cache *cache)
+{
+    struct strbuf *line = &cache->line;
+    size_t j = 0;
+
+    strbuf_reset(&cache->literal);
+    if (strbuf_reserve(&cache->literal, line->len) == -1)
+        return -1;
+    for (size_t i = 0; i < line->len; i++)
+    {
+        int escaped = line->data[i] == '\\' && i + 1 < line->len;
+        if (escaped)
+            i++;
+        line->data[j] = line->data[i];
+        cache->literal.data[j++] = escaped;
+    }
+    line->len = j;
+    line->data[j] = '\0';
+    cache->literal.len = j;
+    return 0;
+}
+
+/* Découpage POSIX : chaque variable reçoit un champ, la dernière le reste
+ * de la ligne sans les blancs de IFS qui l'entourent. */
+static int assign_fields(struct read_cache *cache, char **names, int count,
+                         struct exec_state *state)
+{
+    const char *ifs = vars_get(state->vars, "IFS", 3);
+    const char *line = cache->line.data;
+    size_t len = cache->line.len;
+    size_t i = 0;
+
+    if (!ifs)
+        ifs = IFS_DEFAULT;
+    /* Sans nom de variable, REPLY reçoit la ligne telle quelle */
+    if (count == 0)
+        return vars_set(state->vars, "REPLY", 5, line, len, 0);
+    while (i < len && !cache->literal.data[i] && ifs_is_space(ifs, line[i]))
+        i++;
+
+    for (int v = 0; v < count; v++)
+    {
+        size_t start = i;
+        size_t end;
+
+        if (v == count - 1)
+        {
+            end = len;
+            while (end > start && !cache->literal.data[end - 1] &&
+                   ifs_is_space(ifs, line[end - 1]))
+                end--;
+        }
+        else
+        {
+            while (i < len && !is_separator(cache, ifs, i))
+                i++;
+            end = i;
+            /* Blancs, puis au plus un séparateur non blanc, puis blancs */
+            while (i < len && !cache->literal.data[i] && ifs_is_space(ifs, line[i]))
+                i++;
+            if (i < len && is_separator(cache, ifs, i) && !ifs_is_space(ifs, line[i]))
+                i++;
+            while (i < len && !cache->literal.data[i] && ifs_is_space(ifs, line[i]))
+                i++;
+        }
+        if (vars_set(state->vars, names[v], strlen(names[v]), line + start, end - start, 0) == -1)
+            return -1;
+    }
+    return 0;
+}
+
+/* read [-r] [nom...] : une ligne de l'entrée, découpée selon IFS */
+int builtin_read(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    int raw = 0;
+    int i = 1;
+
+    for (; i < arg_count && args[i][0] == '-' && args[i][1]; i++)
+    {
+        if (strcmp(args[i], "--") == 0)
+        {
+            i++;
+            break;
+        }
+        if (strcmp(args[i], "-r") != 0)
+        {
+            builtin_error(io, "minishell: read: %s: invalid option\n", args[i]);
+            return 2;
+        }
+        raw = 1;
+    }
+
+    char **names = args + i;
+    int count = arg_count - i;
+    for (int k = 0; k < count; k++)
+    {
+        if (!is_valid_name(names[k], strlen(names[k])))
+        {
+            builtin_error(io, "minishell: read: `%s': not a valid identifier\n", names[k]);
+            return 1;
+        }
+    }
+
+    if (!state->reads)
+        state->reads = calloc(1, sizeof(struct read_cache));
+    struct read_cache *cache = state->reads;
+    struct read_buffer *buffer = cache ? get_buffer(cache, io->in_fd) : NULL;
+    if (!buffer)
+    {
+        builtin_error(io, "minishell: read: %s\n", strerror(errno));
+        return 1;
+    }
+
+    int complete;
+    strbuf_reset(&cache->line);
+    for (;;)
+    {
+        complete = read_line(buffer, io->in_fd, &cache->line);
+        if (complete != 1 || raw)
+            break;
+
+        /* Un '\\' en fin de ligne la prolonge sur la suivante */
+        size_t backslashes = 0;
+        while (backslashes < cache->line.len &&
+               cache->line.data[cache->line.len - 1 - backslashes] == '\\')
+            backslashes++;
+        if (backslashes % 2 == 0)
+            break;
+        cache->line.data[--cache->line.len] = '\0';
+    }
+    if (buffer->seekable)
+        lseek(io->in_fd, buffer->offset + buffer->start, SEEK_SET);
+
+    if (complete == -1)
+    {
+        builtin_error(io, "minishell: read: %s\n", strerror(errno));
+        return 1;
+    }
+    if (!cache->line.data && strbuf_reserve(&cache->line, 0) == -1)
+        return 1;
+
+    if (raw)
+    {
+        strbuf_reset(&cache->literal);
+        if (strbuf_reserve(&cache->literal, cache->line.len) == -1)
+            return 1;
+        memset(cache->literal.data, 0, cache->line.len);
+    }
+    else if (unescape_line(cache) == -1)
+        return 1;
+
+    if (assign_fields(cache, names, count, state) == -1)
+        return 1;
+    return complete == 1 ? 0 : 1;
+}
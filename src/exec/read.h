@@ -0,0 +1,36 @@
+#ifndef READ_H
+#define READ_H
+
+#include "../all.h"
+#include "../string_utils.h"
+#include <sys/stat.h>
+
+/* Tampons du builtin read, un par fichier ouvert (identifié par son inode).
+ * Sur un fd où l'on peut se déplacer, la position du fichier est remise
+ * juste après la ligne lue, comme si read avait lu octet par octet. Sur un
+ * pipe, les octets lus d'avance restent dans le tampon pour les read
+ * suivants : une autre commande qui lit le même pipe ne les voit pas. */
+#define READ_BUFFER_SIZE (64 * 1024)
+#define READ_BUFFERS 4
+
+struct read_buffer {
+    dev_t dev;
+    ino_t ino;
+    int seekable;
+    off_t offset;           /* position dans le fichier de data[0] */
+    size_t start;           /* données non consommées : data[start, len) */
+    size_t len;
+    unsigned long used;     /* dernier usage, pour le remplacement */
+    char data[READ_BUFFER_SIZE];
+};
+
+struct read_cache {
+    struct read_buffer *buffers[READ_BUFFERS];
+    unsigned long clock;
+    struct strbuf line;
+    struct strbuf literal;  /* caractères échappés par '\\' : pas de découpage */
+};
+
+void read_cache_free(struct read_cache *cache);
+
+#endif /* READ_H */
@@ -0,0 +1,375 @@
+#include "server.h"
+#include "exec.h"
+#include "input.h"
+#include "vars.h"
+#include "path.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/* Les fils terminés sont attendus au plus tard après ce délai */
+#define SERVER_POLL_MS 200
+/* Un client qui n'a pas fini d'envoyer sa requête après ce délai est rejeté */
+#define SERVER_RECV_TIMEOUT_S 5
+/* Connexions dont la requête est en cours de lecture ; au-delà, les
+ * suivantes attendent dans la file de listen */
+#define SERVER_MAX_PENDING 64
+
+/* Requête en cours de lecture : le serveur lit ce qui est arrivé sur chaque
+ * connexion sans jamais attendre un client en particulier */
+struct server_conn {
+    int fd;
+    struct server_request request;
+    size_t header_done;
+    int fds[3];
+    char *text;
+    size_t text_done;
+    uint64_t deadline;
+};
+
+struct server {
+    int listen_fd;
+    unsigned long requests;
+    unsigned long stats_requests;
+    unsigned long rejected;     /* requêtes invalides ou fork impossible */
+    unsigned long active;
+    unsigned long completed;
+    unsigned long failed;       /* fils sortis avec un statut non nul */
+    struct timeval worker_user; /* CPU des fils attendus */
+    struct timeval worker_sys;
+    uint64_t start;
+    struct server_conn pending[SERVER_MAX_PENDING];
+    size_t pending_count;
+};
+
+static volatile sig_atomic_t server_stop;
+
+static void stop_server(int sig)
+{
+    (void)sig;
+    server_stop = 1;
+}
+
+static int open_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    size_t len = strlen(path);
+
+    if (len >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    /* La socket d'un serveur précédent est remplacée, tout autre fichier gardé */
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, len + 1);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+        listen(fd, SOMAXCONN) == -1)
+    {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/* Garde les trois fds de SCM_RIGHTS ; tout autre envoi de fds est refermé.
+ * Le tampon de contrôle n'a de place que pour trois fds. */
+static void take_fds(struct msghdr *msg, int fds[3])
+{
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        int received[3];
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if (count > 3)
+            count = 3;
+        memcpy(received, CMSG_DATA(cmsg), count * sizeof(int));
+        if (count == 3 && fds[0] == -1)
+            memcpy(fds, received, sizeof(received));
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+                close(received[i]);
+        }
+    }
+}
+
+/* Lit ce qui est arrivé : l'en-tête et ses fds, puis le texte, terminé par
+ * '\0'. Renvoie 1 quand la requête est complète, 0 s'il manque des octets,
+ * -1 si elle est invalide ou si le client est parti. */
+static int read_request(struct server_conn *conn)
+{
+    struct server_request *request = &conn->request;
+    ssize_t n;
+
+    if (conn->header_done < sizeof(*request))
+    {
+        char control[CMSG_SPACE(3 * sizeof(int))];
+        struct iovec iov = { (char *)request + conn->header_done,
+                             sizeof(*request) - conn->header_done };
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        n = recvmsg(conn->fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+        if (n == -1)
+            return errno == EAGAIN || errno == EINTR ? 0 : -1;
+        if (n == 0)
+            return -1;
+        take_fds(&msg, conn->fds);
+        conn->header_done += n;
+        if (conn->header_done < sizeof(*request))
+            return 0;
+        if (request->length > SERVER_MAX_COMMAND)
+            return -1;
+        conn->text = malloc(request->length + 1);
+        if (!conn->text)
+            return -1;
+    }
+
+    while (conn->text_done < request->length)
+    {
+        n = recv(conn->fd, conn->text + conn->text_done, request->length - conn->text_done,
+                 MSG_DONTWAIT);
+        if (n == -1)
+            return errno == EAGAIN || errno == EINTR ? 0 : -1;
+        if (n == 0)
+            return -1;
+        conn->text_done += n;
+    }
+    conn->text[conn->text_done] = '\0';
+    return 1;
+}
+
+static void send_reply(int conn, int status, const char *data, size_t len)
+{
+    struct server_reply reply = { status, len };
+
+    if (send(conn, &reply, sizeof(reply), MSG_NOSIGNAL) == sizeof(reply) && len > 0)
+        send(conn, data, len, MSG_NOSIGNAL);
+}
+
+static void reply_stats(struct server *server, int conn)
+{
+    char text[512];
+    int len = snprintf(text, sizeof(text),
+                       "{\"pid\": %ld, \"uptime_s\": %.3f, \"requests\": %lu, "
+                       "\"stats_requests\": %lu, \"rejected\": %lu, \"active\": %lu, "
+                       "\"completed\": %lu, \"failed\": %lu, \"worker_user_s\": %.6f, "
+                       "\"worker_sys_s\": %.6f}\n", (long)getpid(),
+                       (stats_now() - server->start) / 1e9, server->requests,
+                       server->stats_requests, server->rejected, server->active,
+                       server->completed, server->failed,
+                       server->worker_user.tv_sec + server->worker_user.tv_usec / 1e6,
+                       server->worker_sys.tv_sec + server->worker_sys.tv_usec / 1e6);
+    send_reply(conn, 0, text, len);
+}
+
+/* Fils : les fds reçus deviennent 0, 1 et 2, la commande s'exécute comme
+ * une chaîne de -c et son statut part vers le client */
+static void run_worker(struct server *server, int conn, int fds[3], char *text,
+                       struct exec_state *state)
+{
+    int moved[3];
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    close(server->listen_fd);
+    /* Les autres connexions en cours et leurs fds restent au serveur */
+    for (size_t i = 0; i < server->pending_count; i++)
+    {
+        struct server_conn *other = &server->pending[i];
+        if (other->fd == conn)
+            continue;
+        close(other->fd);
+        for (int j = 0; j < 3; j++)
+        {
+            if (other->fds[j] != -1)
+                close(other->fds[j]);
+        }
+    }
+    /* par un fd haut : un fd reçu peut valoir 0, 1 ou 2 */
+    for (int i = 0; i < 3; i++)
+        moved[i] = fcntl(fds[i], F_DUPFD_CLOEXEC, 3);
+    for (int i = 0; i < 3; i++)
+    {
+        if (moved[i] == -1 || dup2(moved[i], i) == -1)
+            _exit(126);
+        close(moved[i]);
+        close(fds[i]);
+    }
+
+    input_process(text, 1, state);
+    int status = state->should_exit ? state->exit_code : state->last_return;
+    fflush(stdout);
+    send_reply(conn, status, NULL, 0);
+    _exit(status);
+}
+
+/* Requête complète (valid) ou rejetée ; la connexion est ensuite fermée */
+static void serve(struct server *server, struct server_conn *conn, int valid,
+                  struct exec_state *state)
+{
+    struct server_request *request = &conn->request;
+
+    if (valid && request->kind == SERVER_STATS)
+    {
+        server->stats_requests++;
+        reply_stats(server, conn->fd);
+    }
+    else if (valid && request->kind == SERVER_RUN && conn->fds[0] != -1)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+            run_worker(server, conn->fd, conn->fds, conn->text, state);
+        if (pid == -1)
+        {
+            server->rejected++;
+            send_reply(conn->fd, -1, NULL, 0);
+        }
+        else
+        {
+            server->requests++;
+            server->active++;
+        }
+    }
+    else
+    {
+        server->rejected++;
+        send_reply(conn->fd, -1, NULL, 0);
+    }
+}
+
+static void drop_conn(struct server *server, size_t i)
+{
+    struct server_conn *conn = &server->pending[i];
+
+    for (int j = 0; j < 3; j++)
+    {
+        if (conn->fds[j] != -1)
+            close(conn->fds[j]);
+    }
+    close(conn->fd);
+    free(conn->text);
+    *conn = server->pending[--server->pending_count];
+}
+
+static void accept_conn(struct server *server)
+{
+    int fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd == -1)
+        return;
+
+    struct server_conn *conn = &server->pending[server->pending_count++];
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = fd;
+    for (int i = 0; i < 3; i++)
+        conn->fds[i] = -1;
+    conn->deadline = stats_now() + SERVER_RECV_TIMEOUT_S * 1000000000ull;
+}
+
+static void reap_workers(struct server *server, int options)
+{
+    struct rusage usage;
+    int status;
+
+    while (server->active > 0 && wait4(-1, &status, options, &usage) > 0)
+    {
+        server->active--;
+        server->completed++;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            server->failed++;
+        timeradd(&server->worker_user, &usage.ru_utime, &server->worker_user);
+        timeradd(&server->worker_sys, &usage.ru_stime, &server->worker_sys);
+    }
+}
+
+int server_run(const char *path, struct exec_state *state)
+{
+    struct server server;
+
+    memset(&server, 0, sizeof(server));
+    server.start = stats_now();
+    server.listen_fd = open_socket(path);
+    if (server.listen_fd == -1)
+    {
+        fprintf(stderr, "minishell: %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    /* Indexées et cherchées une fois ici plutôt que dans chaque fils */
+    vars_load(state->vars);
+    const char *search = vars_get(state->vars, "PATH", 4);
+    path_preload(&state->paths, search ? search : "/bin:/usr/bin");
+
+    struct sigaction action;
+    struct sigaction previous_int;
+    struct sigaction previous_term;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_server;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &previous_int);
+    sigaction(SIGTERM, &action, &previous_term);
+
+    /* polls[0] : la socket d'écoute, puis une entrée par connexion en cours */
+    struct pollfd polls[1 + SERVER_MAX_PENDING];
+    server_stop = 0;
+    while (!server_stop)
+    {
+        size_t count = server.pending_count;
+        polls[0].fd = server.listen_fd;
+        polls[0].events = count < SERVER_MAX_PENDING ? POLLIN : 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            polls[1 + i].fd = server.pending[i].fd;
+            polls[1 + i].events = POLLIN;
+        }
+
+        int ready = poll(polls, 1 + count, SERVER_POLL_MS);
+        reap_workers(&server, WNOHANG);
+        if (ready == -1)
+            continue;
+
+        /* Du dernier au premier : drop_conn déplace la dernière connexion,
+         * déjà traitée, à la place de celle retirée */
+        uint64_t now = stats_now();
+        for (size_t i = count; i > 0; i--)
+        {
+            struct server_conn *conn = &server.pending[i - 1];
+            int done = polls[i].revents ? read_request(conn) : 0;
+            if (done == 0 && now < conn->deadline)
+                continue;
+            serve(&server, conn, done == 1, state);
+            drop_conn(&server, i - 1);
+        }
+        if (polls[0].revents & POLLIN)
+            accept_conn(&server);
+    }
+
+    while (server.pending_count > 0)
+        drop_conn(&server, 0);
+    close(server.listen_fd);
+    unlink(path);
+    reap_workers(&server, 0);
+    sigaction(SIGINT, &previous_int, NULL);
+    sigaction(SIGTERM, &previous_term, NULL);
+    return 0;
+}
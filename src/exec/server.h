@@ -0,0 +1,44 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "../all.h"
+#include <stdint.h>
+
+/* Mode serveur (--server SOCKET) : un shell gardé chaud écoute sur une
+ * socket Unix. Chaque requête SERVER_RUN est exécutée par un fils forké du
+ * serveur, qui hérite de ses variables indexées, de ses fonctions et de
+ * la table des commandes de PATH, remplie au démarrage (path_preload) ;
+ * les requêtes s'exécutent donc en parallèle et ce qu'une commande change
+ * (cd, variables) ne touche pas les suivantes.
+ *
+ * Une requête est un en-tête suivi de length octets de texte. SERVER_RUN
+ * porte en données auxiliaires (SCM_RIGHTS) les trois fds qui deviennent
+ * l'entrée, la sortie et la sortie d'erreur de la commande. Le serveur lit
+ * les requêtes de toutes ses connexions à mesure qu'elles arrivent : un
+ * client lent ou muet ne retarde pas les autres et il est rejeté après
+ * quelques secondes. */
+#define SERVER_RUN 1
+#define SERVER_STATS 2
+
+#define SERVER_MAX_COMMAND (1024 * 1024)
+
+struct server_request {
+    uint32_t kind;
+    uint32_t length;
+};
+
+/* Réponse : code de sortie de la commande (-1 si la requête est invalide),
+ * puis pour SERVER_STATS un objet JSON de length octets. */
+struct server_reply {
+    int32_t status;
+    uint32_t length;
+};
+
+struct exec_state;
+
+/* Sert les requêtes jusqu'à SIGINT ou SIGTERM, puis attend les fils en
+ * cours et retire la socket. Renvoie 0, ou 1 si la socket n'a pas pu être
+ * créée. */
+int server_run(const char *path, struct exec_state *state);
+
+#endif /* SERVER_H */
@@ -0,0 +1,126 @@
+#include <stddef.h>
+#include "stats.h"
+#include "builtins.h"
+
+enum field_kind {
+    FIELD_COUNTER,
+    FIELD_DURATION,
+    FIELD_ALLOCS        /* allocs[] de l'état, offset : la phase */
+};
+
+struct stats_field {
+    const char *name;
+    size_t offset;
+    enum field_kind kind;
+};
+
+#define COUNTER(field) { #field, offsetof(struct shell_stats, field), FIELD_COUNTER }
+#define DURATION(field, name) { name, offsetof(struct shell_stats, field), FIELD_DURATION }
+#define ALLOCS(phase, name) { name, phase, FIELD_ALLOCS }
+
+static const struct stats_field fields[] = {
+    COUNTER(lines),
+    COUNTER(tokens),
+    COUNTER(nodes),
+    COUNTER(builtins),
+    COUNTER(forks),
+    COUNTER(execs),
+    COUNTER(path_probes),
+    COUNTER(redirections),
+    DURATION(parse_ns, "parse_ms"),
+    DURATION(path_ns, "path_ms"),
+    DURATION(fork_ns, "fork_ms"),
+    DURATION(wait_ns, "wait_ms"),
+    DURATION(redirect_ns, "redirect_ms"),
+    ALLOCS(ALLOC_PARSE, "allocs_parse"),
+    ALLOCS(ALLOC_EXPAND, "allocs_expand"),
+    ALLOCS(ALLOC_EXEC, "allocs_exec"),
+    ALLOCS(ALLOC_OTHER, "allocs_other"),
+};
+
+#define FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+void stats_add(struct shell_stats *to, const struct shell_stats *from)
+{
+    for (size_t i = 0; i < FIELD_COUNT; i++)
+    {
+        if (fields[i].kind == FIELD_DURATION)
+            *(uint64_t *)((char *)to + fields[i].offset) +=
+                *(const uint64_t *)((const char *)from + fields[i].offset);
+        else if (fields[i].kind == FIELD_COUNTER)
+            *(unsigned long *)((char *)to + fields[i].offset) +=
+                *(const unsigned long *)((const char *)from + fields[i].offset);
+        else
+            to->allocs[fields[i].offset] += from->allocs[fields[i].offset];
+    }
+}
+
+int stats_format(const struct shell_stats *stats, int json, struct strbuf *out)
+{
+    char line[64];
+
+    if (json && strbuf_putc(out, '{') == -1)
+        return -1;
+    for (size_t i = 0; i < FIELD_COUNT; i++)
+    {
+        const char *field = (const char *)stats + fields[i].offset;
+        const char *format = json ? "%s\"%s\": " : "%-14s";
+        int len = json ? snprintf(line, sizeof(line), format, i ? ", " : "", fields[i].name)
+                       : snprintf(line, sizeof(line), format, fields[i].name);
+        if (fields[i].kind == FIELD_DURATION)
+            len += snprintf(line + len, sizeof(line) - len, "%.3f",
+                            *(const uint64_t *)field / 1e6);
+        else if (fields[i].kind == FIELD_ALLOCS)
+            len += snprintf(line + len, sizeof(line) - len, "%lu",
+                            stats->allocs[fields[i].offset]);
+        else
+            len += snprintf(line + len, sizeof(line) - len, "%lu",
+                            *(const unsigned long *)field);
+        if (!json)
+            line[len++] = '\n';
+        if (strbuf_append(out, line, len) == -1)
+            return -1;
+    }
+    return json ? strbuf_append(out, "}\n", 2) : 0;
+}
+
+/* stats [-j] [-r] : affiche les compteurs du shell (-j en JSON) ; -r les
+ * remet à zéro sans rien afficher */
+int builtin_stats(char **args, int arg_count, struct exec_state *state, struct builtin_io *io)
+{
+    int json = 0;
+    int reset = 0;
+
+    for (int i = 1; i < arg_count; i++)
+    {
+        if (args[i][0] != '-' || !args[i][1])
+        {
+            builtin_error(io, "minishell: stats: usage: stats [-j] [-r]\n");
+            return 2;
+        }
+        for (const char *c = args[i] + 1; *c; c++)
+        {
+            if (*c == 'j')
+                json = 1;
+            else if (*c == 'r')
+                reset = 1;
+            else
+            {
+                builtin_error(io, "minishell: stats: -%c: invalid option\n", *c);
+                return 2;
+            }
+        }
+    }
+
+    if (reset)
+    {
+        memset(&state->stats, 0, sizeof(state->stats));
+        return 0;
+    }
+
+    struct strbuf out = { NULL, 0, 0 };
+    int ret = stats_format(&state->stats, json, &out) == -1 ||
+              builtin_io_write(io, out.data, out.len) == -1;
+    strbuf_free(&out);
+    return ret;
+}
@@ -0,0 +1,42 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "../all.h"
+#include "../string_utils.h"
+#include "alloc.h"
+#include <stdint.h>
+#include <time.h>
+
+/* Compteurs par phase, affichés par le builtin stats. Chaque processus a
+ * les siens : ce que fait un fils (étage forké, substitution) n'est pas
+ * remonté. Les durées sont en nanosecondes d'horloge monotone. */
+struct shell_stats {
+    unsigned long lines;
+    unsigned long tokens;
+    unsigned long nodes;
+    unsigned long builtins;
+    unsigned long forks;
+    unsigned long execs;
+    unsigned long path_probes;  /* access() pendant la recherche dans PATH */
+    unsigned long redirections;
+    uint64_t parse_ns;          /* lexing et analyse */
+    uint64_t path_ns;
+    uint64_t fork_ns;
+    uint64_t wait_ns;
+    uint64_t redirect_ns;       /* redirections appliquées dans le shell */
+    unsigned long allocs[ALLOC_PHASES]; /* allocations par phase (alloc.h) */
+};
+
+static inline uint64_t stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void stats_add(struct shell_stats *to, const struct shell_stats *from);
+
+/* Texte « nom valeur » par ligne, ou un objet JSON sur une ligne */
+int stats_format(const struct shell_stats *stats, int json, struct strbuf *out);
+
+#endif /* STATS_H */
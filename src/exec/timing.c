@@ -0,0 +1,209 @@
+#include "timing.h"
+#include "stats.h"
+
+static double seconds(const struct timeval *tv)
+{
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+/* after - before, pour les champs affichés. ru_maxrss n'est pas cumulatif :
+ * la valeur de fin est gardée. */
+static void usage_delta(struct rusage *delta, const struct rusage *after,
+                        const struct rusage *before)
+{
+    memset(delta, 0, sizeof(*delta));
+    timersub(&after->ru_utime, &before->ru_utime, &delta->ru_utime);
+    timersub(&after->ru_stime, &before->ru_stime, &delta->ru_stime);
+    delta->ru_maxrss = after->ru_maxrss;
+    delta->ru_nvcsw = after->ru_nvcsw - before->ru_nvcsw;
+    delta->ru_nivcsw = after->ru_nivcsw - before->ru_nivcsw;
+}
+
+void time_begin(struct time_report *report)
+{
+    memset(report, 0, sizeof(*report));
+    getrusage(RUSAGE_SELF, &report->self);
+    getrusage(RUSAGE_CHILDREN, &report->children);
+    report->start = stats_now();
+}
+
+void time_record(struct time_report *report, const char *name, pid_t pid, int status,
+                 const struct rusage *usage)
+{
+    if (report->count == report->capacity)
+    {
+        size_t capacity = report->capacity ? 2 * report->capacity : 4;
+        struct time_stage *stages = report->count < TIME_MAX_STAGES
+            ? realloc(report->stages, capacity * sizeof(struct time_stage)) : NULL;
+        if (!stages)
+        {
+            report->lost++;
+            return;
+        }
+        report->stages = stages;
+        report->capacity = capacity;
+    }
+
+    struct time_stage *stage = &report->stages[report->count];
+    stage->name = strdup(name ? name : "");
+    if (!stage->name)
+    {
+        report->lost++;
+        return;
+    }
+    stage->pid = pid;
+    stage->status = status;
+    stage->usage = *usage;
+    memset(&stage->stall, 0, sizeof(stage->stall));
+    report->count++;
+}
+
+void time_record_stall(struct time_report *report, const struct pipe_stall *stall)
+{
+    if (report->count > 0)
+        report->stages[report->count - 1].stall = *stall;
+}
+
+static void write_string(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (; *str; str++)
+    {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+/* Format de bash : real\t0m0.012s */
+static void print_minutes(FILE *out, const char *label, double s)
+{
+    int minutes = s / 60;
+    fprintf(out, "%s\t%dm%.3fs\n", label, minutes, s - 60 * minutes);
+}
+
+/* Une ligne du tableau ; status négatif, stall NULL : sans objet */
+static void print_row(FILE *out, const char *label, pid_t pid, int status,
+                      const struct rusage *usage, const struct pipe_stall *stall,
+                      const char *name)
+{
+    if (pid > 0)
+        fprintf(out, "%-6s %7ld ", label, (long)pid);
+    else
+        fprintf(out, "%-6s %7s ", label, "-");
+    if (status < 0)
+        fprintf(out, "%6s", "-");
+    else
+        fprintf(out, "%6d", status);
+    fprintf(out, " %9.3f %9.3f %10ld %7ld %7ld", seconds(&usage->ru_utime),
+            seconds(&usage->ru_stime), usage->ru_maxrss, usage->ru_nvcsw,
+            usage->ru_nivcsw);
+    if (stall && stall->life_ns)
+        fprintf(out, " %5.1f", 100.0 * stall->blocked_ns / stall->life_ns);
+    else
+        fprintf(out, " %5s", "-");
+    fprintf(out, "  %s\n", name);
+}
+
+static void print_json_usage(FILE *out, const struct rusage *usage)
+{
+    fprintf(out, "\"user_s\": %.6f, \"sys_s\": %.6f, \"maxrss_kb\": %ld, "
+            "\"nvcsw\": %ld, \"nivcsw\": %ld", seconds(&usage->ru_utime),
+            seconds(&usage->ru_stime), usage->ru_maxrss, usage->ru_nvcsw,
+            usage->ru_nivcsw);
+}
+
+static void print_json(FILE *out, const struct time_report *report, double real,
+                       const struct rusage *shell, const struct rusage *total)
+{
+    fprintf(out, "{\"real_s\": %.6f, ", real);
+    print_json_usage(out, total);
+    fprintf(out, ", \"lost\": %zu, \"shell\": {", report->lost);
+    print_json_usage(out, shell);
+    fprintf(out, "}, \"stages\": [");
+    for (size_t i = 0; i < report->count; i++)
+    {
+        const struct time_stage *stage = &report->stages[i];
+        fprintf(out, "%s{\"command\": ", i ? ", " : "");
+        write_string(out, stage->name);
+        fprintf(out, ", \"pid\": %ld, \"status\": %d, ", (long)stage->pid, stage->status);
+        print_json_usage(out, &stage->usage);
+        if (stage->stall.life_ns)
+            fprintf(out, ", \"blocked_pct\": %.1f",
+                    100.0 * stage->stall.blocked_ns / stage->stall.life_ns);
+        fputc('}', out);
+    }
+    fprintf(out, "]}\n");
+}
+
+static void print_table(FILE *out, const struct time_report *report,
+                        const struct rusage *shell, const struct rusage *total)
+{
+    fprintf(out, "%-6s %7s %6s %9s %9s %10s %7s %7s %5s  %s\n", "stage", "pid", "status",
+            "user_s", "sys_s", "maxrss_kb", "nvcsw", "nivcsw", "blk%", "command");
+    for (size_t i = 0; i < report->count; i++)
+    {
+        char label[24];
+        snprintf(label, sizeof(label), "%zu", i + 1);
+        print_row(out, label, report->stages[i].pid, report->stages[i].status,
+                  &report->stages[i].usage, &report->stages[i].stall, report->stages[i].name);
+    }
+    if (report->lost)
+        fprintf(out, "(%zu more processes not listed)\n", report->lost);
+    print_row(out, "shell", getpid(), -1, shell, NULL, "");
+    print_row(out, "total", 0, -1, total, NULL, "");
+}
+
+void time_end(struct time_report *report, int format, FILE *out)
+{
+    double real = (stats_now() - report->start) / 1e9;
+    struct rusage now;
+    struct rusage shell;
+    struct rusage children;
+    struct rusage total;
+
+    getrusage(RUSAGE_SELF, &now);
+    usage_delta(&shell, &now, &report->self);
+    getrusage(RUSAGE_CHILDREN, &now);
+    usage_delta(&children, &now, &report->children);
+
+    /* Le total compte aussi les fils non listés (substitutions, lignes
+     * perdues) ; sa RSS est la plus grande des processus relevés. */
+    memset(&total, 0, sizeof(total));
+    timeradd(&shell.ru_utime, &children.ru_utime, &total.ru_utime);
+    timeradd(&shell.ru_stime, &children.ru_stime, &total.ru_stime);
+    total.ru_nvcsw = shell.ru_nvcsw + children.ru_nvcsw;
+    total.ru_nivcsw = shell.ru_nivcsw + children.ru_nivcsw;
+    for (size_t i = 0; i < report->count; i++)
+    {
+        if (report->stages[i].usage.ru_maxrss > total.ru_maxrss)
+            total.ru_maxrss = report->stages[i].usage.ru_maxrss;
+    }
+
+    if (format == TIME_FORMAT_POSIX)
+        fprintf(out, "real %.2f\nuser %.2f\nsys %.2f\n", real,
+                seconds(&total.ru_utime), seconds(&total.ru_stime));
+    else if (format == TIME_FORMAT_JSON)
+        print_json(out, report, real, &shell, &total);
+    else
+    {
+        print_table(out, report, &shell, &total);
+        fputc('\n', out);
+        print_minutes(out, "real", real);
+        print_minutes(out, "user", seconds(&total.ru_utime));
+        print_minutes(out, "sys", seconds(&total.ru_stime));
+    }
+    fflush(out);
+
+    for (size_t i = 0; i < report->count; i++)
+        free(report->stages[i].name);
+    free(report->stages);
+    report->stages = NULL;
+    report->count = 0;
+    report->capacity = 0;
+}
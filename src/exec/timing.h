@@ -0,0 +1,53 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "../all.h"
+#include "pipes.h"
+#include <stdint.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/* Mot réservé time. Sous time, chaque processus attendu par le shell (étage
+ * d'un pipeline, commande externe) est relevé avec le rusage de wait4 ; le
+ * rapport donne ces lignes, celle du shell lui-même et le total. Les étages
+ * d'un pipeline ont en plus leur part de temps bloqué (blk%, pipes.h),
+ * relevée à leur fin : le shell dort dans poll sur un pidfd par étage et ne
+ * se réveille qu'à chaque fin d'étage. Sans pidfd (noyau antérieur à 5.3),
+ * blk% vaut « - ». */
+#define TIME_FORMAT_DEFAULT 0
+#define TIME_FORMAT_POSIX 1     /* time -p : real, user et sys seulement */
+#define TIME_FORMAT_JSON 2      /* time -j */
+
+#define TIME_MAX_STAGES 64
+
+struct time_stage {
+    char *name;
+    pid_t pid;
+    int status;
+    struct rusage usage;
+    struct pipe_stall stall;    /* étage d'un pipeline : temps bloqué */
+};
+
+struct time_report {
+    struct time_stage *stages;
+    size_t count;
+    size_t capacity;
+    size_t lost;                /* processus au-delà de TIME_MAX_STAGES */
+    uint64_t start;
+    struct rusage self;         /* usages au début de la mesure */
+    struct rusage children;
+};
+
+void time_begin(struct time_report *report);
+
+/* Processus attendu pendant la mesure */
+void time_record(struct time_report *report, const char *name, pid_t pid, int status,
+                 const struct rusage *usage);
+
+/* Temps bloqué du dernier processus relevé */
+void time_record_stall(struct time_report *report, const struct pipe_stall *stall);
+
+/* Écrit le rapport sur out puis libère les lignes relevées */
+void time_end(struct time_report *report, int format, FILE *out);
+
+#endif /* TIMING_H */
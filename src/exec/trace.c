@@ -0,0 +1,149 @@
+#include "trace.h"
+#include "stats.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+struct trace_buffer *trace_buffer = NULL;
+
+static const char *const kind_names[] = {
+    [TRACE_PARSE] = "parse",
+    [TRACE_EXEC] = "exec",
+    [TRACE_FORK] = "fork",
+    [TRACE_CHILD] = "child",
+    [TRACE_WAIT] = "wait",
+};
+
+/* Sens de l'argument de chaque type de span */
+static const char *const arg_names[] = {
+    [TRACE_PARSE] = "line",
+    [TRACE_EXEC] = "status",
+    [TRACE_FORK] = "child",
+    [TRACE_CHILD] = "redirections",
+    [TRACE_WAIT] = "status",
+};
+
+static size_t mapping_size(size_t capacity)
+{
+    return sizeof(struct trace_buffer) + capacity * sizeof(struct trace_event);
+}
+
+int trace_start(const char *path, size_t capacity)
+{
+    if (capacity == 0)
+        capacity = TRACE_DEFAULT_EVENTS;
+
+    struct trace_buffer *buffer = mmap(NULL, mapping_size(capacity), PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED)
+        return -1;
+    buffer->path = strdup(path);
+    if (!buffer->path)
+    {
+        munmap(buffer, mapping_size(capacity));
+        return -1;
+    }
+    buffer->next = 0;
+    buffer->capacity = capacity;
+    buffer->origin = stats_now();
+    buffer->owner = getpid();
+    trace_buffer = buffer;
+    return 0;
+}
+
+void trace_span(enum trace_kind kind, const char *name, uint64_t start, long arg)
+{
+    struct trace_buffer *buffer = trace_buffer;
+    uint64_t end = stats_now();
+    uint64_t index = __atomic_fetch_add(&buffer->next, 1, __ATOMIC_RELAXED);
+    struct trace_event *event = &buffer->events[index % buffer->capacity];
+
+    /* Case invalidée avant d'être remplie, publiée en dernier */
+    __atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    event->start = start;
+    event->duration = end - start;
+    event->pid = getpid();
+    event->tid = syscall(SYS_gettid);
+    event->arg = arg;
+    event->kind = kind;
+    snprintf(event->name, sizeof(event->name), "%s", name ? name : "");
+    __atomic_store_n(&event->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+/* Copie la case du rang index si elle est complète et pas réécrite entre
+ * temps ; renvoie 0 sinon */
+static int read_event(struct trace_buffer *buffer, uint64_t index, struct trace_event *copy)
+{
+    struct trace_event *event = &buffer->events[index % buffer->capacity];
+
+    if (__atomic_load_n(&event->seq, __ATOMIC_ACQUIRE) != index + 1)
+        return 0;
+    *copy = *event;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&event->seq, __ATOMIC_RELAXED) == index + 1;
+}
+
+static void write_string(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (; *str; str++)
+    {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+/* Événements « X » (durée complète), du plus ancien encore dans l'anneau au
+ * plus récent. Les temps sont en microsecondes depuis le début de la trace.
+ * Un span qu'un fils encore vivant est en train d'écrire est omis. */
+static int write_trace(struct trace_buffer *buffer)
+{
+    FILE *out = fopen(buffer->path, "w");
+    if (!out)
+        return -1;
+
+    uint64_t count = __atomic_load_n(&buffer->next, __ATOMIC_ACQUIRE);
+    uint64_t first = count > buffer->capacity ? count - buffer->capacity : 0;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+            "\"args\":{\"name\":\"minishell\"}}", (int)buffer->owner);
+    for (uint64_t i = first; i < count; i++)
+    {
+        struct trace_event copy;
+        if (!read_event(buffer, i, &copy))
+            continue;
+        struct trace_event *event = &copy;
+        double ts = event->start >= buffer->origin ? (event->start - buffer->origin) / 1e3 : 0;
+
+        fprintf(out, ",\n{\"name\":");
+        write_string(out, event->name);
+        fprintf(out, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":%d,\"tid\":%d,\"args\":{\"%s\":%ld}}",
+                kind_names[event->kind], ts, event->duration / 1e3, (int)event->pid,
+                (int)event->tid, arg_names[event->kind], event->arg);
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out);
+}
+
+void trace_finish(void)
+{
+    struct trace_buffer *buffer = trace_buffer;
+    if (!buffer)
+        return;
+
+    trace_buffer = NULL;
+    if (buffer->owner != getpid())
+        return;
+    if (write_trace(buffer) == -1)
+        fprintf(stderr, "minishell: %s: %s\n", buffer->path, strerror(errno));
+    free(buffer->path);
+    munmap(buffer, mapping_size(buffer->capacity));
+}
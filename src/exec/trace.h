@@ -0,0 +1,63 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "../all.h"
+#include <stdint.h>
+
+/* Traces d'exécution au format trace-event de Chrome/Perfetto. Les spans
+ * vont dans un anneau préalloué en mémoire partagée : les fils forkés (étages
+ * d'un pipeline, substitutions) y écrivent aussi et apparaissent sous leur
+ * propre pid. Le shell qui a démarré la trace l'écrit à sa sortie.
+ *
+ * Désactivée, une trace ne coûte qu'un test de pointeur par span. */
+#define TRACE_DEFAULT_EVENTS (64 * 1024)
+#define TRACE_NAME_SIZE 40
+
+enum trace_kind {
+    TRACE_PARSE,
+    TRACE_EXEC,         /* un nœud de exec_ast */
+    TRACE_FORK,
+    TRACE_CHILD,        /* fils, de sa création à son execve */
+    TRACE_WAIT
+};
+
+/* seq vaut le rang de l'événement plus un une fois le span écrit, 0
+ * pendant son écriture : le lecteur ignore les cases dont seq ne
+ * correspond pas au rang attendu (en cours d'écriture ou déjà réécrites). */
+struct trace_event {
+    uint64_t seq;
+    uint64_t start;     /* ns d'horloge monotone */
+    uint64_t duration;
+    pid_t pid;
+    pid_t tid;
+    long arg;
+    unsigned char kind;
+    char name[TRACE_NAME_SIZE];
+};
+
+struct trace_buffer {
+    uint64_t next;      /* nombre de cases prises depuis le début */
+    uint64_t capacity;
+    uint64_t origin;
+    pid_t owner;
+    char *path;
+    struct trace_event events[];
+};
+
+extern struct trace_buffer *trace_buffer;
+
+static inline int trace_enabled(void)
+{
+    return trace_buffer != NULL;
+}
+
+/* Prépare l'anneau ; le fichier est écrit par trace_finish */
+int trace_start(const char *path, size_t capacity);
+
+/* Span de start à maintenant ; name peut être tronqué */
+void trace_span(enum trace_kind kind, const char *name, uint64_t start, long arg);
+
+/* Écrit le fichier si ce processus a démarré la trace, puis la libère */
+void trace_finish(void);
+
+#endif /* TRACE_H */
@@ -0,0 +1,234 @@
+#include "vars.h"
+
+#define VARS_MIN_CAPACITY 64
+
+int is_valid_name(const char *name, size_t len)
+{
+    if (len == 0 || (name[0] >= '0' && name[0] <= '9'))
+        return 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '_'))
+            return 0;
+    }
+    return 1;
+}
+
+static struct var *find_slot(struct var_table *vars, const char *name, size_t len,
+                             unsigned int hash)
+{
+    size_t mask = vars->capacity - 1;
+    size_t i = hash & mask;
+
+    while (vars->slots[i].entry)
+    {
+        struct var *var = &vars->slots[i];
+        if (var->hash == hash && var->name_len == len &&
+            memcmp(var->entry, name, len) == 0)
+            return var;
+        i = (i + 1) & mask;
+    }
+    return &vars->slots[i];
+}
+
+static int grow_table(struct var_table *vars)
+{
+    size_t old_capacity = vars->capacity;
+    struct var *old_slots = vars->slots;
+    size_t capacity = old_capacity ? old_capacity * 2 : VARS_MIN_CAPACITY;
+    struct var *slots = calloc(capacity, sizeof(struct var));
+    if (!slots)
+        return -1;
+
+    vars->slots = slots;
+    vars->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old_slots[i].entry)
+            *find_slot(vars, old_slots[i].entry, old_slots[i].name_len,
+                       old_slots[i].hash) = old_slots[i];
+    }
+    free(old_slots);
+    return 0;
+}
+
+/* L'environnement n'est indexé qu'au premier accès : un « -c » qui ne lance
+ * que des commandes externes le transmet tel quel sans jamais le lire. */
+struct var_table *vars_init(char **env)
+{
+    static char *empty[] = { NULL };
+    struct var_table *vars = calloc(1, sizeof(struct var_table));
+    if (vars)
+        vars->pending = env ? env : empty;
+    return vars;
+}
+
+int vars_load(struct var_table *vars)
+{
+    if (!vars->pending)
+        return 0;
+
+    char **env = vars->pending;
+    if (grow_table(vars) == -1)
+        return -1;
+    vars->pending = NULL;
+    for (size_t i = 0; env[i]; i++)
+        vars_assign(vars, env[i], VAR_EXPORT);
+    vars->envp_dirty = 1;
+    return 0;
+}
+
+void vars_free(struct var_table *vars)
+{
+    if (!vars)
+        return;
+    for (size_t i = 0; i < vars->capacity; i++)
+        free(vars->slots[i].entry);
+    free(vars->slots);
+    free(vars->envp);
+    free(vars);
+}
+
+const char *vars_get(struct var_table *vars, const char *name, size_t name_len)
+{
+    if (vars_load(vars) == -1)
+        return NULL;
+    struct var *var = find_slot(vars, name, name_len, hash_name(name, name_len));
+    return var->entry ? var->entry + name_len + 1 : NULL;
+}
+
+int vars_is_exported(struct var_table *vars, const char *name, size_t name_len)
+{
+    if (vars_load(vars) == -1)
+        return 0;
+    struct var *var = find_slot(vars, name, name_len, hash_name(name, name_len));
+    return var->entry && var->exported;
+}
+
+/* Une valeur qui tient dans l'entrée existante est mise à jour sur place :
+ * réaffecter une variable dans une boucle n'alloue rien. */
+int vars_set(struct var_table *vars, const char *name, size_t name_len,
+             const char *value, size_t value_len, int flags)
+{
+    if (vars_load(vars) == -1)
+        return -1;
+    if (2 * (vars->count + 1) > vars->capacity && grow_table(vars) == -1)
+        return -1;
+
+    unsigned int hash = hash_name(name, name_len);
+    struct var *var = find_slot(vars, name, name_len, hash);
+    size_t needed = name_len + value_len + 2;
+
+    if (!var->entry || var->capacity < needed)
+    {
+        size_t capacity = needed < 32 ? 32 : needed;
+        char *entry = realloc(var->entry, capacity);
+        if (!entry)
+            return -1;
+        if (!var->entry)
+        {
+            vars->count++;
+            var->name_len = name_len;
+            var->hash = hash;
+            var->exported = 0;
+            memcpy(entry, name, name_len);
+            entry[name_len] = '=';
+        }
+        if (var->exported || (flags & VAR_EXPORT))
+            vars->envp_dirty = 1;
+        var->entry = entry;
+        var->capacity = capacity;
+    }
+
+    memcpy(var->entry + name_len + 1, value, value_len);
+    var->entry[needed - 1] = '\0';
+    if ((flags & VAR_EXPORT) && !var->exported)
+    {
+        var->exported = 1;
+        vars->envp_dirty = 1;
+    }
+    return 0;
+}
+
+int vars_assign(struct var_table *vars, const char *assignment, int flags)
+{
+    const char *equal = strchr(assignment, '=');
+    if (!equal)
+        return -1;
+    return vars_set(vars, assignment, equal - assignment, equal + 1, strlen(equal + 1), flags);
+}
+
+int vars_export(struct var_table *vars, const char *name, size_t name_len)
+{
+    if (vars_load(vars) == -1)
+        return -1;
+    struct var *var = find_slot(vars, name, name_len, hash_name(name, name_len));
+
+    if (!var->entry)
+        return vars_set(vars, name, name_len, "", 0, VAR_EXPORT);
+    if (!var->exported)
+    {
+        var->exported = 1;
+        vars->envp_dirty = 1;
+    }
+    return 0;
+}
+
+/* Suppression avec décalage arrière : pas de marqueur de slot supprimé */
+int vars_unset(struct var_table *vars, const char *name, size_t name_len)
+{
+    if (vars_load(vars) == -1)
+        return -1;
+    struct var *var = find_slot(vars, name, name_len, hash_name(name, name_len));
+    if (!var->entry)
+        return 0;
+
+    if (var->exported)
+        vars->envp_dirty = 1;
+    free(var->entry);
+    var->entry = NULL;
+    vars->count--;
+
+    size_t mask = vars->capacity - 1;
+    size_t hole = var - vars->slots;
+    for (size_t i = (hole + 1) & mask; vars->slots[i].entry; i = (i + 1) & mask)
+    {
+        size_t home = vars->slots[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            vars->slots[hole] = vars->slots[i];
+            vars->slots[i].entry = NULL;
+            hole = i;
+        }
+    }
+    return 0;
+}
+
+char **vars_envp(struct var_table *vars)
+{
+    if (vars->pending)
+        return vars->pending;
+    if (!vars->envp_dirty && vars->envp)
+        return vars->envp;
+
+    if (vars->envp_capacity < vars->count + 1)
+    {
+        char **envp = realloc(vars->envp, sizeof(char *) * (vars->count + 1));
+        if (!envp)
+            return vars->envp;
+        vars->envp = envp;
+        vars->envp_capacity = vars->count + 1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < vars->capacity; i++)
+    {
+        if (vars->slots[i].entry && vars->slots[i].exported)
+            vars->envp[n++] = vars->slots[i].entry;
+    }
+    vars->envp[n] = NULL;
+    vars->envp_dirty = 0;
+    return vars->envp;
+}
@@ -0,0 +1,55 @@
+#ifndef VARS_H
+#define VARS_H
+
+#include "../all.h"
+#include "../string_utils.h"
+
+/* Une variable est stockée sous la forme "NOM=valeur" : l'entrée sert telle
+ * quelle dans l'environnement passé à execve. */
+struct var {
+    char *entry;
+    size_t name_len;
+    size_t capacity;
+    unsigned int hash;
+    int exported;
+};
+
+/* Table des variables du shell, à adressage ouvert */
+struct var_table {
+    struct var *slots;
+    size_t capacity;
+    size_t count;
+    char **envp;            /* variables exportées, reconstruit si envp_dirty */
+    size_t envp_capacity;
+    int envp_dirty;
+    char **pending;         /* environnement pas encore indexé */
+};
+
+#define VAR_EXPORT 0x1 /* exporter la variable (sinon garder son état) */
+
+struct var_table *vars_init(char **env);
+void vars_free(struct var_table *vars);
+/* Indexe l'environnement s'il ne l'est pas encore. Les autres fonctions le
+ * font d'elles-mêmes ; à appeler avant de partager la table entre threads. */
+int vars_load(struct var_table *vars);
+const char *vars_get(struct var_table *vars, const char *name, size_t name_len);
+int vars_set(struct var_table *vars, const char *name, size_t name_len,
+             const char *value, size_t value_len, int flags);
+int vars_assign(struct var_table *vars, const char *assignment, int flags);
+int vars_unset(struct var_table *vars, const char *name, size_t name_len);
+int vars_is_exported(struct var_table *vars, const char *name, size_t name_len);
+
+/* Découpage par IFS (expansion et read) : les blancs de IFS se regroupent,
+ * chacun de ses autres caractères termine exactement un champ */
+#define IFS_DEFAULT " \t\n"
+
+static inline int ifs_is_space(const char *ifs, char c)
+{
+    return (c == ' ' || c == '\t' || c == '\n') && strchr(ifs, c);
+}
+int vars_export(struct var_table *vars, const char *name, size_t name_len);
+char **vars_envp(struct var_table *vars);
+
+int is_valid_name(const char *name, size_t len);
+
+#endif /* VARS_H */
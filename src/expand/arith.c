@@ -0,0 +1,538 @@
+#include "arith.h"
+#include "../exec/vars.h"
+#include <inttypes.h>
+
+enum arith_op {
+    ARITH_NUM,
+    ARITH_VAR,
+    ARITH_NEG,
+    ARITH_NOT,
+    ARITH_BITNOT,
+    ARITH_PREINC,
+    ARITH_PREDEC,
+    ARITH_POSTINC,
+    ARITH_POSTDEC,
+    ARITH_MUL,
+    ARITH_DIV,
+    ARITH_MOD,
+    ARITH_ADD,
+    ARITH_SUB,
+    ARITH_SHL,
+    ARITH_SHR,
+    ARITH_LT,
+    ARITH_LE,
+    ARITH_GT,
+    ARITH_GE,
+    ARITH_EQ,
+    ARITH_NE,
+    ARITH_BITAND,
+    ARITH_BITXOR,
+    ARITH_BITOR,
+    ARITH_AND,
+    ARITH_OR,
+    ARITH_TERNARY,
+    ARITH_ASSIGN,
+    ARITH_COMMA
+};
+
+/* Priorités des opérateurs binaires, de la plus faible à la plus forte */
+enum {
+    PREC_COMMA = 1,
+    PREC_ASSIGN,
+    PREC_TERNARY,
+    PREC_OR,
+    PREC_AND,
+    PREC_BITOR,
+    PREC_BITXOR,
+    PREC_BITAND,
+    PREC_EQUALITY,
+    PREC_RELATIONAL,
+    PREC_SHIFT,
+    PREC_ADDITIVE,
+    PREC_MULTIPLICATIVE
+};
+
+/* Les opérateurs les plus longs d'abord : le premier qui correspond gagne */
+static const struct {
+    const char *text;
+    int op;
+    int prec;
+    int assign;         /* a op= b */
+} binary_operators[] = {
+    { "<<=", ARITH_SHL, PREC_ASSIGN, 1 },
+    { ">>=", ARITH_SHR, PREC_ASSIGN, 1 },
+    { "||", ARITH_OR, PREC_OR, 0 },
+    { "&&", ARITH_AND, PREC_AND, 0 },
+    { "==", ARITH_EQ, PREC_EQUALITY, 0 },
+    { "!=", ARITH_NE, PREC_EQUALITY, 0 },
+    { "<=", ARITH_LE, PREC_RELATIONAL, 0 },
+    { ">=", ARITH_GE, PREC_RELATIONAL, 0 },
+    { "<<", ARITH_SHL, PREC_SHIFT, 0 },
+    { ">>", ARITH_SHR, PREC_SHIFT, 0 },
+    { "*=", ARITH_MUL, PREC_ASSIGN, 1 },
+    { "/=", ARITH_DIV, PREC_ASSIGN, 1 },
+    { "%=", ARITH_MOD, PREC_ASSIGN, 1 },
+    { "+=", ARITH_ADD, PREC_ASSIGN, 1 },
+    { "-=", ARITH_SUB, PREC_ASSIGN, 1 },
+    { "&=", ARITH_BITAND, PREC_ASSIGN, 1 },
+    { "^=", ARITH_BITXOR, PREC_ASSIGN, 1 },
+    { "|=", ARITH_BITOR, PREC_ASSIGN, 1 },
+    { "|", ARITH_BITOR, PREC_BITOR, 0 },
+    { "^", ARITH_BITXOR, PREC_BITXOR, 0 },
+    { "&", ARITH_BITAND, PREC_BITAND, 0 },
+    { "<", ARITH_LT, PREC_RELATIONAL, 0 },
+    { ">", ARITH_GT, PREC_RELATIONAL, 0 },
+    { "+", ARITH_ADD, PREC_ADDITIVE, 0 },
+    { "-", ARITH_SUB, PREC_ADDITIVE, 0 },
+    { "*", ARITH_MUL, PREC_MULTIPLICATIVE, 0 },
+    { "/", ARITH_DIV, PREC_MULTIPLICATIVE, 0 },
+    { "%", ARITH_MOD, PREC_MULTIPLICATIVE, 0 },
+    { "=", ARITH_ASSIGN, PREC_ASSIGN, 1 },
+    { "?", ARITH_TERNARY, PREC_TERNARY, 0 },
+    { ",", ARITH_COMMA, PREC_COMMA, 0 },
+};
+
+struct arith_parser {
+    const char *src;
+    size_t len;
+    size_t pos;
+    struct arith_expr *expr;
+    const char *error;
+};
+
+static int is_name_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static int is_name_char(char c)
+{
+    return is_name_start(c) || (c >= '0' && c <= '9');
+}
+
+static int digit_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return 99;
+}
+
+/* Constante décimale, octale (0...) ou hexadécimale (0x...). Renvoie le
+ * nombre de caractères lus, 0 si le texte n'est pas une constante valide. */
+static size_t parse_number(const char *s, size_t len, int64_t *value)
+{
+    uint64_t result = 0;
+    int base = 10;
+    size_t i = 0;
+
+    if (len >= 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+    {
+        base = 16;
+        i = 2;
+    }
+    else if (len >= 1 && s[0] == '0')
+        base = 8;
+
+    size_t digits = i;
+    while (i < len && is_name_char(s[i]))
+    {
+        int digit = digit_value(s[i]);
+        if (digit >= base)
+            return 0;
+        result = result * base + digit;
+        i++;
+    }
+    if (i == digits)
+        return 0;
+    *value = (int64_t)result;
+    return i;
+}
+
+static void skip_spaces(struct arith_parser *p)
+{
+    while (p->pos < p->len && (p->src[p->pos] == ' ' || p->src[p->pos] == '\t' ||
+                               p->src[p->pos] == '\n'))
+        p->pos++;
+}
+
+static int match(struct arith_parser *p, const char *text)
+{
+    size_t n = strlen(text);
+
+    skip_spaces(p);
+    if (p->pos + n > p->len || memcmp(p->src + p->pos, text, n) != 0)
+        return 0;
+    p->pos += n;
+    return 1;
+}
+
+static int add_node(struct arith_parser *p, int op, int left, int right, int extra)
+{
+    struct arith_node *node = &p->expr->nodes[p->expr->count];
+
+    node->op = op;
+    node->left = left;
+    node->right = right;
+    node->extra = extra;
+    node->value = 0;
+    node->name = 0;
+    node->name_len = 0;
+    return p->expr->count++;
+}
+
+static int parse_expr(struct arith_parser *p, int min_prec);
+
+static int parse_primary(struct arith_parser *p)
+{
+    skip_spaces(p);
+    if (p->pos >= p->len)
+    {
+        p->error = "syntax error: operand expected";
+        return -1;
+    }
+
+    char c = p->src[p->pos];
+    if (c >= '0' && c <= '9')
+    {
+        int node = add_node(p, ARITH_NUM, -1, -1, 0);
+        size_t n = parse_number(p->src + p->pos, p->len - p->pos, &p->expr->nodes[node].value);
+        if (n == 0)
+        {
+            p->error = "value too great for base";
+            return -1;
+        }
+        p->pos += n;
+        return node;
+    }
+
+    if (is_name_start(c))
+    {
+        int node = add_node(p, ARITH_VAR, -1, -1, 0);
+        p->expr->nodes[node].name = p->pos;
+        while (p->pos < p->len && is_name_char(p->src[p->pos]))
+            p->pos++;
+        p->expr->nodes[node].name_len = p->pos - p->expr->nodes[node].name;
+
+        if (match(p, "++"))
+            return add_node(p, ARITH_POSTINC, node, -1, 0);
+        if (match(p, "--"))
+            return add_node(p, ARITH_POSTDEC, node, -1, 0);
+        return node;
+    }
+
+    if (c == '(')
+    {
+        p->pos++;
+        int node = parse_expr(p, PREC_COMMA);
+        if (node == -1)
+            return -1;
+        if (!match(p, ")"))
+        {
+            p->error = "missing `)'";
+            return -1;
+        }
+        return node;
+    }
+
+    p->error = "syntax error: operand expected";
+    return -1;
+}
+
+static int parse_unary(struct arith_parser *p)
+{
+    int op = -1;
+
+    if (match(p, "++"))
+        op = ARITH_PREINC;
+    else if (match(p, "--"))
+        op = ARITH_PREDEC;
+    if (op != -1)
+    {
+        int operand = parse_primary(p);
+        if (operand == -1)
+            return -1;
+        if (p->expr->nodes[operand].op != ARITH_VAR)
+        {
+            p->error = "syntax error: variable expected";
+            return -1;
+        }
+        return add_node(p, op, operand, -1, 0);
+    }
+
+    if (match(p, "+"))
+        return parse_unary(p);
+    if (match(p, "-"))
+        op = ARITH_NEG;
+    else if (match(p, "!"))
+        op = ARITH_NOT;
+    else if (match(p, "~"))
+        op = ARITH_BITNOT;
+    else
+        return parse_primary(p);
+
+    int operand = parse_unary(p);
+    return operand == -1 ? -1 : add_node(p, op, operand, -1, 0);
+}
+
+/* Analyse par remontée de priorités : les opérateurs de priorité au moins
+ * min_prec sont consommés ici, les autres laissés à l'appelant. */
+static int parse_expr(struct arith_parser *p, int min_prec)
+{
+    int left = parse_unary(p);
+
+    while (left != -1)
+    {
+        size_t i = 0;
+        size_t n_ops = sizeof(binary_operators) / sizeof(binary_operators[0]);
+
+        skip_spaces(p);
+        while (i < n_ops && (p->pos + strlen(binary_operators[i].text) > p->len ||
+                             memcmp(p->src + p->pos, binary_operators[i].text,
+                                    strlen(binary_operators[i].text)) != 0))
+            i++;
+        if (i == n_ops || binary_operators[i].prec < min_prec)
+            break;
+
+        int op = binary_operators[i].op;
+        int prec = binary_operators[i].prec;
+        p->pos += strlen(binary_operators[i].text);
+
+        if (op == ARITH_TERNARY)
+        {
+            int then = parse_expr(p, PREC_COMMA);
+            if (then == -1)
+                return -1;
+            if (!match(p, ":"))
+            {
+                p->error = "`:' expected for conditional expression";
+                return -1;
+            }
+            int otherwise = parse_expr(p, PREC_TERNARY);
+            if (otherwise == -1)
+                return -1;
+            left = add_node(p, ARITH_TERNARY, left, then, otherwise);
+        }
+        else if (binary_operators[i].assign)
+        {
+            if (p->expr->nodes[left].op != ARITH_VAR)
+            {
+                p->error = "attempted assignment to non-variable";
+                return -1;
+            }
+            int right = parse_expr(p, PREC_ASSIGN);
+            if (right == -1)
+                return -1;
+            left = add_node(p, ARITH_ASSIGN, left, right, op == ARITH_ASSIGN ? -1 : op);
+        }
+        else
+        {
+            int right = parse_expr(p, prec + 1);
+            if (right == -1)
+                return -1;
+            left = add_node(p, op, left, right, 0);
+        }
+    }
+    return left;
+}
+
+/* Chaque nœud consomme au moins un caractère : len + 1 nœuds suffisent, et
+ * l'expression tient dans une seule allocation. */
+struct arith_expr *arith_compile(const char *text, size_t len, const char **error)
+{
+    size_t nodes_size = sizeof(struct arith_node) * (len + 1);
+    struct arith_expr *expr = malloc(sizeof(struct arith_expr) + nodes_size + len + 1);
+    if (!expr)
+    {
+        *error = "out of memory";
+        return NULL;
+    }
+
+    char *source = (char *)expr->nodes + nodes_size;
+    memcpy(source, text, len);
+    source[len] = '\0';
+    expr->source = source;
+    expr->count = 0;
+    expr->root = -1;
+
+    struct arith_parser p = { source, len, 0, expr, NULL };
+    skip_spaces(&p);
+    if (p.pos == len)
+        return expr;
+
+    expr->root = parse_expr(&p, PREC_COMMA);
+    skip_spaces(&p);
+    if (expr->root != -1 && p.pos < len)
+        p.error = "syntax error in expression";
+    if (p.error)
+    {
+        *error = p.error;
+        free(expr);
+        return NULL;
+    }
+    return expr;
+}
+
+struct arith_eval {
+    const struct arith_expr *expr;
+    struct var_table *vars;
+    const char *error;
+};
+
+static int64_t eval_node(struct arith_eval *ev, int index);
+
+static int64_t get_variable(struct arith_eval *ev, const struct arith_node *node)
+{
+    const char *value = vars_get(ev->vars, ev->expr->source + node->name, node->name_len);
+    int64_t result = 0;
+
+    if (!value)
+        return 0;
+    while (*value == ' ' || *value == '\t' || *value == '\n')
+        value++;
+
+    int negative = *value == '-';
+    if (*value == '-' || *value == '+')
+        value++;
+    size_t len = strlen(value);
+    while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t' || value[len - 1] == '\n'))
+        len--;
+    if (len == 0)
+        return 0;
+    if (parse_number(value, len, &result) != len)
+    {
+        ev->error = "invalid number";
+        return 0;
+    }
+    return negative ? (int64_t)(0 - (uint64_t)result) : result;
+}
+
+static int64_t set_variable(struct arith_eval *ev, const struct arith_node *node, int64_t value)
+{
+    char buffer[32];
+    int n = snprintf(buffer, sizeof(buffer), "%" PRId64, value);
+
+    if (vars_set(ev->vars, ev->expr->source + node->name, node->name_len, buffer, n, 0) == -1)
+        ev->error = "out of memory";
+    return value;
+}
+
+/* Opérations sur des entiers 64 bits : + - * et les décalages passent par
+ * uint64_t pour que le dépassement reboucle au lieu d'être indéfini. */
+static int64_t apply_binary(struct arith_eval *ev, int op, int64_t a, int64_t b)
+{
+    switch (op)
+    {
+        case ARITH_MUL:
+            return (int64_t)((uint64_t)a * (uint64_t)b);
+        case ARITH_DIV:
+        case ARITH_MOD:
+            if (b == 0)
+            {
+                ev->error = "division by zero";
+                return 0;
+            }
+            if (b == -1)
+                return op == ARITH_DIV ? (int64_t)(0 - (uint64_t)a) : 0;
+            return op == ARITH_DIV ? a / b : a % b;
+        case ARITH_ADD:
+            return (int64_t)((uint64_t)a + (uint64_t)b);
+        case ARITH_SUB:
+            return (int64_t)((uint64_t)a - (uint64_t)b);
+        case ARITH_SHL:
+            return (int64_t)((uint64_t)a << (b & 63));
+        case ARITH_SHR:
+            return a >> (b & 63);
+        case ARITH_LT:
+            return a < b;
+        case ARITH_LE:
+            return a <= b;
+        case ARITH_GT:
+            return a > b;
+        case ARITH_GE:
+            return a >= b;
+        case ARITH_EQ:
+            return a == b;
+        case ARITH_NE:
+            return a != b;
+        case ARITH_BITAND:
+            return a & b;
+        case ARITH_BITXOR:
+            return a ^ b;
+        case ARITH_BITOR:
+            return a | b;
+        default:
+            return b;
+    }
+}
+
+static int64_t eval_node(struct arith_eval *ev, int index)
+{
+    const struct arith_node *node = &ev->expr->nodes[index];
+    const struct arith_node *var = node->left >= 0 ? &ev->expr->nodes[node->left] : NULL;
+    int64_t a;
+    int64_t b;
+
+    switch (node->op)
+    {
+        case ARITH_NUM:
+            return node->value;
+        case ARITH_VAR:
+            return get_variable(ev, node);
+        case ARITH_NEG:
+            return (int64_t)(0 - (uint64_t)eval_node(ev, node->left));
+        case ARITH_NOT:
+            return !eval_node(ev, node->left);
+        case ARITH_BITNOT:
+            return ~eval_node(ev, node->left);
+        case ARITH_PREINC:
+        case ARITH_PREDEC:
+        case ARITH_POSTINC:
+        case ARITH_POSTDEC:
+            a = get_variable(ev, var);
+            b = (node->op == ARITH_PREINC || node->op == ARITH_POSTINC)
+                ? apply_binary(ev, ARITH_ADD, a, 1) : apply_binary(ev, ARITH_SUB, a, 1);
+            if (ev->error)
+                return 0;
+            set_variable(ev, var, b);
+            return (node->op == ARITH_PREINC || node->op == ARITH_PREDEC) ? b : a;
+        case ARITH_AND:
+            return eval_node(ev, node->left) && !ev->error && eval_node(ev, node->right);
+        case ARITH_OR:
+            return (eval_node(ev, node->left) && !ev->error) || eval_node(ev, node->right);
+        case ARITH_TERNARY:
+            a = eval_node(ev, node->left);
+            if (ev->error)
+                return 0;
+            return eval_node(ev, a ? node->right : node->extra);
+        case ARITH_ASSIGN:
+            b = eval_node(ev, node->right);
+            if (!ev->error && node->extra != -1)
+                b = apply_binary(ev, node->extra, get_variable(ev, var), b);
+            return ev->error ? 0 : set_variable(ev, var, b);
+        case ARITH_COMMA:
+            eval_node(ev, node->left);
+            return eval_node(ev, node->right);
+        default:
+            a = eval_node(ev, node->left);
+            b = eval_node(ev, node->right);
+            return ev->error ? 0 : apply_binary(ev, node->op, a, b);
+    }
+}
+
+int arith_eval(const struct arith_expr *expr, struct var_table *vars, int64_t *result,
+               const char **error)
+{
+    struct arith_eval ev = { expr, vars, NULL };
+
+    *result = expr->root == -1 ? 0 : eval_node(&ev, expr->root);
+    if (ev.error)
+    {
+        *error = ev.error;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef ARITH_H
+#define ARITH_H
+
+#include "../all.h"
+#include <stdint.h>
+
+struct var_table;
+
+/* Nœud d'une expression compilée. Les fils sont des indices dans le tableau
+ * de nœuds de l'expression, -1 s'ils sont absents. */
+struct arith_node {
+    int op;
+    int left;
+    int right;
+    int extra;          /* branche « sinon » de ?:, opérateur d'un a op= b */
+    int64_t value;      /* constante */
+    size_t name;        /* variable : position et longueur dans source */
+    size_t name_len;
+};
+
+/* Expression compilée, allouée en un seul bloc : nœuds puis texte source.
+ * Un simple free() la libère. */
+struct arith_expr {
+    int root;           /* -1 pour une expression vide */
+    int count;
+    const char *source;
+    struct arith_node nodes[];
+};
+
+/* Compile le texte d'une expansion $((...)). Renvoie NULL en cas d'erreur,
+ * avec le message dans *error. */
+struct arith_expr *arith_compile(const char *text, size_t len, const char **error);
+
+/* Évalue une expression compilée sur des entiers 64 bits. Les variables sont
+ * lues et affectées dans vars. Renvoie -1 en cas d'erreur (division par
+ * zéro, variable non numérique), avec le message dans *error. */
+int arith_eval(const struct arith_expr *expr, struct var_table *vars, int64_t *result,
+               const char **error);
+
+#endif /* ARITH_H */
@@ -0,0 +1,254 @@
+#include "case.h"
+#include "../lexer/lexer.h"
+#include "../string_utils.h"
+
+struct case_matcher *case_matcher_new(void)
+{
+    return calloc(1, sizeof(struct case_matcher));
+}
+
+void case_matcher_free(struct case_matcher *matcher)
+{
+    if (!matcher)
+        return;
+    for (int i = 0; i < matcher->count; i++)
+    {
+        free(matcher->patterns[i].text);
+        free(matcher->patterns[i].glob);
+    }
+    free(matcher->patterns);
+    free(matcher->literals);
+    free(matcher->others);
+    free(matcher);
+}
+
+static void put_escaped(struct strbuf *out, char c)
+{
+    if (c == '*' || c == '?' || c == '[' || c == '\\')
+        strbuf_putc(out, '\\');
+    strbuf_putc(out, c);
+}
+
+/* Retire les quotes d'un motif sans '$' : les caractères quotés deviennent
+ * des caractères échappés, littéraux pour le compilateur de motifs. */
+static void escape_quotes(const char *word, struct strbuf *out)
+{
+    size_t len = strlen(word);
+    size_t i = 0;
+
+    while (i < len)
+    {
+        char c = word[i];
+
+        if (c == '\'')
+        {
+            for (i++; i < len && word[i] != '\''; i++)
+                put_escaped(out, word[i]);
+            i++;
+        }
+        else if (c == '"')
+        {
+            for (i++; i < len && word[i] != '"'; i++)
+            {
+                if (word[i] == '\\' && i + 1 < len && strchr("$`\"\\\n", word[i + 1]))
+                {
+                    if (word[++i] != '\n')
+                        put_escaped(out, word[i]);
+                }
+                else
+                    put_escaped(out, word[i]);
+            }
+            i++;
+        }
+        else if (c == '\\' && i + 1 < len)
+        {
+            if (word[i + 1] != '\n')
+                put_escaped(out, word[i + 1]);
+            i += 2;
+        }
+        else
+        {
+            strbuf_putc(out, c);
+            i++;
+        }
+    }
+}
+
+static struct case_pattern *new_pattern(struct case_matcher *matcher)
+{
+    if (matcher->count == matcher->capacity)
+    {
+        int capacity = matcher->capacity ? 2 * matcher->capacity : 8;
+        struct case_pattern *patterns = realloc(matcher->patterns,
+                                                sizeof(struct case_pattern) * capacity);
+        if (!patterns)
+            return NULL;
+        matcher->patterns = patterns;
+        matcher->capacity = capacity;
+    }
+    struct case_pattern *pattern = &matcher->patterns[matcher->count++];
+    memset(pattern, 0, sizeof(*pattern));
+    return pattern;
+}
+
+int case_matcher_add(struct case_matcher *matcher, const char *word, int flags, int arm,
+                     int index)
+{
+    struct case_pattern *pattern = new_pattern(matcher);
+    if (!pattern)
+        return -1;
+    pattern->arm = arm;
+
+    if (flags & WORD_DOLLAR)
+    {
+        pattern->type = CASE_DYNAMIC;
+        pattern->word = index;
+        return 0;
+    }
+
+    struct strbuf escaped = { NULL, 0, 0 };
+    escape_quotes(word, &escaped);
+    pattern->glob = glob_compile_word(escaped.data ? escaped.data : "", escaped.len);
+    strbuf_free(&escaped);
+    if (!pattern->glob)
+        return -1;
+
+    const struct glob_matcher *seg = &pattern->glob->segments[0];
+    if (seg->count > 1 || (seg->count == 1 && !seg->literal))
+    {
+        pattern->type = CASE_GLOB;
+        return 0;
+    }
+
+    /* Littéral : seul le texte est gardé, pour la table de hachage */
+    pattern->type = CASE_LITERAL;
+    pattern->len = seg->count ? pattern->glob->ops[seg->ops].len : 0;
+    pattern->text = my_strndup(pattern->glob->text, pattern->len);
+    pattern->hash = hash_name(pattern->text ? pattern->text : "", pattern->len);
+    free(pattern->glob);
+    pattern->glob = NULL;
+    return pattern->text ? 0 : -1;
+}
+
+int case_matcher_finish(struct case_matcher *matcher)
+{
+    size_t capacity = 8;
+    int literals = 0;
+
+    for (int i = 0; i < matcher->count; i++)
+        literals += matcher->patterns[i].type == CASE_LITERAL;
+    while (capacity < 2 * (size_t)literals)
+        capacity *= 2;
+
+    matcher->literals = malloc(sizeof(int) * capacity);
+    matcher->others = malloc(sizeof(int) * (matcher->count + 1));
+    if (!matcher->literals || !matcher->others)
+        return -1;
+    matcher->literals_capacity = capacity;
+    for (size_t i = 0; i < capacity; i++)
+        matcher->literals[i] = -1;
+
+    for (int i = 0; i < matcher->count; i++)
+    {
+        struct case_pattern *pattern = &matcher->patterns[i];
+
+        if (pattern->type != CASE_LITERAL)
+        {
+            matcher->others[matcher->others_count++] = i;
+            continue;
+        }
+
+        /* Un littéral répété garde sa première branche */
+        size_t slot = pattern->hash & (capacity - 1);
+        while (matcher->literals[slot] != -1)
+        {
+            struct case_pattern *other = &matcher->patterns[matcher->literals[slot]];
+            if (other->hash == pattern->hash && other->len == pattern->len &&
+                memcmp(other->text, pattern->text, pattern->len) == 0)
+                break;
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (matcher->literals[slot] == -1)
+            matcher->literals[slot] = i;
+    }
+    return 0;
+}
+
+static int find_literal(const struct case_matcher *matcher, const char *word, size_t len)
+{
+    unsigned int hash = hash_name(word, len);
+    size_t mask = matcher->literals_capacity - 1;
+
+    for (size_t slot = hash & mask; matcher->literals[slot] != -1; slot = (slot + 1) & mask)
+    {
+        const struct case_pattern *pattern = &matcher->patterns[matcher->literals[slot]];
+        if (pattern->hash == hash && pattern->len == len &&
+            memcmp(pattern->text, word, len) == 0)
+            return pattern->arm;
+    }
+    return -1;
+}
+
+/* Motif dynamique sans caractère spécial : comparaison directe, sans le
+ * compiler. Renvoie -1 s'il faut passer par un motif compilé. */
+static int match_escaped_literal(const char *pattern, const char *word, size_t len)
+{
+    size_t j = 0;
+
+    for (size_t i = 0; pattern[i]; i++)
+    {
+        char c = pattern[i];
+        if (c == '*' || c == '?' || c == '[')
+            return -1;
+        if (c == '\\' && pattern[i + 1])
+            c = pattern[++i];
+        if (j >= len || word[j++] != c)
+        {
+            /* Un caractère spécial plus loin change le verdict */
+            for (i++; pattern[i]; i++)
+            {
+                if (pattern[i] == '\\' && pattern[i + 1])
+                    i++;
+                else if (pattern[i] == '*' || pattern[i] == '?' || pattern[i] == '[')
+                    return -1;
+            }
+            return 0;
+        }
+    }
+    return j == len;
+}
+
+static int match_dynamic(const char *pattern, const char *word, size_t len)
+{
+    int ret = match_escaped_literal(pattern, word, len);
+    if (ret != -1)
+        return ret;
+
+    struct glob_pattern *glob = glob_compile_word(pattern, strlen(pattern));
+    if (!glob)
+        return 0;
+    ret = glob_match(glob, &glob->segments[0], word, len);
+    free(glob);
+    return ret;
+}
+
+int case_matcher_match(const struct case_matcher *matcher, const char *word, char **words)
+{
+    size_t len = strlen(word);
+    int best = matcher->literals ? find_literal(matcher, word, len) : -1;
+
+    /* Seuls les motifs non littéraux des branches précédentes restent à
+     * essayer, dans l'ordre */
+    for (int i = 0; i < matcher->others_count; i++)
+    {
+        const struct case_pattern *pattern = &matcher->patterns[matcher->others[i]];
+
+        if (best != -1 && pattern->arm >= best)
+            break;
+        if (pattern->type == CASE_GLOB
+            ? glob_match(pattern->glob, &pattern->glob->segments[0], word, len)
+            : match_dynamic(words[pattern->word], word, len))
+            return pattern->arm;
+    }
+    return best;
+}
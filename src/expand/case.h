@@ -0,0 +1,54 @@
+#ifndef CASE_H
+#define CASE_H
+
+#include "../all.h"
+#include "glob.h"
+
+/* Motifs d'un case, compilés une fois à l'analyse. Les motifs littéraux
+ * vont dans une table de hachage ; les autres sont des motifs glob, dont
+ * glob_match compare directement préfixes et suffixes. Un motif contenant
+ * un '$' n'est connu qu'à l'exécution : il est pris dans les mots expansés
+ * de la commande. */
+enum case_pattern_type {
+    CASE_LITERAL,
+    CASE_GLOB,
+    CASE_DYNAMIC
+};
+
+struct case_pattern {
+    enum case_pattern_type type;
+    int arm;                    /* branche dont le motif fait partie */
+    char *text;                 /* littéral, sans quotes */
+    size_t len;
+    unsigned int hash;
+    struct glob_pattern *glob;
+    int word;                   /* motif dynamique : indice du mot expansé */
+};
+
+struct case_matcher {
+    struct case_pattern *patterns;
+    int count;
+    int capacity;
+    int *literals;              /* indices des littéraux, -1 si libre */
+    size_t literals_capacity;
+    int *others;                /* motifs non littéraux, dans l'ordre */
+    int others_count;
+};
+
+struct case_matcher *case_matcher_new(void);
+void case_matcher_free(struct case_matcher *matcher);
+
+/* Ajoute le motif brut word (quotes comprises) de la branche arm. Un motif
+ * avec WORD_DOLLAR dans flags est le mot expansé d'indice word à
+ * l'exécution. */
+int case_matcher_add(struct case_matcher *matcher, const char *pattern, int flags, int arm,
+                     int word);
+
+/* Construit la table des littéraux, une fois tous les motifs ajoutés */
+int case_matcher_finish(struct case_matcher *matcher);
+
+/* Première branche dont un motif correspond à word, -1 sinon. words
+ * contient les motifs dynamiques expansés, caractères quotés échappés. */
+int case_matcher_match(const struct case_matcher *matcher, const char *word, char **words);
+
+#endif /* CASE_H */
@@ -0,0 +1,1092 @@
+#include "expand.h"
+#include "../exec/builtins.h"
+#include "../exec/vars.h"
+#include "../exec/trace.h"
+#include "arith.h"
+#include "glob.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+#define LITERAL_WORD ((size_t)-1)
+
+struct expander {
+    struct exec_state *state;
+    struct command_scratch *scratch;
+    struct strbuf *text;
+    size_t field_start;
+    int field_started;  /* des quotes vides produisent quand même un champ */
+    int count;          /* arguments produits */
+    int error;
+    int globbing;       /* le mot peut donner lieu à un développement de chemins */
+    int field_glob;     /* '*', '?' ou '[' hors quotes dans le champ courant */
+    int field_escaped;  /* caractères spéciaux quotés, échappés par un '\\' */
+    const char *glob_key; /* mot d'origine, si le motif ne dépend que de lui */
+    int fields;         /* arguments d'une commande : "$@" donne un champ par paramètre */
+    int single;         /* mot d'un case : expansion non quotée mais pas découpée */
+    int split_space;    /* le dernier champ a été terminé par un blanc de IFS */
+};
+
+static int reserve_args(struct expander *exp, int needed)
+{
+    struct command_scratch *scratch = exp->scratch;
+
+    if (needed <= scratch->args_capacity)
+        return 0;
+
+    int capacity = scratch->args_capacity ? scratch->args_capacity : 8;
+    while (capacity < needed)
+        capacity *= 2;
+
+    char **args = realloc(scratch->args, sizeof(char *) * capacity);
+    if (!args)
+        return -1;
+    scratch->args = args;
+    size_t *offsets = realloc(scratch->offsets, sizeof(size_t) * capacity);
+    if (!offsets)
+        return -1;
+    scratch->offsets = offsets;
+    scratch->args_capacity = capacity;
+    return 0;
+}
+
+static void begin_field(struct expander *exp)
+{
+    exp->field_start = exp->text->len;
+    exp->field_started = 0;
+    exp->field_glob = 0;
+    exp->field_escaped = 0;
+    exp->split_space = 0;
+}
+
+/* Texte quoté : dans un mot qui sera développé comme motif, ses caractères
+ * spéciaux sont échappés pour rester littéraux. */
+static void put_quoted(struct expander *exp, const char *data, size_t len)
+{
+    if (!exp->globbing)
+    {
+        strbuf_append(exp->text, data, len);
+        return;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        if (strchr("*?[\\", data[i]) && data[i] != '\0')
+        {
+            strbuf_putc(exp->text, '\\');
+            exp->field_escaped = 1;
+        }
+        strbuf_putc(exp->text, data[i]);
+    }
+}
+
+static void put_unquoted(struct expander *exp, char c)
+{
+    if (exp->globbing && c == '\\')
+        put_quoted(exp, &c, 1);
+    else
+    {
+        if (exp->globbing && (c == '*' || c == '?' || c == '['))
+            exp->field_glob = 1;
+        strbuf_putc(exp->text, c);
+    }
+}
+
+/* Termine le champ courant dans text ; renvoie son début. */
+static size_t end_field(struct expander *exp)
+{
+    size_t start = exp->field_start;
+
+    strbuf_putc(exp->text, '\0');
+    begin_field(exp);
+    return start;
+}
+
+static struct compiled_cache *cache_entry(struct expander *exp, const char *source);
+
+/* Remplace le champ courant par les chemins qui lui correspondent ; renvoie 0
+ * s'il n'y en a aucun, le champ restant alors tel quel. */
+static int glob_field(struct expander *exp)
+{
+    struct strbuf *text = exp->text;
+    size_t start = exp->field_start;
+    size_t len = text->len - start;
+    struct compiled_cache *entry = exp->glob_key ? cache_entry(exp, exp->glob_key) : NULL;
+    struct glob_pattern *pattern = entry ? entry->compiled : NULL;
+
+    if (!pattern)
+    {
+        pattern = glob_compile(text->data + start, len);
+        if (entry)
+            entry->compiled = pattern;
+    }
+    if (!exp->state->globs)
+        exp->state->globs = calloc(1, sizeof(struct glob_cache));
+    if (!pattern || !exp->state->globs)
+        return 0;
+
+    size_t count = glob_expand(pattern, exp->state->globs, exp->state->cwd_fd, text);
+    if (!entry)
+        free(pattern);
+    if (count == 0)
+        return 0;
+
+    /* Les résultats, ajoutés après le motif, prennent sa place */
+    memmove(text->data + start, text->data + start + len, text->len - start - len + 1);
+    text->len -= len;
+    if (reserve_args(exp, exp->count + count + 1) == -1)
+    {
+        exp->error = 1;
+        return 1;
+    }
+    for (size_t i = 0, pos = start; i < count; i++)
+    {
+        exp->scratch->offsets[exp->count++] = pos;
+        pos += strlen(text->data + pos) + 1;
+    }
+    begin_field(exp);
+    return 1;
+}
+
+static void add_arg(struct expander *exp)
+{
+    if (exp->field_glob && glob_field(exp))
+        return;
+    if (exp->field_escaped)
+    {
+        size_t start = exp->field_start;
+        exp->text->len = start + glob_unescape(exp->text->data + start, exp->text->len - start);
+    }
+    if (reserve_args(exp, exp->count + 2) == -1)
+    {
+        exp->error = 1;
+        return;
+    }
+    exp->scratch->offsets[exp->count++] = end_field(exp);
+}
+
+static int field_pending(struct expander *exp)
+{
+    return exp->text->len > exp->field_start || exp->field_started;
+}
+
+/* Découpage en champs d'un résultat d'expansion non quoté : un
+ * séparateur non blanc termine un champ, même vide, sauf s'il suit les
+ * blancs qui viennent d'en terminer un. Un séparateur final ne donne pas
+ * de champ vide. */
+static void append_split(struct expander *exp, const char *text, size_t len)
+{
+    const char *ifs = vars_get(exp->state->vars, "IFS", 3);
+    if (!ifs)
+        ifs = IFS_DEFAULT;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (exp->single || text[i] == '\0' || !strchr(ifs, text[i]))
+            put_unquoted(exp, text[i]);
+        else if (ifs_is_space(ifs, text[i]))
+        {
+            if (field_pending(exp))
+            {
+                add_arg(exp);
+                exp->split_space = 1;
+            }
+        }
+        else if (field_pending(exp) || !exp->split_space)
+            add_arg(exp);
+        else
+            exp->split_space = 0;
+    }
+}
+
+static void append_value(struct expander *exp, const char *value, size_t len, int split)
+{
+    if (split)
+        append_split(exp, value, len);
+    else
+        put_quoted(exp, value, len);
+}
+
+static int is_special_parameter(char c)
+{
+    return c == '?' || c == '$' || c == '!' || c == '#' || c == '@' ||
+           c == '*' || c == '-' || (c >= '0' && c <= '9');
+}
+
+static int is_positional(const char *name, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (name[i] < '0' || name[i] > '9')
+            return 0;
+    }
+    return len > 0;
+}
+
+/* Valeur d'un paramètre ; les valeurs numériques sont formatées dans number */
+static const char *parameter_value(struct expander *exp, const char *name, size_t len,
+                                   char number[32])
+{
+    struct exec_state *state = exp->state;
+
+    if (is_positional(name, len))
+    {
+        size_t index = 0;
+        for (size_t i = 0; i < len && index <= (size_t)state->frame->count; i++)
+            index = 10 * index + (name[i] - '0');
+        if (index == 0)
+            return state->name;
+        return index <= (size_t)state->frame->count ? state->frame->params[index - 1] : NULL;
+    }
+
+    if (len == 1 && is_special_parameter(name[0]))
+    {
+        switch (name[0])
+        {
+            case '?':
+                snprintf(number, 32, "%d", state->last_return);
+                return number;
+            case '$':
+                snprintf(number, 32, "%ld", (long)exec_shell_pid(state));
+                return number;
+            case '!':
+                if (!state->last_bg_pid)
+                    return NULL;
+                snprintf(number, 32, "%ld", (long)state->last_bg_pid);
+                return number;
+            case '#':
+                snprintf(number, 32, "%d", state->frame->count);
+                return number;
+            default:
+                return NULL;
+        }
+    }
+    return vars_get(state->vars, name, len);
+}
+
+/* Entrée du cache des formes compilées pour ce texte de la commande, créée
+ * vide au besoin : une boucle ne compile son arithmétique et ses motifs
+ * qu'une fois. */
+static struct compiled_cache *cache_entry(struct expander *exp, const char *source)
+{
+    struct command_scratch *scratch = exp->scratch;
+
+    for (int i = 0; i < scratch->compiled_count; i++)
+    {
+        if (scratch->compiled[i].source == source)
+            return &scratch->compiled[i];
+    }
+
+    if (scratch->compiled_count == scratch->compiled_capacity)
+    {
+        int capacity = scratch->compiled_capacity ? 2 * scratch->compiled_capacity : 4;
+        struct compiled_cache *compiled = realloc(scratch->compiled,
+                                                  sizeof(struct compiled_cache) * capacity);
+        if (!compiled)
+            return NULL;
+        scratch->compiled = compiled;
+        scratch->compiled_capacity = capacity;
+    }
+
+    struct compiled_cache *entry = &scratch->compiled[scratch->compiled_count++];
+    entry->source = source;
+    entry->compiled = NULL;
+    return entry;
+}
+
+static struct arith_expr *cached_arith(struct expander *exp, const char *body, size_t len,
+                                       const char **error)
+{
+    struct compiled_cache *entry = cache_entry(exp, body);
+
+    if (!entry)
+    {
+        *error = "out of memory";
+        return NULL;
+    }
+    if (!entry->compiled)
+        entry->compiled = arith_compile(body, len, error);
+    return entry->compiled;
+}
+
+static void expand_heredoc_body(struct expander *exp, const char *body, size_t len);
+
+/* $((...)) : un texte sans '$' ni '\\' est compilé une fois par commande ;
+ * sinon il est d'abord expansé, puis compilé à chaque évaluation. */
+static size_t expand_arithmetic(struct expander *exp, const char *word, size_t end,
+                                size_t i, int split)
+{
+    const char *body = word + i + 3;
+    size_t len = end - i - 5;
+    const char *error = NULL;
+    struct arith_expr *expr;
+    char *expanded = NULL;
+    int64_t value = 0;
+
+    if (memchr(body, '$', len) || memchr(body, '\\', len))
+    {
+        size_t start = exp->text->len;
+        int globbing = exp->globbing;
+        exp->globbing = 0;
+        expand_heredoc_body(exp, body, len);
+        exp->globbing = globbing;
+        if (exp->error)
+            return end;
+        expanded = my_strndup(exp->text->data + start, exp->text->len - start);
+        exp->text->len = start;
+        exp->text->data[start] = '\0';
+        if (!expanded)
+        {
+            exp->error = 1;
+            return end;
+        }
+        body = expanded;
+        len = strlen(expanded);
+        expr = arith_compile(body, len, &error);
+    }
+    else
+        expr = cached_arith(exp, body, len, &error);
+
+    if (!expr || arith_eval(expr, exp->state->vars, &value, &error) == -1)
+    {
+        exec_error(exp->state, "minishell: %.*s: %s\n", (int)len, body, error);
+        exp->error = 1;
+    }
+    else
+    {
+        char number[32];
+        int n = snprintf(number, sizeof(number), "%" PRId64, value);
+        append_value(exp, number, n, split);
+    }
+
+    if (expanded)
+    {
+        free(expr);
+        free(expanded);
+    }
+    return end;
+}
+
+static size_t expand_substitution(struct expander *exp, const char *word, size_t len,
+                                  size_t i, int split)
+{
+    struct strbuf *output = &exp->scratch->subst;
+    size_t end = i;
+    int flags = 0;
+
+    if (lexer_scan_quoted(word, len, &end, &flags) == -1)
+        end = len;
+    if (word[i + 2] == '(' && end >= i + 5 && word[end - 2] == ')')
+        return expand_arithmetic(exp, word, end, i, split);
+
+    strbuf_reset(output);
+    command_substitute(word + i + 2, end - i - 3, exp->state, output);
+    append_value(exp, output->data ? output->data : "", output->len, split);
+    return end;
+}
+
+/* <(...) et >(...) : un seul champ /dev/fd/N, jamais découpé ni développé */
+static size_t expand_process(struct expander *exp, const char *word, size_t len, size_t i)
+{
+    size_t end = i;
+    int flags = 0;
+
+    if (lexer_scan_quoted(word, len, &end, &flags) == -1 || end < i + 3)
+    {
+        exp->error = 1;
+        return len;
+    }
+    int fd = process_substitute(word + i + 2, end - i - 3, word[i] == '>', exp->state);
+    if (fd == -1)
+    {
+        exp->error = 1;
+        return end;
+    }
+
+    char path[32];
+    int n = snprintf(path, sizeof(path), "/dev/fd/%d", fd);
+    put_quoted(exp, path, n);
+    exp->field_started = 1;
+    return end;
+}
+
+/* $@ et $* : hors quotes, chaque paramètre est découpé séparément ; "$@"
+ * dans les arguments donne un champ par paramètre ; sinon les paramètres
+ * sont joints par le premier caractère de IFS. */
+static void expand_positional(struct expander *exp, char which, int split)
+{
+    struct call_frame *frame = exp->state->frame;
+
+    if (split && !exp->single)
+    {
+        for (int i = 0; i < frame->count; i++)
+        {
+            if (i > 0 && field_pending(exp))
+                add_arg(exp);
+            append_split(exp, frame->params[i], strlen(frame->params[i]));
+        }
+        return;
+    }
+
+    if (which == '@' && exp->fields)
+    {
+        for (int i = 0; i < frame->count; i++)
+        {
+            if (i > 0)
+            {
+                add_arg(exp);
+                exp->field_started = 1;
+            }
+            put_quoted(exp, frame->params[i], strlen(frame->params[i]));
+        }
+        return;
+    }
+
+    const char *ifs = vars_get(exp->state->vars, "IFS", 3);
+    char separator = ifs ? ifs[0] : ' ';
+    for (int i = 0; i < frame->count; i++)
+    {
+        if (i > 0 && separator)
+            put_quoted(exp, &separator, 1);
+        put_quoted(exp, frame->params[i], strlen(frame->params[i]));
+    }
+}
+
+/* $nom, ${nom}, $?, $$, $!, $(...), $((...)) ; renvoie la position qui suit. */
+static size_t expand_dollar(struct expander *exp, const char *word, size_t len, size_t i,
+                            int split)
+{
+    const char *name = word + i + 1;
+    size_t name_len = 0;
+    size_t next;
+    char number[32];
+
+    if (i + 1 < len && word[i + 1] == '(')
+        return expand_substitution(exp, word, len, i, split);
+
+    if (i + 1 < len && word[i + 1] == '{')
+    {
+        const char *close = memchr(word + i + 2, '}', len - i - 2);
+        name = word + i + 2;
+        name_len = close ? (size_t)(close - name) : 0;
+        if (!close || !(is_valid_name(name, name_len) || is_positional(name, name_len) ||
+                        (name_len == 1 && is_special_parameter(name[0]))))
+        {
+            exec_error(exp->state, "minishell: %.*s: bad substitution\n",
+                       close ? (int)(close - word - i + 1) : (int)(len - i), word + i);
+            exp->error = 1;
+            return len;
+        }
+        next = close - word + 1;
+    }
+    else if (i + 1 < len && is_special_parameter(word[i + 1]))
+    {
+        name_len = 1;
+        next = i + 2;
+    }
+    else
+    {
+        while (i + 1 + name_len < len && is_valid_name(name, name_len + 1))
+            name_len++;
+        if (name_len == 0)
+        {
+            strbuf_putc(exp->text, '$');
+            return i + 1;
+        }
+        next = i + 1 + name_len;
+    }
+
+    if (name_len == 1 && (name[0] == '@' || name[0] == '*'))
+    {
+        expand_positional(exp, name[0], split);
+        return next;
+    }
+
+    const char *value = parameter_value(exp, name, name_len, number);
+    if (value)
+        append_value(exp, value, strlen(value), split);
+    return next;
+}
+
+static size_t expand_double_quoted(struct expander *exp, const char *word, size_t len,
+                                   size_t i)
+{
+    /* "$@" sans paramètres ne produit aucun champ */
+    if (exp->fields && exp->state->frame->count == 0)
+    {
+        if (strncmp(word + i, "$@\"", 3) == 0)
+            return i + 3;
+        if (strncmp(word + i, "${@}\"", 5) == 0)
+            return i + 5;
+    }
+
+    exp->field_started = 1;
+    while (i < len && word[i] != '"')
+    {
+        if (word[i] == '\\' && i + 1 < len && strchr("$`\"\\\n", word[i + 1]))
+        {
+            if (word[i + 1] != '\n')
+                put_quoted(exp, word + i + 1, 1);
+            i += 2;
+        }
+        else if (word[i] == '$')
+            i = expand_dollar(exp, word, len, i, 0);
+        else
+            put_quoted(exp, word + i++, 1);
+    }
+    return i + 1;
+}
+
+/* Expansion d'un mot brut : paramètres, substitutions, retrait des quotes
+ * et, si split, découpage en champs. Le texte produit est ajouté à text. */
+static void expand_word(struct expander *exp, const char *word, int split)
+{
+    size_t len = strlen(word);
+    size_t i = 0;
+
+    while (i < len && !exp->error)
+    {
+        char c = word[i];
+
+        if (c == '\'')
+        {
+            const char *end = memchr(word + i + 1, '\'', len - i - 1);
+            size_t stop = end ? (size_t)(end - word) : len;
+            put_quoted(exp, word + i + 1, stop - i - 1);
+            exp->field_started = 1;
+            i = stop + 1;
+        }
+        else if (c == '"')
+            i = expand_double_quoted(exp, word, len, i + 1);
+        else if (c == '\\' && i + 1 < len)
+        {
+            if (word[i + 1] != '\n')
+                put_quoted(exp, word + i + 1, 1);
+            exp->field_started = 1;
+            i += 2;
+        }
+        else if (c == '$')
+            i = expand_dollar(exp, word, len, i, split);
+        else if ((c == '<' || c == '>') && i + 1 < len && word[i + 1] == '(')
+            i = expand_process(exp, word, len, i);
+        else
+            put_unquoted(exp, word[i++]);
+    }
+}
+
+/* Corps de here-document non quoté : seuls $ et les échappements \$ \` \\
+ * et \<newline> sont interprétés, les quotes restent littérales. */
+static void expand_heredoc_body(struct expander *exp, const char *body, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len && !exp->error)
+    {
+        if (body[i] == '\\' && i + 1 < len && strchr("$`\\\n", body[i + 1]))
+        {
+            if (body[i + 1] != '\n')
+                strbuf_putc(exp->text, body[i + 1]);
+            i += 2;
+        }
+        else if (body[i] == '$')
+            i = expand_dollar(exp, body, len, i, 0);
+        else
+            strbuf_putc(exp->text, body[i++]);
+    }
+}
+
+static size_t expand_single(struct expander *exp, const char *word, int flags)
+{
+    if (!flags)
+        return LITERAL_WORD;
+    begin_field(exp);
+    expand_word(exp, word, 0);
+    return end_field(exp);
+}
+
+static struct command_scratch *acquire_scratch(struct command *cmd)
+{
+    struct command_scratch *scratch = cmd->scratch;
+
+    if (!scratch || scratch->in_use)
+    {
+        scratch = calloc(1, sizeof(struct command_scratch));
+        if (!scratch)
+            return NULL;
+        if (!cmd->scratch)
+            cmd->scratch = scratch;
+    }
+
+    if (!scratch->word_offsets)
+    {
+        int words = cmd->assignments_count + 2 * cmd->redirections_count;
+        scratch->word_offsets = malloc(sizeof(size_t) * (words + 1));
+        scratch->assignments = calloc(cmd->assignments_count + 1, sizeof(char *));
+        scratch->redirections = calloc(cmd->redirections_count + 1, sizeof(struct redirection));
+        scratch->redirection_ptrs = calloc(cmd->redirections_count + 1,
+                                           sizeof(struct redirection *));
+        if (!scratch->word_offsets || !scratch->assignments ||
+            !scratch->redirections || !scratch->redirection_ptrs)
+        {
+            if (scratch != cmd->scratch)
+                command_scratch_free(scratch);
+            return NULL;
+        }
+    }
+    scratch->in_use = 1;
+    return scratch;
+}
+
+struct command *expand_command(struct command *cmd, struct exec_state *state)
+{
+    struct command_scratch *scratch = acquire_scratch(cmd);
+    if (!scratch)
+        return NULL;
+
+    struct expander exp = { state, scratch, &scratch->text, 0, 0, 0, 0, 0, 0, 0, NULL, 1, 0, 0 };
+    size_t *words = scratch->word_offsets;
+    int nwords = 0;
+
+    strbuf_reset(&scratch->text);
+    if (reserve_args(&exp, cmd->args_count + 1) == -1)
+        exp.error = 1;
+
+    for (int i = 0; i < cmd->args_count && !exp.error; i++)
+    {
+        if (!cmd->args_flags[i])
+        {
+            scratch->offsets[exp.count] = LITERAL_WORD;
+            scratch->args[exp.count++] = cmd->args[i];
+            continue;
+        }
+        int flags = cmd->args_flags[i];
+        if (flags & WORD_SINGLE)
+        {
+            /* Mot ou motif d'un case : un seul champ, jamais développé */
+            if (reserve_args(&exp, exp.count + 2) == -1)
+            {
+                exp.error = 1;
+                break;
+            }
+            exp.globbing = flags & WORD_PATTERN;
+            exp.fields = 0;
+            exp.single = 1;
+            begin_field(&exp);
+            expand_word(&exp, cmd->args[i], 1);
+            scratch->offsets[exp.count++] = end_field(&exp);
+            exp.fields = 1;
+            exp.single = 0;
+            continue;
+        }
+        exp.globbing = (flags & (WORD_GLOB | WORD_DOLLAR)) && !(state->options & OPT_NOGLOB);
+        exp.glob_key = (flags & WORD_DOLLAR) ? NULL : cmd->args[i];
+        begin_field(&exp);
+        expand_word(&exp, cmd->args[i], 1);
+        if (field_pending(&exp))
+            add_arg(&exp);
+    }
+    exp.globbing = 0;
+    exp.fields = 0;
+
+    for (int i = 0; i < cmd->assignments_count && !exp.error; i++)
+        words[nwords++] = expand_single(&exp, cmd->assignments[i], cmd->assignments_flags[i]);
+
+    for (int i = 0; i < cmd->redirections_count && !exp.error; i++)
+    {
+        struct redirection *redir = cmd->redirections[i];
+        int heredoc = strncmp(redir->operator, "<<", 2) == 0;
+
+        words[nwords++] = heredoc ? LITERAL_WORD
+            : expand_single(&exp, redir->word, redir->word_flags);
+        if (heredoc && !(redir->word_flags & WORD_QUOTED) && redir->heredoc &&
+            memchr(redir->heredoc, '$', redir->heredoc_len))
+        {
+            begin_field(&exp);
+            expand_heredoc_body(&exp, redir->heredoc, redir->heredoc_len);
+            words[nwords++] = end_field(&exp);
+        }
+        else
+            words[nwords++] = LITERAL_WORD;
+    }
+
+    if (exp.error)
+    {
+        expand_command_release(cmd, &scratch->expanded);
+        return NULL;
+    }
+
+    /* Le texte a pu être réalloué : les pointeurs ne sont fixés qu'à la fin */
+    char *text = scratch->text.data;
+    struct command *expanded = &scratch->expanded;
+
+    for (int i = 0; i < exp.count; i++)
+    {
+        if (scratch->offsets[i] != LITERAL_WORD)
+            scratch->args[i] = text + scratch->offsets[i];
+    }
+    scratch->args[exp.count] = NULL;
+
+    nwords = 0;
+    for (int i = 0; i < cmd->assignments_count; i++, nwords++)
+        scratch->assignments[i] = words[nwords] == LITERAL_WORD ? cmd->assignments[i]
+            : text + words[nwords];
+
+    for (int i = 0; i < cmd->redirections_count; i++, nwords += 2)
+    {
+        struct redirection *copy = &scratch->redirections[i];
+        *copy = *cmd->redirections[i];
+        if (words[nwords] != LITERAL_WORD)
+            copy->word = text + words[nwords];
+        if (words[nwords + 1] != LITERAL_WORD)
+        {
+            copy->heredoc = text + words[nwords + 1];
+            copy->heredoc_len = strlen(copy->heredoc);
+        }
+        scratch->redirection_ptrs[i] = copy;
+    }
+
+    *expanded = *cmd;
+    expanded->args = scratch->args;
+    expanded->args_count = exp.count;
+    expanded->name = exp.count > 0 ? scratch->args[0] : NULL;
+    expanded->assignments = scratch->assignments;
+    expanded->redirections = scratch->redirection_ptrs;
+    expanded->scratch = NULL;
+    return expanded;
+}
+
+void expand_command_release(struct command *cmd, struct command *expanded)
+{
+    struct command_scratch *scratch = (struct command_scratch *)
+        ((char *)expanded - offsetof(struct command_scratch, expanded));
+
+    if (scratch == cmd->scratch)
+        scratch->in_use = 0;
+    else
+        command_scratch_free(scratch);
+}
+
+/* Vrai si l'expansion du mot peut affecter une variable : ${x=...},
+ * ${x:=...} ou une affectation, ++ ou -- dans $((...)). Approximation
+ * prudente : un '=' de comparaison autre que == et != compte aussi. */
+static int may_assign(const char *word)
+{
+    int arith = 0;
+
+    for (const char *p = word; *p; p++)
+    {
+        if (p[0] == '$' && p[1] == '(' && p[2] == '(')
+            arith = 1;
+        else if (p[0] == '$' && p[1] == '{')
+        {
+            const char *end = strchr(p, '}');
+            const char *equal = strchr(p, '=');
+            if (equal && (!end || equal < end))
+                return 1;
+        }
+        else if (arith && ((p[0] == '+' && p[1] == '+') || (p[0] == '-' && p[1] == '-')))
+            return 1;
+        else if (arith && p[0] == '=')
+        {
+            if (p[1] == '=')
+                p++;
+            else if (p == word || p[-1] != '!')
+                return 1;
+        }
+    }
+    return 0;
+}
+
+static int command_may_assign(struct command *cmd)
+{
+    if (!(cmd->flags & WORD_DOLLAR))
+        return 0;
+    for (int i = 0; i < cmd->args_count; i++)
+    {
+        if (may_assign(cmd->args[i]))
+            return 1;
+    }
+    for (int i = 0; i < cmd->redirections_count; i++)
+    {
+        struct redirection *redir = cmd->redirections[i];
+        if (may_assign(redir->word) || (redir->heredoc && may_assign(redir->heredoc)))
+            return 1;
+    }
+    return 0;
+}
+
+/* Une substitution ne contenant que des builtins sans effet sur le shell
+ * (ceux qui peuvent aussi tourner en thread) s'exécute dans le shell même,
+ * sauf si l'expansion de ses mots peut affecter une variable : la table est
+ * celle du shell et le fils seul doit voir l'affectation. */
+static int is_builtin_only(struct ast_node *node)
+{
+    switch (node->type)
+    {
+        case NODE_COMMAND:
+        {
+            struct command *cmd = node->data.command;
+            if (!cmd->name || cmd->args_flags[0] || cmd->assignments_count > 0 ||
+                (cmd->flags & WORD_PROCESS) || command_may_assign(cmd))
+                return 0;
+            const struct builtin *builtin = builtin_lookup(cmd->name);
+            return builtin && (builtin->flags & BUILTIN_THREAD_SAFE);
+        }
+        case NODE_AND_OR:
+        case NODE_SEQUENCE:
+            return is_builtin_only(node->data.binary.left) &&
+                   is_builtin_only(node->data.binary.right);
+        default:
+            return 0;
+    }
+}
+
+static int run_substitution(struct ast_node **asts, int count, struct exec_state *state)
+{
+    for (int i = 0; i < count && !state->should_exit; i++)
+        exec_ast(asts[i], state);
+    return state->should_exit ? state->exit_code : state->last_return;
+}
+
+/* Un seul fork ; le parent vide le pipe directement dans la mémoire libre du
+ * tampon, qui double à chaque fois qu'il est plein. */
+static int substitute_fork(struct ast_node **asts, int count, struct exec_state *state,
+                           struct strbuf *out)
+{
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) == -1)
+        return 1;
+
+    exec_shell_pid(state);
+    uint64_t start = stats_now();
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return 1;
+    }
+    if (pid == 0)
+    {
+        close(pipefd[0]);
+        exec_enter_child(state);
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[1]);
+        state->capture = NULL;
+        state->capture_err = NULL;
+        _exit(run_substitution(asts, count, state));
+    }
+
+    state->stats.fork_ns += stats_now() - start;
+    state->stats.forks++;
+    if (trace_enabled())
+        trace_span(TRACE_FORK, "substitution", start, pid);
+
+    close(pipefd[1]);
+    size_t chunk = BUFFER_SIZE;
+    for (;;)
+    {
+        if (strbuf_reserve(out, chunk) == -1)
+            break;
+        ssize_t n = read(pipefd[0], out->data + out->len, out->capacity - out->len - 1);
+        if (n > 0)
+        {
+            out->len += n;
+            if (out->len + 1 == out->capacity)
+                chunk = out->capacity;
+        }
+        else if (n == 0 || errno != EINTR)
+            break;
+    }
+    if (out->data)
+        out->data[out->len] = '\0';
+    close(pipefd[0]);
+
+    int status;
+    start = stats_now();
+    pid_t waited = waitpid(pid, &status, 0);
+    state->stats.wait_ns += stats_now() - start;
+    if (trace_enabled())
+        trace_span(TRACE_WAIT, "substitution", start,
+                   waited != -1 && WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    if (waited == -1)
+        return 1;
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    return WIFSIGNALED(status) ? 128 + WTERMSIG(status) : 1;
+}
+
+/* Analyse le texte d'une substitution ; renvoie 2 sur une erreur de
+ * syntaxe, 1 si la mémoire manque */
+static int parse_substitution(const char *text, size_t len, const char *kind,
+                              struct exec_state *state, struct ast_node ***asts, int *count,
+                              int *builtin_only)
+{
+    char *input = strndup(text, len);
+    if (!input)
+        return 1;
+
+    struct lexer *lexer = lexer_init(input);
+    if (lexer)
+        lexer->line = state->line;
+    struct parser *parser = parser_init(lexer);
+    int ret = 0;
+
+    *asts = NULL;
+    *count = 0;
+    *builtin_only = 1;
+    for (;;)
+    {
+        struct ast_node *ast = parse_input(parser);
+        if (!ast)
+        {
+            if (parser->has_error)
+            {
+                exec_error(state, "minishell: syntax error in %s\n", kind);
+                ret = 2;
+            }
+            break;
+        }
+        struct ast_node **grown = realloc(*asts, sizeof(struct ast_node *) * (*count + 1));
+        if (!grown)
+        {
+            ast_node_free(ast);
+            ret = 1;
+            break;
+        }
+        *asts = grown;
+        (*asts)[(*count)++] = ast;
+        *builtin_only = *builtin_only && is_builtin_only(ast);
+    }
+
+    parser_free(parser);
+    lexer_free(lexer);
+    free(input);
+    return ret;
+}
+
+static void free_substitution(struct ast_node **asts, int count)
+{
+    for (int i = 0; i < count; i++)
+        ast_node_free(asts[i]);
+    free(asts);
+}
+
+int command_substitute(const char *text, size_t len, struct exec_state *state,
+                       struct strbuf *out)
+{
+    struct ast_node **asts;
+    int count;
+    int builtin_only;
+    int ret = parse_substitution(text, len, "command substitution", state, &asts, &count,
+                                 &builtin_only);
+
+    if (ret == 0 && count > 0)
+    {
+        if (builtin_only)
+        {
+            /* Les répertoires lus pendant la substitution ont leur propre
+             * cache, libéré avec elle */
+            struct exec_state sub = *state;
+            sub.capture = out;
+            sub.fds[1] = -1;
+            sub.should_exit = 0;
+            sub.globs = NULL;
+            ret = run_substitution(asts, count, &sub);
+            glob_cache_free(sub.globs);
+        }
+        else
+            ret = substitute_fork(asts, count, state, out);
+    }
+
+    /* Retrait des retours à la ligne finaux sur place, sans réallocation */
+    while (out->len > 0 && out->data[out->len - 1] == '\n')
+        out->len--;
+    if (out->data)
+        out->data[out->len] = '\0';
+
+    free_substitution(asts, count);
+    state->last_return = ret;
+    state->substituted = 1;
+    return ret;
+}
+
+int process_substitute(const char *text, size_t len, int output, struct exec_state *state)
+{
+    struct process_subs *procsubs = &state->procsubs;
+    struct ast_node **asts;
+    int count;
+    int builtin_only;
+
+    if (parse_substitution(text, len, "process substitution", state, &asts, &count,
+                           &builtin_only) != 0)
+    {
+        free_substitution(asts, count);
+        return -1;
+    }
+
+    /* La place est prise avant le fork : une fois le fils lancé, rien ne
+     * peut plus échouer côté shell */
+    if (procsubs->count == procsubs->capacity)
+    {
+        size_t capacity = procsubs->capacity ? 2 * procsubs->capacity : 4;
+        struct process_sub *grown = realloc(procsubs->subs,
+                                            capacity * sizeof(struct process_sub));
+        if (!grown)
+        {
+            free_substitution(asts, count);
+            return -1;
+        }
+        procsubs->subs = grown;
+        procsubs->capacity = capacity;
+    }
+
+    /* pipefd[output] reste au shell ; le fils a l'autre bout en entrée
+     * (>(...)) ou en sortie (<(...)) */
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) == -1)
+    {
+        exec_error(state, "minishell: pipe: %s\n", strerror(errno));
+        free_substitution(asts, count);
+        return -1;
+    }
+
+    exec_shell_pid(state);
+    uint64_t start = stats_now();
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        exec_error(state, "minishell: fork: %s\n", strerror(errno));
+        close(pipefd[0]);
+        close(pipefd[1]);
+        free_substitution(asts, count);
+        return -1;
+    }
+    if (pid == 0)
+    {
+        int child_fd = output ? STDIN_FILENO : STDOUT_FILENO;
+
+        /* Les substitutions déjà ouvertes appartiennent à la commande, pas à
+         * celle-ci : les garder bloquerait la fin de fichier d'un >(...) */
+        for (size_t i = 0; i < procsubs->count; i++)
+            close(procsubs->subs[i].fd);
+        procsubs->count = 0;
+        exec_enter_child(state);
+        dup2(pipefd[!output], child_fd);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        state->capture = NULL;
+        state->capture_err = NULL;
+        _exit(run_substitution(asts, count, state));
+    }
+
+    state->stats.fork_ns += stats_now() - start;
+    state->stats.forks++;
+    if (trace_enabled())
+        trace_span(TRACE_FORK, "process substitution", start, pid);
+
+    close(pipefd[!output]);
+    procsubs->subs[procsubs->count].fd = pipefd[output];
+    procsubs->subs[procsubs->count].pid = pid;
+    procsubs->count++;
+    free_substitution(asts, count);
+    return pipefd[output];
+}
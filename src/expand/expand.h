@@ -0,0 +1,27 @@
+#ifndef EXPAND_H
+#define EXPAND_H
+
+#include "../all.h"
+#include "../parser/parser.h"
+#include "../exec/exec.h"
+#include "../string_utils.h"
+
+/* Expansion des mots d'une commande entre l'analyse et l'exécution. Le
+ * résultat a la forme d'une struct command, pour que l'exécution n'ait pas
+ * à distinguer une commande expansée d'une commande littérale. Il vit dans
+ * la mémoire de travail de la commande jusqu'à expand_command_release. */
+struct command *expand_command(struct command *cmd, struct exec_state *state);
+void expand_command_release(struct command *cmd, struct command *expanded);
+
+/* Exécute le texte d'une substitution $(...) et ajoute sa sortie, sans les
+ * retours à la ligne finaux, à out. */
+int command_substitute(const char *text, size_t len, struct exec_state *state,
+                       struct strbuf *out);
+
+/* Lance le texte d'une substitution de processus relié au shell par un
+ * pipe : output vaut 1 pour >(...), dont le fils lit le pipe, 0 pour <(...),
+ * dont il y écrit. Le bout du shell est enregistré dans state->procsubs et
+ * renvoyé, pour être nommé /dev/fd/N ; -1 en cas d'échec. */
+int process_substitute(const char *text, size_t len, int output, struct exec_state *state);
+
+#endif /* EXPAND_H */
@@ -0,0 +1,574 @@
+#include "glob.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+
+/* Taille d'un lot de getdents64 : un répertoire d'un million d'entrées se
+ * lit en quelques centaines d'appels. */
+#define GLOB_BATCH_SIZE (256 * 1024)
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static const struct {
+    const char *name;
+    int (*test)(int);
+} char_classes[] = {
+    { "alnum", isalnum }, { "alpha", isalpha }, { "blank", isblank },
+    { "cntrl", iscntrl }, { "digit", isdigit }, { "graph", isgraph },
+    { "lower", islower }, { "print", isprint }, { "punct", ispunct },
+    { "space", isspace }, { "upper", isupper }, { "xdigit", isxdigit },
+};
+
+static void set_bit(unsigned char *bits, unsigned char c)
+{
+    bits[c >> 3] |= 1 << (c & 7);
+}
+
+/* [...] à partir de la position qui suit '[' ; renvoie la position qui suit
+ * ']', ou 0 si la classe n'est pas refermée dans le composant. */
+static size_t parse_class(const char *p, size_t i, size_t end, unsigned char *bits)
+{
+    int negate = 0;
+    size_t start;
+
+    memset(bits, 0, 32);
+    if (i < end && (p[i] == '!' || p[i] == '^'))
+    {
+        negate = 1;
+        i++;
+    }
+
+    start = i;
+    while (i < end && (p[i] != ']' || i == start))
+    {
+        if (p[i] == '[' && i + 1 < end && p[i + 1] == ':')
+        {
+            const char *close = memchr(p + i + 2, ':', end - i - 2);
+            size_t n = sizeof(char_classes) / sizeof(char_classes[0]);
+            size_t k = 0;
+
+            if (close && close + 1 < p + end && close[1] == ']')
+            {
+                size_t name_len = close - (p + i + 2);
+                while (k < n && (strlen(char_classes[k].name) != name_len ||
+                                 memcmp(char_classes[k].name, p + i + 2, name_len) != 0))
+                    k++;
+            }
+            if (close && k < n)
+            {
+                for (int c = 0; c < 256; c++)
+                {
+                    if (char_classes[k].test(c))
+                        set_bit(bits, c);
+                }
+                i = close - p + 2;
+                continue;
+            }
+        }
+
+        if (p[i] == '\\' && i + 1 < end)
+            i++;
+        unsigned char low = p[i++];
+        unsigned char high = low;
+        if (i + 1 < end && p[i] == '-' && p[i + 1] != ']')
+        {
+            i++;
+            if (p[i] == '\\' && i + 1 < end)
+                i++;
+            high = p[i++];
+        }
+        for (unsigned c = low; c <= high; c++)
+            set_bit(bits, c);
+    }
+    if (i >= end)
+        return 0;
+
+    if (negate)
+    {
+        for (int k = 0; k < 32; k++)
+            bits[k] = ~bits[k];
+    }
+    return i + 1;
+}
+
+/* Avec path, chaque composant du chemin a son matcher ; sinon le motif
+ * entier n'en forme qu'un, où '/' et '.' sont des caractères ordinaires. */
+static struct glob_pattern *compile_pattern(const char *pattern, size_t len, int path)
+{
+    size_t segments = 1;
+    size_t classes = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        segments += path && pattern[i] == '/';
+        classes += pattern[i] == '[';
+    }
+
+    /* Une opération consomme au moins un caractère : len + 1 suffisent */
+    size_t size = sizeof(struct glob_pattern) + segments * sizeof(struct glob_matcher) +
+                  (len + 1) * sizeof(struct glob_op) + classes * 32 + len + 1;
+    struct glob_pattern *compiled = malloc(size);
+    if (!compiled)
+        return NULL;
+
+    compiled->segments = (struct glob_matcher *)(compiled + 1);
+    compiled->ops = (struct glob_op *)(compiled->segments + segments);
+    compiled->classes = (unsigned char (*)[32])(compiled->ops + len + 1);
+    char *text = (char *)(compiled->classes + classes);
+    compiled->text = text;
+    compiled->absolute = path && len > 0 && pattern[0] == '/';
+    compiled->trailing_slash = path && len > 0 && pattern[len - 1] == '/';
+    compiled->count = 0;
+
+    size_t n_ops = 0;
+    size_t n_classes = 0;
+    size_t n_text = 0;
+    size_t i = 0;
+
+    while (i < len)
+    {
+        size_t end = path ? i : len;
+        while (end < len && pattern[end] != '/')
+            end++;
+        if (end == i)
+        {
+            i++;
+            continue;
+        }
+
+        struct glob_matcher *seg = &compiled->segments[compiled->count++];
+        seg->ops = n_ops;
+        seg->dot = !path || pattern[i] == '.' ||
+                   (pattern[i] == '\\' && i + 1 < end && pattern[i + 1] == '.');
+
+        while (i < end)
+        {
+            struct glob_op *last = n_ops > seg->ops ? &compiled->ops[n_ops - 1] : NULL;
+            char c = pattern[i];
+
+            if (c == '*')
+            {
+                if (!last || last->type != GLOB_STAR)
+                    compiled->ops[n_ops++] = (struct glob_op){ GLOB_STAR, 0, 0 };
+                i++;
+                continue;
+            }
+            if (c == '?')
+            {
+                compiled->ops[n_ops++] = (struct glob_op){ GLOB_ANY, 0, 0 };
+                i++;
+                continue;
+            }
+            if (c == '[')
+            {
+                size_t next = parse_class(pattern, i + 1, end, compiled->classes[n_classes]);
+                if (next)
+                {
+                    compiled->ops[n_ops++] = (struct glob_op){ GLOB_CLASS, n_classes++, 0 };
+                    i = next;
+                    continue;
+                }
+            }
+
+            if (c == '\\' && i + 1 < end)
+                c = pattern[++i];
+            i++;
+            if (!last || last->type != GLOB_CHARS)
+                compiled->ops[n_ops++] = (struct glob_op){ GLOB_CHARS, n_text, 0 };
+            compiled->ops[n_ops - 1].len++;
+            text[n_text++] = c;
+        }
+
+        seg->count = n_ops - seg->ops;
+        seg->literal = seg->count == 1 && compiled->ops[seg->ops].type == GLOB_CHARS;
+    }
+    text[n_text] = '\0';
+    return compiled;
+}
+
+struct glob_pattern *glob_compile(const char *pattern, size_t len)
+{
+    return compile_pattern(pattern, len, 1);
+}
+
+struct glob_pattern *glob_compile_word(const char *pattern, size_t len)
+{
+    struct glob_pattern *compiled = compile_pattern(pattern, len, 0);
+
+    /* Un motif vide garde un matcher, qui n'accepte que le mot vide */
+    if (compiled && compiled->count == 0)
+    {
+        compiled->segments[0] = (struct glob_matcher){ 0, 0, 0, 1 };
+        compiled->count = 1;
+    }
+    return compiled;
+}
+
+static int class_has(const struct glob_pattern *pattern, size_t index, unsigned char c)
+{
+    return pattern->classes[index][c >> 3] & (1 << (c & 7));
+}
+
+/* Correspondance gloutonne : en cas d'échec, on revient à la dernière '*'
+ * en lui faisant absorber un caractère de plus. Coût au pire O(n*m). */
+int glob_match(const struct glob_pattern *pattern, const struct glob_matcher *matcher,
+               const char *name, size_t len)
+{
+    const struct glob_op *ops = pattern->ops + matcher->ops;
+    const char *text = pattern->text;
+    size_t n = matcher->count;
+
+    if (n == 0)
+        return len == 0;
+    if (matcher->literal)
+        return ops[0].len == len && memcmp(text + ops[0].arg, name, len) == 0;
+    if (n == 1 && ops[0].type == GLOB_STAR)
+        return 1;
+    if (n == 2 && ops[0].type == GLOB_STAR && ops[1].type == GLOB_CHARS)
+        return len >= ops[1].len &&
+               memcmp(name + len - ops[1].len, text + ops[1].arg, ops[1].len) == 0;
+    if (n == 2 && ops[0].type == GLOB_CHARS && ops[1].type == GLOB_STAR)
+        return len >= ops[0].len && memcmp(name, text + ops[0].arg, ops[0].len) == 0;
+
+    size_t i = 0;
+    size_t j = 0;
+    size_t star = n;
+    size_t star_pos = 0;
+
+    while (i < n || j < len)
+    {
+        if (i < n)
+        {
+            const struct glob_op *op = &ops[i];
+            if (op->type == GLOB_STAR)
+            {
+                star = i++;
+                star_pos = j;
+                continue;
+            }
+            if (op->type == GLOB_CHARS && j + op->len <= len &&
+                memcmp(name + j, text + op->arg, op->len) == 0)
+            {
+                i++;
+                j += op->len;
+                continue;
+            }
+            if ((op->type == GLOB_ANY && j < len) ||
+                (op->type == GLOB_CLASS && j < len &&
+                 class_has(pattern, op->arg, (unsigned char)name[j])))
+            {
+                i++;
+                j++;
+                continue;
+            }
+        }
+        if (star == n || star_pos >= len)
+            return 0;
+        i = star + 1;
+        j = ++star_pos;
+    }
+    return 1;
+}
+
+size_t glob_unescape(char *pattern, size_t len)
+{
+    size_t j = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (pattern[i] == '\\' && i + 1 < len)
+            i++;
+        pattern[j++] = pattern[i];
+    }
+    pattern[j] = '\0';
+    return j;
+}
+
+static void free_dir(struct glob_dir *dir)
+{
+    free(dir->path);
+    free(dir->names);
+    free(dir->entries);
+}
+
+/* Lecture par lots de getdents64 : noms dans un seul tampon, types tirés
+ * de d_type. Le contenu n'est pas trié : seuls les résultats le sont. */
+static int read_dir(struct glob_cache *cache, struct glob_dir *dir, int fd)
+{
+    struct strbuf names = { NULL, 0, 0 };
+    size_t capacity = 0;
+    long n;
+
+    dir->entries = NULL;
+    dir->count = 0;
+    while ((n = syscall(SYS_getdents64, fd, cache->buffer, GLOB_BATCH_SIZE)) > 0)
+    {
+        for (long pos = 0; pos < n;)
+        {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(cache->buffer + pos);
+            size_t len = strlen(d->d_name);
+
+            pos += d->d_reclen;
+            if (d->d_name[0] == '.' && (len == 1 || (len == 2 && d->d_name[1] == '.')))
+                continue;
+
+            if (dir->count == capacity)
+            {
+                capacity = capacity ? 2 * capacity : 64;
+                struct glob_entry *entries = realloc(dir->entries,
+                                                     sizeof(struct glob_entry) * capacity);
+                if (!entries)
+                {
+                    strbuf_free(&names);
+                    return -1;
+                }
+                dir->entries = entries;
+            }
+            dir->entries[dir->count++] = (struct glob_entry){ names.len, len, d->d_type };
+            if (strbuf_append(&names, d->d_name, len + 1) == -1)
+            {
+                strbuf_free(&names);
+                return -1;
+            }
+        }
+    }
+
+    dir->names = names.data;
+    return n < 0 ? -1 : 0;
+}
+
+/* Contenu du répertoire, dans l'ordre de readdir, relu seulement si sa date
+ * a changé ; les correspondances sont triées par l'appelant */
+static struct glob_dir *get_dir(struct glob_cache *cache, const char *path)
+{
+    struct stat st;
+    struct glob_dir *dir = NULL;
+
+    if (fstatat(cache->dir_fd, path, &st, 0) == -1 || !S_ISDIR(st.st_mode))
+        return NULL;
+
+    for (size_t i = 0; i < cache->count; i++)
+    {
+        if (strcmp(cache->dirs[i].path, path) == 0)
+        {
+            dir = &cache->dirs[i];
+            if (dir->mtime.tv_sec == st.st_mtim.tv_sec &&
+                dir->mtime.tv_nsec == st.st_mtim.tv_nsec)
+                return dir;
+            free(dir->names);
+            free(dir->entries);
+            break;
+        }
+    }
+
+    if (!dir)
+    {
+        if (cache->count == cache->capacity)
+        {
+            size_t capacity = cache->capacity ? 2 * cache->capacity : 8;
+            struct glob_dir *dirs = realloc(cache->dirs, sizeof(struct glob_dir) * capacity);
+            if (!dirs)
+                return NULL;
+            cache->dirs = dirs;
+            cache->capacity = capacity;
+        }
+        dir = &cache->dirs[cache->count];
+        dir->path = my_strdup(path);
+        if (!dir->path)
+            return NULL;
+        cache->count++;
+    }
+
+    if (!cache->buffer)
+        cache->buffer = malloc(GLOB_BATCH_SIZE);
+
+    int fd = openat(cache->dir_fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    dir->names = NULL;
+    dir->entries = NULL;
+    dir->count = 0;
+    dir->mtime.tv_sec = -1;
+    if (fd == -1 || !cache->buffer || fstat(fd, &st) == -1 || read_dir(cache, dir, fd) == -1)
+    {
+        if (fd != -1)
+            close(fd);
+        return dir;
+    }
+    close(fd);
+    dir->mtime = st.st_mtim;
+    return dir;
+}
+
+/* d_type suffit en général ; stat seulement pour un lien ou un type inconnu */
+static int is_directory(struct glob_cache *cache, const struct glob_entry *entry)
+{
+    struct stat st;
+
+    if (entry->type == DT_DIR)
+        return 1;
+    if (entry->type != DT_LNK && entry->type != DT_UNKNOWN)
+        return 0;
+    return fstatat(cache->dir_fd, cache->path.data, &st, 0) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void add_result(struct glob_cache *cache, const struct glob_pattern *pattern,
+                       struct strbuf *out, size_t *count)
+{
+    strbuf_append(out, cache->path.data, cache->path.len);
+    if (pattern->trailing_slash)
+        strbuf_putc(out, '/');
+    strbuf_putc(out, '\0');
+    (*count)++;
+}
+
+static void expand_segment(const struct glob_pattern *pattern, struct glob_cache *cache,
+                           size_t index, struct strbuf *out, size_t *count)
+{
+    const struct glob_matcher *seg = &pattern->segments[index];
+    int last = index + 1 == pattern->count;
+    size_t base = cache->path.len;
+
+    if (seg->literal)
+    {
+        const struct glob_op *op = &pattern->ops[seg->ops];
+        struct stat st;
+
+        strbuf_append(&cache->path, pattern->text + op->arg, op->len);
+        if (!last)
+        {
+            strbuf_putc(&cache->path, '/');
+            expand_segment(pattern, cache, index + 1, out, count);
+        }
+        else if (pattern->trailing_slash
+                 ? fstatat(cache->dir_fd, cache->path.data, &st, 0) == 0 && S_ISDIR(st.st_mode)
+                 : fstatat(cache->dir_fd, cache->path.data, &st, AT_SYMLINK_NOFOLLOW) == 0)
+            add_result(cache, pattern, out, count);
+        cache->path.len = base;
+        cache->path.data[base] = '\0';
+        return;
+    }
+
+    struct glob_dir *dir = get_dir(cache, base ? cache->path.data : ".");
+    if (!dir)
+        return;
+
+    /* Le tableau des répertoires peut être réalloué pendant la récursion */
+    const char *names = dir->names;
+    const struct glob_entry *entries = dir->entries;
+    size_t n = dir->count;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const char *name = names + entries[i].name;
+        if ((name[0] == '.' && !seg->dot) || !glob_match(pattern, seg, name, entries[i].len))
+            continue;
+
+        strbuf_append(&cache->path, name, entries[i].len);
+        if (!last || pattern->trailing_slash)
+        {
+            if (is_directory(cache, &entries[i]))
+            {
+                if (last)
+                    add_result(cache, pattern, out, count);
+                else
+                {
+                    strbuf_putc(&cache->path, '/');
+                    expand_segment(pattern, cache, index + 1, out, count);
+                }
+            }
+        }
+        else
+            add_result(cache, pattern, out, count);
+        cache->path.len = base;
+        cache->path.data[base] = '\0';
+    }
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* Tri des seuls résultats, en O(k log k) : un motif qui retient peu de noms
+ * d'un grand répertoire ne paie pas le tri du répertoire entier. */
+static void sort_results(struct glob_cache *cache, struct strbuf *out, size_t start,
+                         size_t count)
+{
+    if (count > cache->results_capacity)
+    {
+        const char **results = realloc(cache->results, sizeof(char *) * count);
+        if (!results)
+            return;
+        cache->results = results;
+        cache->results_capacity = count;
+    }
+
+    /* Place pour la copie triée, réservée avant de prendre des pointeurs */
+    size_t size = out->len - start;
+    if (strbuf_reserve(out, size) == -1)
+        return;
+
+    const char *p = out->data + start;
+    for (size_t i = 0; i < count; i++)
+    {
+        cache->results[i] = p;
+        p += strlen(p) + 1;
+    }
+    qsort(cache->results, count, sizeof(char *), compare_paths);
+
+    for (size_t i = 0; i < count; i++)
+        strbuf_append(out, cache->results[i], strlen(cache->results[i]) + 1);
+    memmove(out->data + start, out->data + start + size, size);
+    out->len = start + size;
+    out->data[out->len] = '\0';
+}
+
+size_t glob_expand(const struct glob_pattern *pattern, struct glob_cache *cache, int dir_fd,
+                   struct strbuf *out)
+{
+    size_t start = out->len;
+    size_t count = 0;
+
+    if (pattern->count == 0)
+        return 0;
+
+    cache->dir_fd = dir_fd;
+    strbuf_reset(&cache->path);
+    if (strbuf_reserve(&cache->path, 1) == -1)
+        return 0;
+    cache->path.data[0] = '\0';
+    if (pattern->absolute)
+        strbuf_putc(&cache->path, '/');
+
+    expand_segment(pattern, cache, 0, out, &count);
+    if (count > 1)
+        sort_results(cache, out, start, count);
+    return count;
+}
+
+void glob_cache_clear(struct glob_cache *cache)
+{
+    if (!cache)
+        return;
+    for (size_t i = 0; i < cache->count; i++)
+        free_dir(&cache->dirs[i]);
+    cache->count = 0;
+}
+
+void glob_cache_free(struct glob_cache *cache)
+{
+    if (!cache)
+        return;
+    glob_cache_clear(cache);
+    free(cache->dirs);
+    free(cache->buffer);
+    free(cache->results);
+    strbuf_free(&cache->path);
+    free(cache);
+}
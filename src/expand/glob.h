@@ -0,0 +1,91 @@
+#ifndef GLOB_H
+#define GLOB_H
+
+#include "../all.h"
+#include "../string_utils.h"
+#include <stdint.h>
+#include <sys/stat.h>
+
+/* Motif compilé : une suite d'opérations par composant du chemin. Dans le
+ * texte du motif, un '\' rend littéral le caractère qui le suit. */
+enum glob_op_type {
+    GLOB_CHARS,         /* suite de caractères littéraux */
+    GLOB_ANY,           /* ? */
+    GLOB_STAR,          /* * */
+    GLOB_CLASS          /* [...] */
+};
+
+struct glob_op {
+    unsigned char type;
+    size_t arg;         /* texte littéral ou indice de la classe */
+    size_t len;
+};
+
+struct glob_matcher {
+    size_t ops;         /* première opération dans le tableau du motif */
+    size_t count;
+    int literal;        /* une seule suite littérale : comparaison directe */
+    int dot;            /* commence par un '.' littéral : noms cachés admis */
+};
+
+struct glob_pattern {
+    int absolute;
+    int trailing_slash;             /* motif en '/' : répertoires seulement */
+    size_t count;                   /* composants */
+    struct glob_matcher *segments;
+    struct glob_op *ops;
+    unsigned char (*classes)[32];   /* bitmaps des classes */
+    const char *text;               /* littéraux, sans échappements */
+};
+
+/* Contenu d'un répertoire lu une fois et gardé tant que sa date de
+ * modification ne change pas. */
+struct glob_entry {
+    size_t name;        /* position dans names */
+    size_t len;
+    unsigned char type; /* d_type */
+};
+
+struct glob_dir {
+    char *path;
+    struct timespec mtime;
+    char *names;
+    struct glob_entry *entries;
+    size_t count;
+};
+
+/* Cache des répertoires lus pendant une liste de commandes */
+struct glob_cache {
+    struct glob_dir *dirs;
+    size_t count;
+    size_t capacity;
+    char *buffer;               /* lot de getdents64 */
+    const char **results;       /* tri des résultats */
+    size_t results_capacity;
+    struct strbuf path;
+    int dir_fd;                 /* base des chemins relatifs, le temps d'un appel */
+};
+
+/* Compile un motif en une seule allocation, libérée par free() */
+struct glob_pattern *glob_compile(const char *pattern, size_t len);
+
+/* Motif d'un mot (case) : un seul matcher, '/' et '.' initial ordinaires */
+struct glob_pattern *glob_compile_word(const char *pattern, size_t len);
+
+/* Compare un nom à un composant compilé */
+int glob_match(const struct glob_pattern *pattern, const struct glob_matcher *matcher,
+               const char *name, size_t len);
+
+/* Ajoute à out les chemins correspondant au motif, triés et terminés chacun
+ * par '\0'. Un motif relatif part de dir_fd (AT_FDCWD : répertoire courant).
+ * Renvoie le nombre de chemins. */
+size_t glob_expand(const struct glob_pattern *pattern, struct glob_cache *cache, int dir_fd,
+                   struct strbuf *out);
+
+/* Retire les échappements d'un motif sur place ; renvoie la nouvelle longueur */
+size_t glob_unescape(char *pattern, size_t len);
+
+void glob_cache_clear(struct glob_cache *cache);
+void glob_cache_free(struct glob_cache *cache);
+
+#endif /* GLOB_H */
@@ -5,7 +5,7 @@
 
 static char lexer_peek(struct lexer *lexer)
 {
-    if (lexer->position >= strlen(lexer->input))
+    if (lexer->position >= lexer->length)
         return '\0';
     return lexer->input[lexer->position];
 }
@@ -34,9 +34,37 @@ static struct token *create_token(enum token_type type, char *value)
     
     token->type = type;
     token->value = value;
+    token->flags = 0;
+    token->keyword = KW_NONE;
     return token;
 }
 
+static const struct {
+    const char *word;
+    enum keyword keyword;
+} keywords[] = {
+    { "if", KW_IF }, { "then", KW_THEN }, { "elif", KW_ELIF }, { "else", KW_ELSE },
+    { "fi", KW_FI }, { "while", KW_WHILE }, { "until", KW_UNTIL }, { "for", KW_FOR },
+    { "in", KW_IN }, { "do", KW_DO }, { "done", KW_DONE }, { "case", KW_CASE },
+    { "esac", KW_ESAC }, { "{", KW_LBRACE }, { "}", KW_RBRACE }, { "!", KW_BANG },
+    { "time", KW_TIME },
+};
+
+/* Aucun mot réservé ne dépasse 5 caractères : les mots plus longs ne
+ * parcourent pas la table. */
+static enum keyword lookup_keyword(const char *word, size_t length)
+{
+    if (length > 5)
+        return KW_NONE;
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++)
+    {
+        if (keywords[i].word[0] == word[0] && strlen(keywords[i].word) == length &&
+            memcmp(keywords[i].word, word, length) == 0)
+            return keywords[i].keyword;
+    }
+    return KW_NONE;
+}
+
 static size_t copy_str(char *dest, const char *src, size_t n)
 {
     size_t i;
@@ -60,38 +88,307 @@ static char *read_word_value(struct lexer *lexer, size_t start_pos, size_t lengt
     return create_str_copy(lexer->input + start_pos, length);
 }
 
+static int is_name_char(char c)
+{
+    return (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') ||
+           c == '_';
+}
+
+static enum token_type classify_word(const char *word, size_t length, char next)
+{
+    size_t i = 0;
+
+    while (i < length && word[i] >= '0' && word[i] <= '9')
+        i++;
+    if (i == length && (next == '<' || next == '>'))
+        return TOKEN_IONUMBER;
+
+    if (length == 0 || (word[0] >= '0' && word[0] <= '9'))
+        return TOKEN_WORD;
+    for (i = 0; i < length && is_name_char(word[i]); i++)
+        continue;
+    if (i > 0 && i < length && word[i] == '=')
+        return TOKEN_ASSIGNMENT_WORD;
+    return TOKEN_WORD;
+}
+
+static int scan_until_quote(const char *input, size_t length, size_t *pos, char quote,
+                            int *flags)
+{
+    size_t i = *pos + 1;
+
+    while (i < length && input[i] != quote)
+    {
+        if (quote == '"' && input[i] == '\\')
+            i += 2;
+        else if (quote == '"' && input[i] == '$')
+        {
+            *flags |= WORD_DOLLAR;
+            if (lexer_scan_quoted(input, length, &i, flags) == -1)
+                return -1;
+        }
+        else
+            i++;
+    }
+    if (i >= length)
+        return -1;
+    *pos = i + 1;
+    return 0;
+}
+
+/* Mots réservés après lesquels le mot suivant est en position de commande */
+static int is_command_prefix(const char *word, size_t length)
+{
+    static const char *const prefixes[] = {
+        "if", "then", "elif", "else", "while", "until", "do", "!", "{", "time"
+    };
+
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++)
+    {
+        if (strlen(prefixes[i]) == length && strncmp(prefixes[i], word, length) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+#define SCAN_CASE_MAX 32
+
+/* Dans $(...) et <(...), le ')' d'un motif de case ne ferme rien : chaque
+ * case ouvert retient la profondeur où ses motifs se terminent, jusqu'à son
+ * esac. Les mots case et esac ne comptent qu'en position de commande. */
+static int scan_until_close(const char *input, size_t length, size_t *pos, char open,
+                            char close, int *flags)
+{
+    size_t i = *pos + 2;
+    int depth = 1;
+    int cases[SCAN_CASE_MAX];
+    int case_count = 0;
+    int command = 1;        /* le prochain mot est en position de commande */
+    int after_in = 0;       /* esac peut suivre directement le in d'un case */
+
+    while (i < length)
+    {
+        char c = input[i];
+
+        if (c == '\\')
+        {
+            i += 2;
+            command = 0;
+        }
+        else if (c == '\'' || c == '"' || c == '$')
+        {
+            if (lexer_scan_quoted(input, length, &i, flags) == -1)
+                return -1;
+            command = 0;
+        }
+        else if (open == '(' && is_word_char(c))
+        {
+            const char *word = input + i;
+            size_t len = 0;
+
+            while (i < length && is_word_char(input[i]))
+            {
+                i++;
+                len++;
+            }
+            if (command && len == 4 && strncmp(word, "case", 4) == 0 &&
+                case_count < SCAN_CASE_MAX)
+            {
+                cases[case_count++] = depth;
+                command = 0;
+            }
+            else if ((command || after_in) && case_count > 0 && len == 4 &&
+                     strncmp(word, "esac", 4) == 0)
+            {
+                case_count--;
+                command = 0;
+            }
+            else
+                command = is_command_prefix(word, len);
+            after_in = len == 2 && strncmp(word, "in", 2) == 0;
+        }
+        else
+        {
+            if (c == open)
+            {
+                depth++;
+                command = 1;
+            }
+            else if (c == close && case_count > 0 && cases[case_count - 1] == depth)
+                command = 1;
+            else if (c == close && --depth == 0)
+            {
+                *pos = i + 1;
+                return 0;
+            }
+            else if (c == close)
+                command = 0;
+            else if (c == ';' || c == '&' || c == '|' || c == '\n')
+                command = 1;
+            else if (!is_whitespace(c))
+                command = 0;
+            i++;
+        }
+    }
+    return -1;
+}
+
+/* Saute la construction qui commence en *pos : '...', "...", $(...), ${...},
+ * un paramètre spécial ($?, $$...), un simple '$', ou <(...) et >(...). Renvoie -1 si elle n'est
+ * pas refermée avant la fin de l'entrée. Utilisé par le lexer pour délimiter
+ * les mots et par l'expansion pour retrouver la fin d'une substitution. */
+int lexer_scan_quoted(const char *input, size_t length, size_t *pos, int *flags)
+{
+    char c = input[*pos];
+
+    if (c == '\'' || c == '"')
+    {
+        *flags |= WORD_QUOTED;
+        return scan_until_quote(input, length, pos, c, flags);
+    }
+    if (c == '$')
+    {
+        *flags |= WORD_DOLLAR;
+        if (*pos + 1 < length && input[*pos + 1] == '(')
+            return scan_until_close(input, length, pos, '(', ')', flags);
+        if (*pos + 1 < length && input[*pos + 1] == '{')
+            return scan_until_close(input, length, pos, '{', '}', flags);
+        /* Paramètres spéciaux : $? $$ $! $# $@ $* $- */
+        if (*pos + 1 < length && strchr("?$!#@*-", input[*pos + 1]))
+            (*pos)++;
+    }
+    if ((c == '<' || c == '>') && *pos + 1 < length && input[*pos + 1] == '(')
+    {
+        *flags |= WORD_PROCESS;
+        return scan_until_close(input, length, pos, '(', ')', flags);
+    }
+    (*pos)++;
+    return 0;
+}
+
+static int is_word_start(char c, char next)
+{
+    return is_word_char(c) || c == '\'' || c == '"' || c == '\\' || c == '$' ||
+           ((c == '<' || c == '>') && next == '(');
+}
+
+/* Délimite un mot : caractères de mot, quotes, échappements et constructions
+ * en '$', plus une substitution de processus en tête du mot. Renvoie -1 si
+ * une quote ou une substitution reste ouverte. */
+static int scan_word(struct lexer *lexer, int *flags)
+{
+    size_t pos = lexer->position;
+    int ret = 0;
+
+    while (pos < lexer->length)
+    {
+        char c = lexer->input[pos];
+
+        if (c == '\\')
+        {
+            *flags |= WORD_QUOTED;
+            pos = pos + 2 < lexer->length ? pos + 2 : lexer->length;
+        }
+        else if (c == '\'' || c == '"' || c == '$' ||
+                 (pos == lexer->position && (c == '<' || c == '>')))
+        {
+            if (lexer_scan_quoted(lexer->input, lexer->length, &pos, flags) == -1)
+            {
+                pos = lexer->length;
+                ret = -1;
+            }
+        }
+        else if (is_word_char(c) || c == '#')
+        {
+            if (c == '*' || c == '?' || c == '[')
+                *flags |= WORD_GLOB;
+            pos++;
+        }
+        else
+            break;
+    }
+
+    while (lexer->position < pos)
+        lexer_advance(lexer);
+    return ret;
+}
+
 struct token *lexer_next_token(struct lexer *lexer)
 {
     char c = lexer_peek(lexer);
-    size_t start_pos = lexer->position;
     
     while (is_whitespace(c))
     {
         lexer_advance(lexer);
         c = lexer_peek(lexer);
     }
+
+    /* Un '#' en début de mot commence un commentaire jusqu'à la fin de ligne */
+    if (c == '#')
+    {
+        while (c != '\n' && c != '\0')
+        {
+            lexer_advance(lexer);
+            c = lexer_peek(lexer);
+        }
+    }
     
+    size_t start_pos = lexer->position;
+
     if (c == '\0')
         return create_token(TOKEN_EOF, NULL);
+    lexer->tokens++;
+
+    if (c == '\n')
+    {
+        lexer_advance(lexer);
+        return create_token(TOKEN_NEWLINE, NULL);
+    }
     
-    if (is_word_char(c))
+    if (is_word_start(c, lexer->position + 1 < lexer->length ?
+                         lexer->input[lexer->position + 1] : '\0'))
     {
-        while (is_word_char(lexer_peek(lexer)))
-            lexer_advance(lexer);
+        int flags = 0;
+        if (scan_word(lexer, &flags) == -1)
+        {
+            lexer->incomplete = 1;
+            return create_token(TOKEN_ERROR, NULL);
+        }
             
         size_t length = lexer->position - start_pos;
         char *value = read_word_value(lexer, start_pos, length);
-        return create_token(TOKEN_WORD, value);
+        enum token_type type = classify_word(lexer->input + start_pos, length,
+                                             lexer_peek(lexer));
+        struct token *token = create_token(type, value);
+        if (token)
+        {
+            token->flags = flags;
+            if (type == TOKEN_WORD && flags == 0)
+                token->keyword = lookup_keyword(lexer->input + start_pos, length);
+        }
+        return token;
     }
     
     if (is_operator_char(c))
     {
-        char next = lexer_peek(lexer);
         lexer_advance(lexer);
+        char next = lexer_peek(lexer);
         
+        if (c == '<' && next == '<')
+        {
+            lexer_advance(lexer);
+            int strip_tabs = lexer_peek(lexer) == '-';
+            if (strip_tabs)
+                lexer_advance(lexer);
+            return create_token(TOKEN_OPERATOR, create_str_copy("<<-", strip_tabs ? 3 : 2));
+        }
+
         if ((c == '>' && next == '>') ||
             (c == '&' && next == '&') ||
-            (c == '|' && next == '|'))
+            (c == '|' && next == '|') ||
+            (c == ';' && next == ';'))
         {
             lexer_advance(lexer);
             char *value = malloc(3);
@@ -115,19 +412,91 @@ struct token *lexer_next_token(struct lexer *lexer)
     return create_token(TOKEN_ERROR, NULL);
 }
 
+/* Lit le corps d'un here-document : les lignes qui suivent la position
+ * courante jusqu'à celle qui vaut exactement le délimiteur. Renvoie 1 si
+ * l'entrée se termine avant le délimiteur (le corps contient alors tout le
+ * reste), 0 sinon. */
+int lexer_read_heredoc(struct lexer *lexer, const char *delimiter, int strip_tabs,
+                       char **body, size_t *body_len)
+{
+    size_t delimiter_len = strlen(delimiter);
+    size_t start = lexer->position;
+    size_t pos = start;
+    size_t body_end = lexer->length;
+    int missing = 1;
+
+    while (pos < lexer->length)
+    {
+        size_t line_start = pos;
+        size_t line = pos;
+        const char *eol = memchr(lexer->input + pos, '\n', lexer->length - pos);
+        size_t end = eol ? (size_t)(eol - lexer->input) : lexer->length;
+
+        if (strip_tabs)
+        {
+            while (line < end && lexer->input[line] == '\t')
+                line++;
+        }
+        pos = eol ? end + 1 : end;
+        lexer->line++;
+
+        if (end - line == delimiter_len &&
+            memcmp(lexer->input + line, delimiter, delimiter_len) == 0)
+        {
+            body_end = line_start;
+            missing = 0;
+            break;
+        }
+    }
+    lexer->position = pos;
+    lexer->column = 1;
+
+    char *value = malloc(body_end - start + 1);
+    if (!value)
+        return -1;
+
+    size_t len = 0;
+    for (size_t i = start; i < body_end; )
+    {
+        const char *eol = memchr(lexer->input + i, '\n', body_end - i);
+        size_t end = eol ? (size_t)(eol - lexer->input) + 1 : body_end;
+
+        if (strip_tabs)
+        {
+            while (i < end && lexer->input[i] == '\t')
+                i++;
+        }
+        memcpy(value + len, lexer->input + i, end - i);
+        len += end - i;
+        i = end;
+    }
+    value[len] = '\0';
+
+    *body = value;
+    *body_len = len;
+    return missing;
+}
+
 struct lexer *lexer_init(char *input)
 {
     struct lexer *lexer = malloc(sizeof(struct lexer));
     if (!lexer)
         return NULL;
-        
+
+    lexer_reset(lexer, input);
+    return lexer;
+}
+
+void lexer_reset(struct lexer *lexer, char *input)
+{
     lexer->input = input;
+    lexer->length = strlen(input);
     lexer->position = 0;
     lexer->line = 1;
     lexer->column = 1;
     lexer->has_error = 0;
-    
-    return lexer;
+    lexer->incomplete = 0;
+    lexer->tokens = 0;
 }
 
 void lexer_free(struct lexer *lexer)
@@ -150,16 +519,20 @@ int is_word_char(char c)
     return (c >= 'a' && c <= 'z') || 
            (c >= 'A' && c <= 'Z') || 
            (c >= '0' && c <= '9') || 
-           c == '_' || c == '-' || c == '.';
+           c == '_' || c == '-' || c == '.' || c == '/' ||
+           c == '=' || c == ':' || c == '+' || c == ',' ||
+           c == '@' || c == '%' || c == '~' || c == '^' ||
+           c == '[' || c == ']' || c == '*' || c == '?' || c == '!' ||
+           c == '{' || c == '}';
 }
 
 int is_operator_char(char c)
 {
     return c == '|' || c == '>' || c == '<' || 
-           c == '&' || c == ';';
+           c == '&' || c == ';' || c == '(' || c == ')';
 }
 
 int is_whitespace(char c)
 {
-    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    return c == ' ' || c == '\t' || c == '\r';
 }
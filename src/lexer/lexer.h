@@ -8,30 +8,75 @@ enum token_type {
     TOKEN_ASSIGNMENT_WORD,
     TOKEN_IONUMBER,
     TOKEN_OPERATOR,
+    TOKEN_NEWLINE,
     TOKEN_EOF,
     TOKEN_ERROR
 };
 
+/* Propriétés d'un mot relevées une fois pour toutes par le lexer : un mot
+ * sans aucune d'elles est utilisé tel quel, sans passer par l'expansion. */
+#define WORD_QUOTED 0x1 /* quotes ou backslash à retirer */
+#define WORD_DOLLAR 0x2 /* contient un '$' */
+#define WORD_GLOB 0x4   /* contient un '*', '?' ou '[' hors quotes */
+#define WORD_PROCESS 0x20 /* commence par <(...) ou >(...) : substitution de processus */
+
+/* Posés par le parser sur les mots d'un case */
+#define WORD_SINGLE 0x8  /* un seul champ : ni découpage ni développement de chemins */
+#define WORD_PATTERN 0x10 /* motif : les caractères quotés restent échappés */
+
+/* Mots réservés : reconnus par le lexer pour tout mot non quoté, ils ne sont
+ * traités comme tels par le parser qu'en position de début de commande. */
+enum keyword {
+    KW_NONE,
+    KW_IF,
+    KW_THEN,
+    KW_ELIF,
+    KW_ELSE,
+    KW_FI,
+    KW_WHILE,
+    KW_UNTIL,
+    KW_FOR,
+    KW_IN,
+    KW_DO,
+    KW_DONE,
+    KW_CASE,
+    KW_ESAC,
+    KW_LBRACE,
+    KW_RBRACE,
+    KW_BANG,
+    KW_TIME
+};
+
 struct token {
     enum token_type type;
     char *value;
+    int flags;
+    enum keyword keyword;
     size_t line;
     size_t column;
 };
 
 struct lexer {
     char *input;
+    size_t length;
     size_t position;
     size_t line;
     size_t column;
     int has_error;
+    int incomplete;     /* quote ou $( ) non refermé en fin d'entrée */
+    size_t tokens;      /* tokens produits, pour le builtin stats */
 };
 
 struct token *token_create(enum token_type type, char *value);
 void token_free(struct token *token);
 struct lexer *lexer_init(char *input);
+/* Réutilise un lexer sur une nouvelle entrée, sans allocation */
+void lexer_reset(struct lexer *lexer, char *input);
 void lexer_free(struct lexer *lexer);
 struct token *lexer_next_token(struct lexer *lexer);
+int lexer_scan_quoted(const char *input, size_t length, size_t *pos, int *flags);
+int lexer_read_heredoc(struct lexer *lexer, const char *delimiter, int strip_tabs,
+                       char **body, size_t *body_len);
 
 int is_word_char(char c);
 int is_operator_char(char c);
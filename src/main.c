@@ -1,88 +1,243 @@
 #include "all.h"
+#include <poll.h>
 #include "lexer/lexer.h"
 #include "parser/parser.h"
 #include "exec/exec.h"
+#include "exec/trace.h"
+#include "exec/profile.h"
+#include "exec/input.h"
+#include "exec/server.h"
+#include "expand/glob.h"
+#include "string_utils.h"
 
-static void process_input(const char *input, struct exec_state *state)
+/* Lecture d'un script : blocs assez gros pour qu'un script de plusieurs
+ * dizaines de Mo se lise en quelques centaines d'appels */
+#define INPUT_BLOCK_SIZE (256 * 1024)
+
+/* Entrée interactive : ligne par ligne, chaque commande s'exécute dès
+ * que sa ligne est tapée. */
+static void process_stream(FILE *stream, struct exec_state *state)
 {
-    struct lexer *lexer = lexer_init(strdup(input));
-    if (!lexer)
-        return;
+    struct strbuf input = { NULL, 0, 0 };
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t n;
 
-    struct parser *parser = parser_init(lexer);
-    if (!parser)
+    while (!state->should_exit && (n = getline(&line, &line_capacity, stream)) != -1)
     {
-        lexer_free(lexer);
-        return;
-    }
+        if (strbuf_append(&input, line, n) == -1)
+            break;
 
-    struct ast_node *ast = parse_input(parser);
-    if (ast)
-    {
-        exec_ast(ast, state);
-        ast_node_free(ast);
+        size_t consumed = input_process(input.data, 0, state);
+        memmove(input.data, input.data + consumed, input.len - consumed + 1);
+        input.len -= consumed;
     }
 
-    parser_free(parser);
-    lexer_free(lexer);
+    if (!state->should_exit && input.len > 0)
+        input_process(input.data, 1, state);
+
+    free(line);
+    strbuf_free(&input);
 }
 
-static int process_file(const char *filename)
+/* Vrai si la suite de l'entrée est déjà lisible (toujours le cas d'un
+ * fichier), faux si l'écrivain du pipe fait une pause */
+static int input_ready(int fd)
 {
-    FILE *file = fopen(filename, "r");
-    if (!file)
-    {
-        fprintf(stderr, "minishell: %s: No such file or directory\n", filename);
-        return 1;
-    }
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    return poll(&pfd, 1, 0) == 1;
+}
 
-    char buffer[BUFFER_SIZE];
-    struct exec_state *state = exec_init(environ);
-    
-    while (fgets(buffer, sizeof(buffer), file))
-    {
-        size_t len = strlen(buffer);
-        if (len > 0 && buffer[len - 1] == '\n')
-            buffer[len - 1] = '\0';
+/* Entrée non interactive (script, pipe) : lue par gros blocs. Seules les
+ * lignes complètes sont analysées, la fin d'une ligne coupée attend le bloc
+ * suivant. Tant que la suite arrive, une commande incomplète n'est
+ * réanalysée qu'une fois le tampon doublé : une longue boucle ou un long
+ * here-document reste linéaire. Quand l'écrivain s'arrête, ce qui est
+ * arrivé est réanalysé aussitôt : un "fi" envoyé plus tard termine sa
+ * commande sans attendre la suite. */
+static void process_fd(int fd, struct exec_state *state)
+{
+    struct strbuf input = { NULL, 0, 0 };
+    size_t retry_len = 0;
 
-        process_input(buffer, state);
+    while (!state->should_exit)
+    {
+        if (strbuf_reserve(&input, INPUT_BLOCK_SIZE) == -1)
+            break;
 
-        if (state->should_exit)
+        ssize_t n = read(fd, input.data + input.len, INPUT_BLOCK_SIZE);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
             break;
+        input.len += n;
+        input.data[input.len] = '\0';
+
+        char *last_newline = input.len < retry_len && input_ready(fd) ? NULL
+            : memrchr(input.data, '\n', input.len);
+        if (!last_newline)
+            continue;
+
+        size_t complete = last_newline - input.data + 1;
+        char next = input.data[complete];
+        input.data[complete] = '\0';
+        size_t consumed = input_process(input.data, 0, state);
+        input.data[complete] = next;
+
+        memmove(input.data, input.data + consumed, input.len - consumed + 1);
+        input.len -= consumed;
+        retry_len = consumed < complete ? 2 * input.len : 0;
     }
 
-    int exit_code = state->exit_code;
+    if (!state->should_exit && input.len > 0)
+        input_process(input.data, 1, state);
+
+    strbuf_free(&input);
+}
+
+/* $0 et les paramètres positionnels du shell */
+static void set_arguments(struct exec_state *state, char *name, char **args, int count)
+{
+    state->name = name;
+    state->toplevel.params = args;
+    state->toplevel.count = count;
+}
+
+/* MINISHELL_STATS=1 (ou json) : compteurs du builtin stats sur la sortie
+ * d'erreur à la sortie du shell */
+static void dump_stats(struct exec_state *state)
+{
+    const char *mode = getenv("MINISHELL_STATS");
+    struct strbuf out = { NULL, 0, 0 };
+
+    if (!mode || !*mode)
+        return;
+    if (stats_format(&state->stats, strcmp(mode, "json") == 0, &out) == 0)
+        write(STDERR_FILENO, out.data, out.len);
+    strbuf_free(&out);
+}
+
+static int finish(struct exec_state *state)
+{
+    int exit_code = state->should_exit ? state->exit_code : state->last_return;
+    profile_finish(state->profile, stderr);
+    state->profile = NULL;
+    dump_stats(state);
+    trace_finish();
     exec_free(state);
-    fclose(file);
     return exit_code;
 }
 
-static int interactive_mode(void)
+int main(int argc, char *argv[])
 {
-    char buffer[BUFFER_SIZE];
     struct exec_state *state = exec_init(environ);
-    
-    while (!state->should_exit)
+    if (!state)
+        return 1;
+
+    /* Options longues, avant -c ou le nom du script */
+    const char *trace_path = getenv("MINISHELL_TRACE");
+    const char *folded_path = NULL;
+    const char *server_path = NULL;
+    int profile = 0;
+    int arg = 1;
+    while (arg < argc && strncmp(argv[arg], "--", 2) == 0)
     {
-        if (!fgets(buffer, sizeof(buffer), stdin))
+        const char *option = argv[arg++];
+        int takes_value = strcmp(option, "--trace") == 0 ||
+                          strcmp(option, "--profile-folded") == 0 ||
+                          strcmp(option, "--server") == 0;
+
+        if (strcmp(option, "--") == 0)
             break;
+        if (takes_value && arg == argc)
+        {
+            fprintf(stderr, "minishell: %s: option requires an argument\n", option);
+            exec_free(state);
+            return 2;
+        }
+        if (strcmp(option, "--trace") == 0)
+            trace_path = argv[arg++];
+        else if (strcmp(option, "--profile-folded") == 0)
+        {
+            folded_path = argv[arg++];
+            profile = 1;
+        }
+        else if (strcmp(option, "--profile") == 0)
+            profile = 1;
+        else if (strcmp(option, "--server") == 0)
+            server_path = argv[arg++];
+        else
+        {
+            fprintf(stderr, "minishell: %s: invalid option\n", option);
+            exec_free(state);
+            return 2;
+        }
+    }
+    argv += arg - 1;
+    argc -= arg - 1;
 
-        size_t len = strlen(buffer);
-        if (len > 0 && buffer[len - 1] == '\n')
-            buffer[len - 1] = '\0';
+    if (trace_path && *trace_path && trace_start(trace_path, 0) == -1)
+        perror("minishell: trace");
+    if (profile && !(state->profile = profile_new(folded_path)))
+        perror("minishell: profile");
 
-        process_input(buffer, state);
+    /* --server SOCKET [SCRIPT] : le script prépare le shell (fonctions,
+     * variables) avant que les requêtes soient servies */
+    if (server_path)
+    {
+        if (argc > 1)
+        {
+            int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+            {
+                fprintf(stderr, "minishell: %s: No such file or directory\n", argv[1]);
+                exec_free(state);
+                return 127;
+            }
+            set_arguments(state, argv[1], argv + 2, argc - 2);
+            process_fd(fd, state);
+            close(fd);
+        }
+        int ret = server_run(server_path, state);
+        finish(state);
+        return ret;
     }
 
-    int exit_code = state->exit_code;
-    exec_free(state);
-    return exit_code;
-}
+    if (argc > 1 && strcmp(argv[1], "-c") == 0)
+    {
+        if (argc < 3)
+        {
+            fprintf(stderr, "minishell: -c: option requires an argument\n");
+            exec_free(state);
+            return 2;
+        }
+        if (argc > 3)
+            set_arguments(state, argv[3], argv + 4, argc - 4);
+
+        char *command = strdup(argv[2]);
+        if (command)
+            input_process(command, 1, state);
+        free(command);
+        return finish(state);
+    }
 
-int main(int argc, char *argv[])
-{
     if (argc > 1)
-        return process_file(argv[1]);
+    {
+        int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            fprintf(stderr, "minishell: %s: No such file or directory\n", argv[1]);
+            exec_free(state);
+            return 127;
+        }
+        set_arguments(state, argv[1], argv + 2, argc - 2);
+        process_fd(fd, state);
+        close(fd);
+    }
+    else if (isatty(STDIN_FILENO))
+        process_stream(stdin, state);
     else
-        return interactive_mode();
+        process_fd(STDIN_FILENO, state);
+
+    return finish(state);
 }
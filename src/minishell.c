@@ -0,0 +1,96 @@
+#include "minishell.h"
+#include "all.h"
+#include "exec/exec.h"
+#include "exec/input.h"
+#include "exec/vars.h"
+#include "string_utils.h"
+
+struct minishell {
+    struct exec_state *state;
+    struct strbuf script;   /* copie modifiable du script en cours */
+    struct strbuf out;      /* captures, gardées d'un appel à l'autre */
+    struct strbuf err;
+};
+
+struct minishell *minishell_new(char **env)
+{
+    struct minishell *shell = calloc(1, sizeof(struct minishell));
+    if (!shell)
+        return NULL;
+
+    /* L'environnement est copié tout de suite dans la table des variables
+     * et le répertoire courant pris en fd : l'hôte peut ensuite changer les
+     * siens sans toucher au shell, et plusieurs shells tourner en parallèle */
+    shell->state = exec_init(env ? env : environ);
+    if (!shell->state || vars_load(shell->state->vars) == -1 ||
+        exec_own_cwd(shell->state) == -1)
+    {
+        exec_free(shell->state);
+        free(shell);
+        return NULL;
+    }
+    return shell;
+}
+
+static void copy_capture(struct minishell_buffer *buffer, const struct strbuf *capture)
+{
+    buffer->length = capture->len;
+    if (!buffer->data || buffer->size == 0)
+        return;
+
+    size_t len = capture->len < buffer->size ? capture->len : buffer->size - 1;
+    if (len > 0)
+        memcpy(buffer->data, capture->data, len);
+    buffer->data[len] = '\0';
+}
+
+int minishell_run(struct minishell *shell, const char *script,
+                  struct minishell_buffer *out, struct minishell_buffer *err)
+{
+    struct exec_state *state = shell->state;
+
+    shell->script.len = 0;
+    strbuf_reset(&shell->out);
+    strbuf_reset(&shell->err);
+    if (strbuf_append(&shell->script, script, strlen(script)) == -1)
+        return state->last_return = 1;
+
+    /* Chaque script est numéroté à partir de sa première ligne */
+    state->input_line = 1;
+    state->capture = out ? &shell->out : NULL;
+    state->capture_err = err ? &shell->err : NULL;
+    state->fds[1] = out ? -1 : STDOUT_FILENO;
+    state->fds[2] = err ? -1 : STDERR_FILENO;
+    input_process(shell->script.data, 1, state);
+    state->capture = NULL;
+    state->capture_err = NULL;
+    state->fds[1] = STDOUT_FILENO;
+    state->fds[2] = STDERR_FILENO;
+
+    if (state->should_exit)
+    {
+        state->last_return = state->exit_code;
+        state->should_exit = 0;
+    }
+    if (out)
+        copy_capture(out, &shell->out);
+    if (err)
+        copy_capture(err, &shell->err);
+    return state->last_return;
+}
+
+int minishell_status(const struct minishell *shell)
+{
+    return shell->state->last_return;
+}
+
+void minishell_free(struct minishell *shell)
+{
+    if (!shell)
+        return;
+    exec_free(shell->state);
+    strbuf_free(&shell->script);
+    strbuf_free(&shell->out);
+    strbuf_free(&shell->err);
+    free(shell);
+}
@@ -0,0 +1,46 @@
+#ifndef MINISHELL_H
+#define MINISHELL_H
+
+#include <stddef.h>
+
+/* libminishell : le lexer, le parser et l'exécuteur du shell, utilisables
+ * sans lancer de processus. Seul cet en-tête est public ; les structures
+ * internes peuvent changer sans que MINISHELL_API_VERSION ne change.
+ *
+ * Un shell garde son état d'un appel à l'autre (variables, fonctions,
+ * répertoire courant, cache des lignes analysées). Son environnement et son
+ * répertoire courant sont à lui : cd ne change pas celui du processus, et
+ * des shells distincts peuvent tourner en même temps dans des threads
+ * différents. Un même shell ne sert qu'à un thread à la fois. */
+#define MINISHELL_API_VERSION 1
+
+struct minishell;
+
+/* Tampon fourni par l'appelant. Après minishell_run, data contient au plus
+ * size - 1 octets de la sortie suivis d'un '\0', et length la longueur
+ * complète de la sortie : length >= size signale une troncature, comme
+ * pour snprintf. */
+struct minishell_buffer {
+    char *data;
+    size_t size;
+    size_t length;
+};
+
+/* NULL si la mémoire manque. env sert d'environnement initial (environ
+ * si NULL). */
+struct minishell *minishell_new(char **env);
+
+/* Exécute script en entier et renvoie son code de sortie. Avec out ou err
+ * non NULL, la sortie (resp. les erreurs) des builtins est capturée en
+ * mémoire, sans pipe ni fork ; les commandes externes et les étages forkés
+ * d'un pipeline écrivent toujours sur les fds 1 et 2 du processus. Un exit
+ * du script termine l'appel, pas le shell. */
+int minishell_run(struct minishell *shell, const char *script,
+                  struct minishell_buffer *out, struct minishell_buffer *err);
+
+/* Code de sortie de la dernière commande exécutée ($?) */
+int minishell_status(const struct minishell *shell);
+
+void minishell_free(struct minishell *shell);
+
+#endif /* MINISHELL_H */
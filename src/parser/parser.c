@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "parser.h"
+#include "../expand/case.h"
 
 // Ajoutez cette fonction d'utilitaire pour éviter les problèmes de strdup
 static char *safe_strdup(const char *str)
@@ -17,16 +18,66 @@ struct parser *parser_init(struct lexer *lexer)
         return NULL;
     
     parser->lexer = lexer;
-    parser->current_token = lexer_next_token(lexer);
-    parser->has_error = 0;
-    
+    parser->current_token = NULL;
+    parser->heredocs = NULL;
+    parser->heredocs_capacity = 0;
+    parser_reset(parser);
     return parser;
 }
 
+void parser_reset(struct parser *parser)
+{
+    token_free(parser->current_token);
+    parser->current_token = lexer_next_token(parser->lexer);
+    parser->has_error = 0;
+    parser->incomplete = 0;
+    parser->heredocs_count = 0;
+    parser->nodes = 0;
+}
+
+/* Les corps des here-documents commencent juste après la fin de la ligne qui
+ * les déclare : on les lit dès que le lexer a produit ce retour à la ligne. */
+static void read_pending_heredocs(struct parser *parser)
+{
+    for (int i = 0; i < parser->heredocs_count; i++)
+    {
+        struct redirection *redir = parser->heredocs[i];
+        int strip_tabs = strcmp(redir->operator, "<<-") == 0;
+
+        if (lexer_read_heredoc(parser->lexer, redir->word, strip_tabs,
+                               &redir->heredoc, &redir->heredoc_len) != 0)
+            parser->incomplete = 1;
+    }
+    parser->heredocs_count = 0;
+}
+
 static void parser_advance(struct parser *parser)
 {
     token_free(parser->current_token);
     parser->current_token = lexer_next_token(parser->lexer);
+
+    if (parser->current_token->type == TOKEN_ERROR && parser->lexer->incomplete)
+        parser->incomplete = 1;
+
+    if (parser->heredocs_count > 0 &&
+        (parser->current_token->type == TOKEN_NEWLINE ||
+         parser->current_token->type == TOKEN_EOF))
+        read_pending_heredocs(parser);
+}
+
+static void add_pending_heredoc(struct parser *parser, struct redirection *redir)
+{
+    if (parser->heredocs_count == parser->heredocs_capacity)
+    {
+        int capacity = parser->heredocs_capacity ? parser->heredocs_capacity * 2 : 4;
+        struct redirection **heredocs = realloc(parser->heredocs,
+            sizeof(struct redirection *) * capacity);
+        if (!heredocs)
+            return;
+        parser->heredocs = heredocs;
+        parser->heredocs_capacity = capacity;
+    }
+    parser->heredocs[parser->heredocs_count++] = redir;
 }
 
 struct command *create_command(void)
@@ -36,74 +87,613 @@ struct command *create_command(void)
         return NULL;
     
     cmd->args = malloc(sizeof(char *));
+    if (cmd->args)
+        cmd->args[0] = NULL;
     cmd->redirections = malloc(sizeof(struct redirection *));
     cmd->assignments = malloc(sizeof(char *));
+    cmd->args_flags = malloc(sizeof(int));
+    cmd->assignments_flags = malloc(sizeof(int));
     
     return cmd;
 }
 
-static struct ast_node *create_node(enum node_type type)
+static struct ast_node *create_node(struct parser *parser, enum node_type type)
 {
     struct ast_node *node = malloc(sizeof(struct ast_node));
     if (!node)
         return NULL;
     
+    parser->nodes++;
     node->type = type;
     return node;
 }
 
-struct ast_node *parse_command(struct parser *parser)
+static void remove_quotes(char *word)
 {
-    struct command *cmd = create_command();
-    if (!cmd)
+    char *out = word;
+    char quote = '\0';
+
+    for (char *in = word; *in; in++)
+    {
+        if (quote ? *in == quote : (*in == '\'' || *in == '"'))
+            quote = quote ? '\0' : *in;
+        else if (*in == '\\' && quote != '\'' && in[1])
+            *out++ = *++in;
+        else
+            *out++ = *in;
+    }
+    *out = '\0';
+}
+
+static int is_redirection_operator(struct token *token)
+{
+    return token->type == TOKEN_OPERATOR &&
+           (strcmp(token->value, "<") == 0 ||
+            strcmp(token->value, ">") == 0 ||
+            strcmp(token->value, ">>") == 0 ||
+            strcmp(token->value, "<<") == 0 ||
+            strcmp(token->value, "<<-") == 0);
+}
+
+static void command_add_arg(struct command *cmd, struct token *token)
+{
+    if (!cmd->name)
+        cmd->name = safe_strdup(token->value);
+    cmd->args = realloc(cmd->args, sizeof(char *) * (cmd->args_count + 2));
+    cmd->args_flags = realloc(cmd->args_flags, sizeof(int) * (cmd->args_count + 1));
+    cmd->args_flags[cmd->args_count] = token->flags;
+    cmd->args[cmd->args_count++] = safe_strdup(token->value);
+    cmd->args[cmd->args_count] = NULL;
+    cmd->flags |= token->flags;
+}
+
+static int command_add_redirection(struct parser *parser, struct command *cmd)
+{
+    struct redirection *redir = parse_redirection(parser);
+    if (!redir)
+    {
+        parser->has_error = 1;
+        return -1;
+    }
+    cmd->redirections = realloc(cmd->redirections,
+        sizeof(struct redirection *) * (cmd->redirections_count + 1));
+    cmd->redirections[cmd->redirections_count++] = redir;
+    cmd->flags |= redir->word_flags;
+    /* Le corps d'un here-document non quoté sera expansé */
+    if (strncmp(redir->operator, "<<", 2) == 0 && !(redir->word_flags & WORD_QUOTED))
+        cmd->flags |= WORD_DOLLAR;
+    return 0;
+}
+
+static int is_keyword(struct parser *parser, enum keyword keyword)
+{
+    return parser->current_token->type == TOKEN_WORD &&
+           parser->current_token->keyword == keyword;
+}
+
+static int is_operator(struct parser *parser, const char *op)
+{
+    return parser->current_token->type == TOKEN_OPERATOR &&
+           strcmp(parser->current_token->value, op) == 0;
+}
+
+static void skip_newlines(struct parser *parser)
+{
+    while (parser->current_token->type == TOKEN_NEWLINE)
+        parser_advance(parser);
+}
+
+/* Une entrée qui s'arrête avant le mot attendu est incomplète, pas fausse */
+static int expect_keyword(struct parser *parser, enum keyword keyword)
+{
+    if (is_keyword(parser, keyword))
+    {
+        parser_advance(parser);
+        return 1;
+    }
+    if (parser->current_token->type == TOKEN_EOF)
+        parser->incomplete = 1;
+    parser->has_error = 1;
+    return 0;
+}
+
+/* Mots qui terminent une liste de commandes composée */
+static int is_list_terminator(struct parser *parser)
+{
+    struct token *token = parser->current_token;
+
+    if (token->type == TOKEN_EOF ||
+        (token->type == TOKEN_OPERATOR &&
+         (strcmp(token->value, ")") == 0 || strcmp(token->value, ";;") == 0)))
+        return 1;
+    if (token->type != TOKEN_WORD)
+        return 0;
+    switch (token->keyword)
+    {
+        case KW_THEN:
+        case KW_ELIF:
+        case KW_ELSE:
+        case KW_FI:
+        case KW_DO:
+        case KW_DONE:
+        case KW_ESAC:
+        case KW_RBRACE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Liste de commandes séparées par ';' ou des retours à la ligne, jusqu'au
+ * mot réservé qui la termine (then, do, fi, done...). */
+static struct ast_node *parse_compound_list(struct parser *parser)
+{
+    skip_newlines(parser);
+    if (is_list_terminator(parser))
+    {
+        if (parser->current_token->type == TOKEN_EOF)
+            parser->incomplete = 1;
+        parser->has_error = 1;
         return NULL;
-    
-    struct ast_node *node = create_node(NODE_COMMAND);
+    }
+
+    struct ast_node *left = parse_and_or(parser);
+
+    while (left && !parser->has_error &&
+           (is_operator(parser, ";") || parser->current_token->type == TOKEN_NEWLINE))
+    {
+        parser_advance(parser);
+        skip_newlines(parser);
+        if (is_list_terminator(parser))
+            break;
+
+        struct ast_node *right = parse_and_or(parser);
+        struct ast_node *sequence = right ? create_node(parser, NODE_SEQUENCE) : NULL;
+        if (!sequence)
+        {
+            ast_node_free(right);
+            ast_node_free(left);
+            return NULL;
+        }
+        sequence->data.binary.left = left;
+        sequence->data.binary.right = right;
+        sequence->data.binary.operator = safe_strdup(";");
+        left = sequence;
+    }
+    if (!left || parser->has_error)
+    {
+        ast_node_free(left);
+        return NULL;
+    }
+    return left;
+}
+
+static struct ast_node *create_compound(struct parser *parser, enum node_type type)
+{
+    struct ast_node *node = create_node(parser, type);
     if (!node)
+        return NULL;
+    node->data.compound = calloc(1, sizeof(struct compound));
+    if (node->data.compound)
+        node->data.compound->command = create_command();
+    if (!node->data.compound || !node->data.compound->command)
     {
-        free(cmd);
+        ast_node_free(node);
         return NULL;
     }
-    
-    if (parser->current_token->type == TOKEN_WORD)
+    return node;
+}
+
+/* Après if ou elif : condition, then, puis elif, else ou fi */
+static struct ast_node *parse_if(struct parser *parser)
+{
+    struct ast_node *node = create_compound(parser, NODE_IF);
+    if (!node)
+        return NULL;
+    struct compound *compound = node->data.compound;
+
+    parser_advance(parser);
+    compound->condition = parse_compound_list(parser);
+    if (compound->condition && expect_keyword(parser, KW_THEN))
+        compound->body = parse_compound_list(parser);
+    if (compound->body)
+    {
+        if (is_keyword(parser, KW_ELIF))
+            compound->else_branch = parse_if(parser);
+        else
+        {
+            if (is_keyword(parser, KW_ELSE))
+            {
+                parser_advance(parser);
+                compound->else_branch = parse_compound_list(parser);
+            }
+            if (!parser->has_error)
+                expect_keyword(parser, KW_FI);
+        }
+    }
+
+    if (parser->has_error || !compound->body)
+    {
+        ast_node_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+static struct ast_node *parse_loop(struct parser *parser, enum node_type type)
+{
+    struct ast_node *node = create_compound(parser, type);
+    if (!node)
+        return NULL;
+    struct compound *compound = node->data.compound;
+
+    parser_advance(parser);
+    compound->condition = parse_compound_list(parser);
+    if (compound->condition && expect_keyword(parser, KW_DO))
+        compound->body = parse_compound_list(parser);
+    if (compound->body)
+        expect_keyword(parser, KW_DONE);
+
+    if (parser->has_error || !compound->body)
     {
-        cmd->name = safe_strdup(parser->current_token->value);
-        cmd->args[cmd->args_count++] = safe_strdup(parser->current_token->value);
+        ast_node_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+/* for nom [in mot...] ; do liste ; done */
+static struct ast_node *parse_for(struct parser *parser)
+{
+    struct ast_node *node = create_compound(parser, NODE_FOR);
+    if (!node)
+        return NULL;
+    struct compound *compound = node->data.compound;
+
+    parser_advance(parser);
+    if (parser->current_token->type != TOKEN_WORD || parser->current_token->flags)
+    {
+        if (parser->current_token->type == TOKEN_EOF)
+            parser->incomplete = 1;
+        parser->has_error = 1;
+        ast_node_free(node);
+        return NULL;
+    }
+    compound->variable = safe_strdup(parser->current_token->value);
+    parser_advance(parser);
+    skip_newlines(parser);
+
+    if (is_keyword(parser, KW_IN))
+    {
+        compound->has_words = 1;
         parser_advance(parser);
-        
-        while (parser->current_token->type == TOKEN_WORD)
+        while (parser->current_token->type == TOKEN_WORD ||
+               parser->current_token->type == TOKEN_ASSIGNMENT_WORD)
         {
-            cmd->args = realloc(cmd->args, sizeof(char *) * (cmd->args_count + 1));
-            cmd->args[cmd->args_count++] = safe_strdup(parser->current_token->value);
+            command_add_arg(compound->command, parser->current_token);
             parser_advance(parser);
         }
+        if (!is_operator(parser, ";") && parser->current_token->type != TOKEN_NEWLINE)
+        {
+            if (parser->current_token->type == TOKEN_EOF)
+                parser->incomplete = 1;
+            parser->has_error = 1;
+        }
+        else
+            parser_advance(parser);
     }
+    else if (is_operator(parser, ";"))
+        parser_advance(parser);
+
+    skip_newlines(parser);
+    if (!parser->has_error && expect_keyword(parser, KW_DO))
+        compound->body = parse_compound_list(parser);
+    if (compound->body)
+        expect_keyword(parser, KW_DONE);
+
+    if (parser->has_error || !compound->body)
+    {
+        ast_node_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+/* { liste ; } */
+static struct ast_node *parse_group(struct parser *parser)
+{
+    struct ast_node *node = create_compound(parser, NODE_GROUP);
+    if (!node)
+        return NULL;
+    struct compound *compound = node->data.compound;
+
+    parser_advance(parser);
+    compound->body = parse_compound_list(parser);
+    if (compound->body)
+        expect_keyword(parser, KW_RBRACE);
+
+    if (parser->has_error || !compound->body)
+    {
+        ast_node_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+/* Mot d'un case : expansé en un seul champ s'il n'est pas littéral */
+static void case_add_word(struct command *cmd, struct token *token, int flags)
+{
+    int saved = token->flags;
+
+    if (token->flags)
+        token->flags |= flags;
+    command_add_arg(cmd, token);
+    token->flags = saved;
+}
+
+static int is_word(struct parser *parser)
+{
+    return parser->current_token->type == TOKEN_WORD ||
+           parser->current_token->type == TOKEN_ASSIGNMENT_WORD;
+}
+
+static void syntax_error(struct parser *parser)
+{
+    if (parser->current_token->type == TOKEN_EOF)
+        parser->incomplete = 1;
+    parser->has_error = 1;
+}
+
+/* motif [| motif]... ) liste ;; pour la branche arm */
+static void parse_case_arm(struct parser *parser, struct compound *compound)
+{
+    int arm = compound->arm_count;
+
+    if (is_operator(parser, "("))
+        parser_advance(parser);
+    for (;;)
+    {
+        if (!is_word(parser))
+        {
+            syntax_error(parser);
+            return;
+        }
+        struct token *token = parser->current_token;
+        if (token->flags & WORD_DOLLAR)
+            case_add_word(compound->command, token, WORD_SINGLE | WORD_PATTERN);
+        if (case_matcher_add(compound->matcher, token->value, token->flags, arm,
+                             compound->command->args_count - 1) == -1)
+        {
+            parser->has_error = 1;
+            return;
+        }
+        parser_advance(parser);
+        if (!is_operator(parser, "|"))
+            break;
+        parser_advance(parser);
+    }
+    if (!is_operator(parser, ")"))
+    {
+        syntax_error(parser);
+        return;
+    }
+    parser_advance(parser);
+    skip_newlines(parser);
+
+    struct ast_node *body = NULL;
+    if (!is_operator(parser, ";;") && !is_keyword(parser, KW_ESAC))
+    {
+        body = parse_compound_list(parser);
+        if (!body)
+            return;
+    }
+    struct ast_node **arms = realloc(compound->arms, sizeof(struct ast_node *) * (arm + 1));
+    if (!arms)
+    {
+        ast_node_free(body);
+        parser->has_error = 1;
+        return;
+    }
+    compound->arms = arms;
+    compound->arms[compound->arm_count++] = body;
+
+    if (is_operator(parser, ";;"))
+    {
+        parser_advance(parser);
+        skip_newlines(parser);
+    }
+    else if (!is_keyword(parser, KW_ESAC))
+        syntax_error(parser);
+}
+
+/* case mot in [(] motif [| motif]... ) liste ;; ... esac. Les motifs sont
+ * compilés ici, une fois ; seuls ceux qui contiennent un '$' sont gardés
+ * comme mots de la commande, pour être expansés à chaque exécution. */
+static struct ast_node *parse_case(struct parser *parser)
+{
+    struct ast_node *node = create_compound(parser, NODE_CASE);
+    if (!node)
+        return NULL;
+    struct compound *compound = node->data.compound;
+
+    compound->matcher = case_matcher_new();
+    parser_advance(parser);
+    if (!compound->matcher || !is_word(parser))
+    {
+        syntax_error(parser);
+        ast_node_free(node);
+        return NULL;
+    }
+    case_add_word(compound->command, parser->current_token, WORD_SINGLE);
+    parser_advance(parser);
+    skip_newlines(parser);
+
+    if (expect_keyword(parser, KW_IN))
+    {
+        skip_newlines(parser);
+        while (!parser->has_error && !is_keyword(parser, KW_ESAC))
+            parse_case_arm(parser, compound);
+    }
+    if (!parser->has_error)
+        expect_keyword(parser, KW_ESAC);
+
+    if (parser->has_error || case_matcher_finish(compound->matcher) == -1)
+    {
+        parser->has_error = 1;
+        ast_node_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+static int is_compound_start(struct token *token)
+{
+    return token->type == TOKEN_WORD &&
+           (token->keyword == KW_IF || token->keyword == KW_WHILE ||
+            token->keyword == KW_UNTIL || token->keyword == KW_FOR ||
+            token->keyword == KW_CASE || token->keyword == KW_LBRACE);
+}
+
+static struct ast_node *parse_compound_command(struct parser *parser)
+{
+    struct ast_node *node;
+
+    switch (parser->current_token->keyword)
+    {
+        case KW_LBRACE:
+            node = parse_group(parser);
+            break;
+        case KW_CASE:
+            node = parse_case(parser);
+            break;
+        case KW_IF:
+            node = parse_if(parser);
+            break;
+        case KW_WHILE:
+            node = parse_loop(parser, NODE_WHILE);
+            break;
+        case KW_UNTIL:
+            node = parse_loop(parser, NODE_UNTIL);
+            break;
+        default:
+            node = parse_for(parser);
+            break;
+    }
+
+    /* Redirections appliquées à toute la commande composée */
+    while (node && (parser->current_token->type == TOKEN_IONUMBER ||
+                    is_redirection_operator(parser->current_token)))
+    {
+        if (command_add_redirection(parser, node->data.compound->command) == -1)
+        {
+            ast_node_free(node);
+            return NULL;
+        }
+    }
+    return node;
+}
+
+/* nom ( ) commande-composée : node contient le nom, lu comme une commande */
+static struct ast_node *parse_function(struct parser *parser, struct ast_node *node)
+{
+    struct function_def *function = calloc(1, sizeof(struct function_def));
+    if (!function)
+    {
+        ast_node_free(node);
+        return NULL;
+    }
+    function->name = safe_strdup(node->data.command->name);
+    function->refs = 1;
+    ast_node_free(node);
+
+    parser_advance(parser);
+    if (!is_operator(parser, ")"))
+        parser->has_error = 1;
+    else
+    {
+        parser_advance(parser);
+        skip_newlines(parser);
+        if (is_compound_start(parser->current_token))
+            function->body = parse_compound_command(parser);
+        else
+        {
+            if (parser->current_token->type == TOKEN_EOF)
+                parser->incomplete = 1;
+            parser->has_error = 1;
+        }
+    }
+
+    node = function->body && function->name ? create_node(parser, NODE_FUNCTION) : NULL;
+    if (!node)
+    {
+        function_def_release(function);
+        return NULL;
+    }
+    node->data.function = function;
+    return node;
+}
+
+struct ast_node *parse_command(struct parser *parser)
+{
+    struct token *first = parser->current_token;
+
+    if (first->type == TOKEN_WORD && first->keyword != KW_NONE)
+    {
+        if (is_compound_start(first))
+            return parse_compound_command(parser);
+        if (is_list_terminator(parser))
+        {
+            parser->has_error = 1;
+            return NULL;
+        }
+    }
+
+    struct command *cmd = create_command();
+    if (!cmd)
+        return NULL;
+    cmd->line = parser->lexer->line;
     
-    while (parser->current_token->type == TOKEN_ASSIGNMENT_WORD ||
-           parser->current_token->type == TOKEN_IONUMBER ||
-           (parser->current_token->type == TOKEN_OPERATOR && 
-            (strcmp(parser->current_token->value, "<") == 0 ||
-             strcmp(parser->current_token->value, ">") == 0 ||
-             strcmp(parser->current_token->value, ">>") == 0)))
-    {
-        if (parser->current_token->type == TOKEN_ASSIGNMENT_WORD)
+    struct ast_node *node = create_node(parser, NODE_COMMAND);
+    if (!node)
+    {
+        free(cmd);
+        return NULL;
+    }
+    
+    for (;;)
+    {
+        struct token *token = parser->current_token;
+
+        if (token->type == TOKEN_ASSIGNMENT_WORD && !cmd->name)
         {
             cmd->assignments = realloc(cmd->assignments, 
                 sizeof(char *) * (cmd->assignments_count + 1));
+            cmd->assignments_flags = realloc(cmd->assignments_flags,
+                sizeof(int) * (cmd->assignments_count + 1));
+            cmd->assignments_flags[cmd->assignments_count] = token->flags;
             cmd->assignments[cmd->assignments_count++] = 
-                safe_strdup(parser->current_token->value);
+                safe_strdup(token->value);
+            cmd->flags |= token->flags;
             parser_advance(parser);
         }
-        else
+        else if (token->type == TOKEN_WORD || token->type == TOKEN_ASSIGNMENT_WORD)
         {
-            struct redirection *redir = parse_redirection(parser);
-            if (redir)
-            {
-                cmd->redirections = realloc(cmd->redirections,
-                    sizeof(struct redirection *) * (cmd->redirections_count + 1));
-                cmd->redirections[cmd->redirections_count++] = redir;
-            }
+            command_add_arg(cmd, token);
+            parser_advance(parser);
+        }
+        else if (token->type == TOKEN_IONUMBER || is_redirection_operator(token))
+        {
+            if (command_add_redirection(parser, cmd) == -1)
+                break;
         }
+        else if (is_operator(parser, "(") && cmd->args_count == 1 && !cmd->flags &&
+                 cmd->assignments_count == 0 && cmd->redirections_count == 0)
+        {
+            node->data.command = cmd;
+            return parse_function(parser, node);
+        }
+        else
+            break;
     }
     
     node->data.command = cmd;
@@ -117,6 +707,9 @@ struct redirection *parse_redirection(struct parser *parser)
         return NULL;
     
     redir->ionumber = -1;
+    redir->word_flags = 0;
+    redir->heredoc = NULL;
+    redir->heredoc_len = 0;
     if (parser->current_token->type == TOKEN_IONUMBER)
     {
         redir->ionumber = atoi(parser->current_token->value);
@@ -137,6 +730,16 @@ struct redirection *parse_redirection(struct parser *parser)
     if (parser->current_token->type == TOKEN_WORD)
     {
         redir->word = safe_strdup(parser->current_token->value);
+        redir->word_flags = parser->current_token->flags;
+        if (strncmp(redir->operator, "<<", 2) == 0)
+        {
+            /* Le délimiteur n'est jamais expansé : on retire ses quotes ici,
+             * WORD_QUOTED indique alors un corps à prendre littéralement. */
+            if (redir->word_flags & WORD_QUOTED)
+                remove_quotes(redir->word);
+            redir->word_flags &= WORD_QUOTED;
+            add_pending_heredoc(parser, redir);
+        }
         parser_advance(parser);
     }
     else
@@ -149,8 +752,70 @@ struct redirection *parse_redirection(struct parser *parser)
     return redir;
 }
 
+/* time [-p|-j] pipeline : les options ne sont reconnues que juste après le
+ * mot réservé. Sans pipeline, time mesure une commande vide. */
+static struct ast_node *parse_time(struct parser *parser)
+{
+    char *option = NULL;
+
+    parser_advance(parser);
+    while (parser->current_token->type == TOKEN_WORD &&
+           (strcmp(parser->current_token->value, "-p") == 0 ||
+            strcmp(parser->current_token->value, "-j") == 0))
+    {
+        free(option);
+        option = safe_strdup(parser->current_token->value);
+        parser_advance(parser);
+    }
+
+    struct ast_node *pipeline = NULL;
+    if (!is_list_terminator(parser) && parser->current_token->type != TOKEN_NEWLINE &&
+        !is_operator(parser, ";") && !is_operator(parser, "&"))
+    {
+        pipeline = parse_pipeline(parser);
+        if (!pipeline)
+        {
+            free(option);
+            return NULL;
+        }
+    }
+
+    struct ast_node *time_node = create_node(parser, NODE_TIME);
+    if (!time_node)
+    {
+        free(option);
+        ast_node_free(pipeline);
+        return NULL;
+    }
+    time_node->data.binary.left = pipeline;
+    time_node->data.binary.right = NULL;
+    time_node->data.binary.operator = option;
+    return time_node;
+}
+
 struct ast_node *parse_pipeline(struct parser *parser)
 {
+    if (is_keyword(parser, KW_TIME))
+        return parse_time(parser);
+
+    if (is_keyword(parser, KW_BANG))
+    {
+        parser_advance(parser);
+        struct ast_node *pipeline = parse_pipeline(parser);
+        if (!pipeline)
+            return NULL;
+        struct ast_node *not_node = create_node(parser, NODE_NOT);
+        if (!not_node)
+        {
+            ast_node_free(pipeline);
+            return NULL;
+        }
+        not_node->data.binary.left = pipeline;
+        not_node->data.binary.right = NULL;
+        not_node->data.binary.operator = NULL;
+        return not_node;
+    }
+
     struct ast_node *left = parse_command(parser);
     if (!left)
         return NULL;
@@ -167,7 +832,7 @@ struct ast_node *parse_pipeline(struct parser *parser)
             return NULL;
         }
         
-        struct ast_node *pipe_node = create_node(NODE_PIPELINE);
+        struct ast_node *pipe_node = create_node(parser, NODE_PIPELINE);
         if (!pipe_node)
         {
             ast_node_free(left);
@@ -206,7 +871,7 @@ struct ast_node *parse_and_or(struct parser *parser)
             return NULL;
         }
         
-        struct ast_node *and_or_node = create_node(NODE_AND_OR);
+        struct ast_node *and_or_node = create_node(parser, NODE_AND_OR);
         if (!and_or_node)
         {
             free(op);
@@ -236,7 +901,8 @@ struct ast_node *parse_list(struct parser *parser)
     {
         parser_advance(parser);
         
-        if (parser->current_token->type == TOKEN_EOF)
+        if (parser->current_token->type == TOKEN_EOF ||
+            parser->current_token->type == TOKEN_NEWLINE)
             break;
             
         struct ast_node *right = parse_and_or(parser);
@@ -246,7 +912,7 @@ struct ast_node *parse_list(struct parser *parser)
             return NULL;
         }
         
-        struct ast_node *sequence_node = create_node(NODE_SEQUENCE);
+        struct ast_node *sequence_node = create_node(parser, NODE_SEQUENCE);
         if (!sequence_node)
         {
             ast_node_free(left);
@@ -264,16 +930,28 @@ struct ast_node *parse_list(struct parser *parser)
     return left;
 }
 
+/* Analyse une commande complète, jusqu'à la fin de ligne. Le retour à la
+ * ligne final n'est pas consommé : la position du lexer indique alors où
+ * commence la commande suivante. */
 struct ast_node *parse_input(struct parser *parser)
 {
+    parser->has_error = 0;
+    parser->incomplete = 0;
+
+    while (parser->current_token->type == TOKEN_NEWLINE)
+        parser_advance(parser);
+
     if (parser->current_token->type == TOKEN_EOF)
         return NULL;
         
     struct ast_node *node = parse_list(parser);
     
-    if (node && parser->current_token->type != TOKEN_EOF)
+    if (!node || parser->has_error ||
+        (parser->current_token->type != TOKEN_EOF &&
+         parser->current_token->type != TOKEN_NEWLINE))
     {
         ast_node_free(node);
+        parser->heredocs_count = 0;
         parser->has_error = 1;
         return NULL;
     }
@@ -281,6 +959,70 @@ struct ast_node *parse_input(struct parser *parser)
     return node;
 }
 
+void parser_skip_line(struct parser *parser)
+{
+    parser->heredocs_count = 0;
+    while (parser->current_token->type != TOKEN_EOF &&
+           parser->current_token->type != TOKEN_NEWLINE)
+        parser_advance(parser);
+}
+
+void command_scratch_free(struct command_scratch *scratch)
+{
+    if (!scratch)
+        return;
+    strbuf_free(&scratch->text);
+    strbuf_free(&scratch->subst);
+    free(scratch->offsets);
+    free(scratch->word_offsets);
+    free(scratch->args);
+    free(scratch->assignments);
+    free(scratch->redirections);
+    free(scratch->redirection_ptrs);
+    for (int i = 0; i < scratch->compiled_count; i++)
+        free(scratch->compiled[i].compiled);
+    free(scratch->compiled);
+    free(scratch);
+}
+
+static void command_free(struct command *cmd)
+{
+    if (!cmd)
+        return;
+
+    free(cmd->name);
+    for (int i = 0; i < cmd->args_count; i++)
+        free(cmd->args[i]);
+    free(cmd->args);
+    free(cmd->args_flags);
+    free(cmd->assignments_flags);
+    command_scratch_free(cmd->scratch);
+
+    for (int i = 0; i < cmd->redirections_count; i++)
+    {
+        free(cmd->redirections[i]->operator);
+        free(cmd->redirections[i]->word);
+        free(cmd->redirections[i]->heredoc);
+        free(cmd->redirections[i]);
+    }
+    free(cmd->redirections);
+
+    for (int i = 0; i < cmd->assignments_count; i++)
+        free(cmd->assignments[i]);
+    free(cmd->assignments);
+
+    free(cmd);
+}
+
+void function_def_release(struct function_def *function)
+{
+    if (!function || --function->refs > 0)
+        return;
+    free(function->name);
+    ast_node_free(function->body);
+    free(function);
+}
+
 void ast_node_free(struct ast_node *node)
 {
     if (!node)
@@ -289,32 +1031,39 @@ void ast_node_free(struct ast_node *node)
     switch (node->type)
     {
         case NODE_COMMAND:
-            if (node->data.command)
+            command_free(node->data.command);
+            break;
+
+        case NODE_FUNCTION:
+            function_def_release(node->data.function);
+            break;
+
+        case NODE_IF:
+        case NODE_WHILE:
+        case NODE_UNTIL:
+        case NODE_FOR:
+        case NODE_GROUP:
+        case NODE_CASE:
+            if (node->data.compound)
             {
-                free(node->data.command->name);
-                for (int i = 0; i < node->data.command->args_count; i++)
-                    free(node->data.command->args[i]);
-                free(node->data.command->args);
-                
-                for (int i = 0; i < node->data.command->redirections_count; i++)
-                {
-                    free(node->data.command->redirections[i]->operator);
-                    free(node->data.command->redirections[i]->word);
-                    free(node->data.command->redirections[i]);
-                }
-                free(node->data.command->redirections);
-                
-                for (int i = 0; i < node->data.command->assignments_count; i++)
-                    free(node->data.command->assignments[i]);
-                free(node->data.command->assignments);
-                
-                free(node->data.command);
+                for (int i = 0; i < node->data.compound->arm_count; i++)
+                    ast_node_free(node->data.compound->arms[i]);
+                free(node->data.compound->arms);
+                case_matcher_free(node->data.compound->matcher);
+                ast_node_free(node->data.compound->condition);
+                ast_node_free(node->data.compound->body);
+                ast_node_free(node->data.compound->else_branch);
+                free(node->data.compound->variable);
+                command_free(node->data.compound->command);
+                free(node->data.compound);
             }
             break;
             
         case NODE_PIPELINE:
         case NODE_AND_OR:
         case NODE_SEQUENCE:
+        case NODE_NOT:
+        case NODE_TIME:
             ast_node_free(node->data.binary.left);
             ast_node_free(node->data.binary.right);
             free(node->data.binary.operator);
@@ -325,6 +1074,7 @@ void ast_node_free(struct ast_node *node)
             {
                 free(node->data.redirection->operator);
                 free(node->data.redirection->word);
+                free(node->data.redirection->heredoc);
                 free(node->data.redirection);
             }
             break;
@@ -343,6 +1093,7 @@ void parser_free(struct parser *parser)
     {
         if (parser->current_token)
             token_free(parser->current_token);
+        free(parser->heredocs);
         free(parser);
     }
 }
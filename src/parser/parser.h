@@ -2,6 +2,7 @@
 #define PARSER_H
 
 #include "../lexer/lexer.h"
+#include "../string_utils.h"
 
 enum node_type {
     NODE_COMMAND,
@@ -9,15 +10,30 @@ enum node_type {
     NODE_AND_OR,
     NODE_SEQUENCE,
     NODE_REDIRECTION,
-    NODE_ASSIGNMENT
+    NODE_ASSIGNMENT,
+    NODE_IF,
+    NODE_WHILE,
+    NODE_UNTIL,
+    NODE_FOR,
+    NODE_GROUP,         /* { liste ; } */
+    NODE_CASE,
+    NODE_FUNCTION,
+    NODE_NOT,           /* ! pipeline : data.binary.left */
+    NODE_TIME           /* time [-p|-j] pipeline : data.binary.left, option dans operator */
 };
 
 struct redirection {
     int ionumber;
     char *operator;
     char *word;
+    int word_flags;
+    char *heredoc;      /* corps d'un << / <<-, lu après la fin de ligne */
+    size_t heredoc_len;
 };
 
+struct command_scratch;
+struct case_matcher;
+
 struct command {
     char *name;
     char **args;
@@ -26,12 +42,70 @@ struct command {
     int redirections_count;
     char **assignments;
     int assignments_count;
+    int *args_flags;        /* WORD_* de chaque argument */
+    int *assignments_flags;
+    int flags;              /* union des WORD_* de tous les mots */
+    size_t line;            /* ligne de l'entrée où commence la commande */
+    struct command_scratch *scratch;
+};
+
+/* Expression $((...)) ou motif compilé, retrouvé par l'adresse de son texte
+ * dans la commande. Alloué en un bloc, libéré par free(). */
+struct compiled_cache {
+    const char *source;
+    void *compiled;
+};
+
+/* Mémoire de travail de l'expansion, gardée d'une exécution de la commande à
+ * l'autre : une fois dimensionnée, expanser la commande n'alloue plus rien. */
+struct command_scratch {
+    struct strbuf text;         /* champs expansés, chacun terminé par '\0' */
+    struct strbuf subst;        /* sortie d'une substitution $(...) */
+    size_t *offsets;            /* début de chaque argument dans text */
+    size_t *word_offsets;       /* idem pour affectations, redirections, corps */
+    char **args;
+    int args_capacity;
+    char **assignments;
+    struct redirection *redirections;
+    struct redirection **redirection_ptrs;
+    struct command expanded;
+    struct compiled_cache *compiled;
+    int compiled_count;
+    int compiled_capacity;
+    int in_use;                 /* commande en cours (appel récursif) */
+};
+
+/* Commande composée. Le corps est analysé une fois et exécuté autant de
+ * fois que nécessaire. Les mots d'un for ou d'un case et les redirections
+ * qui suivent la commande sont rangés dans une struct command, pour passer
+ * par la même expansion qu'une commande simple. */
+struct compound {
+    struct ast_node *condition;     /* if, while, until */
+    struct ast_node *body;          /* then ..., do ... done */
+    struct ast_node *else_branch;   /* else ..., ou un NODE_IF pour elif */
+    char *variable;                 /* for */
+    int has_words;                  /* for ... in */
+    struct command *command;
+    struct case_matcher *matcher;   /* case : motifs compilés */
+    struct ast_node **arms;         /* case : liste de chaque branche */
+    int arm_count;
+};
+
+/* Définition de fonction : le corps, une commande composée, est partagé par
+ * le nœud qui la déclare et la table des fonctions, et libéré avec la
+ * dernière référence. */
+struct function_def {
+    char *name;
+    struct ast_node *body;
+    int refs;
 };
 
 struct ast_node {
     enum node_type type;
     union {
         struct command *command;
+        struct compound *compound;
+        struct function_def *function;
         struct {
             struct ast_node *left;
             struct ast_node *right;
@@ -46,11 +120,21 @@ struct parser {
     struct lexer *lexer;
     struct token *current_token;
     int has_error;
+    int incomplete;     /* l'entrée s'arrête au milieu d'une commande */
+    struct redirection **heredocs; /* here-documents dont le corps reste à lire */
+    int heredocs_count;
+    int heredocs_capacity;
+    size_t nodes;       /* nœuds créés, pour le builtin stats */
 };
 
 struct parser *parser_init(struct lexer *lexer);
+/* Reprend l'analyse au début de l'entrée du lexer (après lexer_reset) ; le
+ * tableau des here-documents en attente est gardé */
+void parser_reset(struct parser *parser);
 void parser_free(struct parser *parser);
 void ast_node_free(struct ast_node *node);
+void command_scratch_free(struct command_scratch *scratch);
+void function_def_release(struct function_def *function);
 
 struct ast_node *parse_command(struct parser *parser);
 struct redirection *parse_redirection(struct parser *parser);
@@ -58,5 +142,6 @@ struct ast_node *parse_pipeline(struct parser *parser);
 struct ast_node *parse_and_or(struct parser *parser);
 struct ast_node *parse_list(struct parser *parser);
 struct ast_node *parse_input(struct parser *parser);
+void parser_skip_line(struct parser *parser);
 
 #endif /* PARSER_H */
@@ -28,4 +28,71 @@ static inline char *my_strndup(const char *str, size_t n)
     return new_str;
 }
 
+/* FNV-1a : hachage des noms de variables, de builtins et de fonctions */
+static inline unsigned int hash_name(const char *name, size_t len)
+{
+    unsigned int hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Chaîne extensible, toujours terminée par '\0' */
+struct strbuf {
+    char *data;
+    size_t len;
+    size_t capacity;
+};
+
+static inline int strbuf_reserve(struct strbuf *sb, size_t extra)
+{
+    if (sb->len + extra + 1 <= sb->capacity)
+        return 0;
+
+    size_t capacity = sb->capacity ? sb->capacity : 64;
+    while (sb->len + extra + 1 > capacity)
+        capacity *= 2;
+
+    char *data = realloc(sb->data, capacity);
+    if (!data)
+        return -1;
+    sb->data = data;
+    sb->capacity = capacity;
+    return 0;
+}
+
+static inline int strbuf_append(struct strbuf *sb, const char *data, size_t len)
+{
+    if (strbuf_reserve(sb, len) == -1)
+        return -1;
+    memcpy(sb->data + sb->len, data, len);
+    sb->len += len;
+    sb->data[sb->len] = '\0';
+    return 0;
+}
+
+static inline int strbuf_putc(struct strbuf *sb, char c)
+{
+    return strbuf_append(sb, &c, 1);
+}
+
+static inline void strbuf_reset(struct strbuf *sb)
+{
+    sb->len = 0;
+    if (sb->data)
+        sb->data[0] = '\0';
+}
+
+static inline void strbuf_free(struct strbuf *sb)
+{
+    free(sb->data);
+    sb->data = NULL;
+    sb->len = 0;
+    sb->capacity = 0;
+}
+
 #endif /* STRING_UTILS_H */
@@ -0,0 +1,101 @@
+/* Client minimal du mode serveur : envoie une commande avec ses propres
+ * entrée, sortie et sortie d'erreur, et sort avec le statut renvoyé par le
+ * serveur. -s affiche les statistiques du serveur.
+ *
+ * Usage : client SOCKET COMMAND
+ *         client -s SOCKET */
+
+#include "../src/exec/server.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static int connect_server(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd == -1 || strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* En-tête avec 0, 1 et 2 en SCM_RIGHTS pour SERVER_RUN, puis le texte */
+static int send_request(int fd, uint32_t kind, const char *text)
+{
+    struct server_request request = { kind, text ? strlen(text) : 0 };
+    struct iovec iov = { &request, sizeof(request) };
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (kind == SERVER_RUN)
+    {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    }
+
+    if (sendmsg(fd, &msg, 0) != sizeof(request))
+        return -1;
+    for (size_t done = 0; done < request.length; )
+    {
+        ssize_t n = write(fd, text + done, request.length - done);
+        if (n <= 0)
+            return -1;
+        done += n;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int stats = argc == 3 && strcmp(argv[1], "-s") == 0;
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s SOCKET COMMAND | %s -s SOCKET\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    int fd = connect_server(argv[stats ? 2 : 1]);
+    if (fd == -1 || send_request(fd, stats ? SERVER_STATS : SERVER_RUN,
+                                 stats ? NULL : argv[2]) == -1)
+    {
+        perror("client");
+        return 2;
+    }
+
+    struct server_reply reply;
+    if (recv(fd, &reply, sizeof(reply), MSG_WAITALL) != sizeof(reply) || reply.status < 0)
+    {
+        fprintf(stderr, "client: request failed\n");
+        return 2;
+    }
+
+    char buffer[4096];
+    for (uint32_t left = reply.length; left > 0; )
+    {
+        ssize_t n = read(fd, buffer, left < sizeof(buffer) ? left : sizeof(buffer));
+        if (n <= 0)
+            break;
+        fwrite(buffer, 1, n, stdout);
+        left -= n;
+    }
+    close(fd);
+    return reply.status;
+}
@@ -1,12 +1,23 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <dirent.h>
 #include "../src/lexer/lexer.h"
 #include "../src/parser/parser.h"
 #include "../src/exec/exec.h"
+#include "../src/exec/vars.h"
+#include "../src/exec/trace.h"
+#include "../src/exec/profile.h"
+#include "../src/exec/input.h"
+#include "../src/exec/alloc.h"
+#include "../src/exec/pipes.h"
+#include "../src/exec/path.h"
+#include "../src/minishell.h"
 
 extern char **environ;
 
@@ -16,6 +27,7 @@ extern char **environ;
 
 static int test_count = 0;
 static int tests_passed = 0;
+static int test_options = 0;
 
 static char *capture_output(struct ast_node *node, struct exec_state *state)
 {
@@ -23,6 +35,8 @@ static char *capture_output(struct ast_node *node, struct exec_state *state)
     if (pipe(pipefd) == -1)
         return NULL;
 
+    /* Ce que le test a déjà écrit ne doit pas finir dans le pipe */
+    fflush(stdout);
     int stdout_save = dup(STDOUT_FILENO);
     dup2(pipefd[1], STDOUT_FILENO);
     close(pipefd[1]);
@@ -51,6 +65,7 @@ static void run_test(const char *command, const char *expected_output, const cha
     struct ast_node *ast = parse_input(parser);
     extern char **environ;
     struct exec_state *state = exec_init(environ);
+    state->options = test_options;
 
     char *output = capture_output(ast, state);
 
@@ -85,6 +100,18 @@ static void test_pipe(void)
     run_test("echo hello | cat | cat", "hello\n", "Multiple pipes");
 }
 
+static void test_pipe_threads(void)
+{
+    test_options = OPT_PIPETHREADS;
+    run_test("echo hello | tr a-z A-Z | cat", "HELLO\n", "Threaded first stage");
+    run_test("echo a | echo b | cat", "b\n", "Threaded middle stage");
+    run_test("echo hello > test_thread.txt | cat; cat test_thread.txt", "hello\n",
+             "Threaded stage with redirection");
+    run_test("exit 3 | cat; echo still here", "still here\n", "Threaded exit stage");
+    test_options = 0;
+    system("rm -f test_thread.txt");
+}
+
 static void test_redirections(void)
 {
     system("rm -f test_out.txt");
@@ -113,6 +140,581 @@ static void test_sequences(void)
     run_test("echo a; echo b; echo c", "a\nb\nc\n", "Multiple sequence");
 }
 
+static void test_expansion(void)
+{
+    run_test("x='a  b'; echo $x; echo \"$x\"", "a b\na  b\n", "Variable and field splitting");
+    run_test("echo x${UNSET_VAR}y '$x' \\$x", "xy $x $x\n", "Braces and quoting");
+    run_test("false; echo $?; true; echo $?", "1\n0\n", "Last status");
+    run_test("x=1; x=22; x=3; echo $x; unset x; echo [$x]", "3\n[]\n", "Reassign and unset");
+    run_test("x=v; echo $(echo $x)", "v\n", "Variable in substitution");
+    run_test("x=3; echo $((x * (2 + 1))) $((x /= 2)) $x", "9 1 1\n", "Arithmetic expansion");
+    run_test("echo $((1 / 0)); echo next", "next\n", "Division by zero");
+}
+
+/* Une commande exécutée plusieurs fois ne compile son $((...)) qu'une fois */
+static void test_arith_cache(void)
+{
+    test_count++;
+
+    struct lexer *lexer = lexer_init(strdup("x=$((x + 2))"));
+    struct parser *parser = parser_init(lexer);
+    struct ast_node *ast = parse_input(parser);
+    struct exec_state *state = exec_init(environ);
+
+    for (int i = 0; i < 3; i++)
+        exec_ast(ast, state);
+
+    const char *x = vars_get(state->vars, "x", 1);
+    struct command_scratch *scratch = ast->data.command->scratch;
+
+    if (scratch && scratch->compiled_count == 1 && x && strcmp(x, "6") == 0)
+    {
+        printf("%sTest Arithmetic cache: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+    {
+        printf("%sTest Arithmetic cache: FAILED%s\n", RED, RESET);
+        printf("Got x='%s'\n", x ? x : "NULL");
+    }
+
+    ast_node_free(ast);
+    parser_free(parser);
+    lexer_free(lexer);
+    exec_free(state);
+}
+
+static void run_line(const char *line, struct exec_state *state)
+{
+    struct lexer *lexer = lexer_init(strdup(line));
+    struct parser *parser = parser_init(lexer);
+    struct ast_node *ast = parse_input(parser);
+
+    exec_ast(ast, state);
+    ast_node_free(ast);
+    parser_free(parser);
+    lexer_free(lexer);
+}
+
+/* Lit un fichier écrit par un test dans buffer, terminé par '\0', puis
+ * le supprime */
+static void read_test_file(const char *path, char *buffer, size_t size)
+{
+    FILE *file = fopen(path, "r");
+    size_t n = file ? fread(buffer, 1, size - 1, file) : 0;
+    buffer[n] = '\0';
+    if (file)
+        fclose(file);
+    remove(path);
+}
+
+/* Exécute line avec l'erreur standard du processus envoyée dans buffer */
+static void run_capture_stderr(const char *line, struct exec_state *state, char *buffer,
+                               size_t size)
+{
+    int saved = dup(STDERR_FILENO);
+    int fd = open("test_stderr.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+    run_line(line, state);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+    read_test_file("test_stderr.txt", buffer, size);
+}
+
+static void test_function_frames(void)
+{
+    test_count++;
+
+    struct exec_state *state = exec_init(environ);
+
+    /* La définition survit à la ligne qui l'a déclarée */
+    run_line("f() { local x=inner; y=$2$#; return 4; }", state);
+    run_line("x=outer; f a b", state);
+
+    const char *x = vars_get(state->vars, "x", 1);
+    const char *y = vars_get(state->vars, "y", 1);
+
+    if (x && strcmp(x, "outer") == 0 && y && strcmp(y, "b2") == 0 &&
+        state->last_return == 4 && state->frame == &state->toplevel &&
+        state->locals.count == 0 && state->call_depth == 0)
+    {
+        printf("%sTest Function frames: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+    {
+        printf("%sTest Function frames: FAILED%s\n", RED, RESET);
+        printf("Got x='%s' y='%s' status=%d\n", x ? x : "NULL", y ? y : "NULL",
+               state->last_return);
+    }
+
+    exec_free(state);
+}
+
+/* Une commande externe reçoit l'environnement tel quel : rien n'est indexé
+ * ni découpé avant qu'une variable ou PATH ne serve */
+static void test_lazy_init(void)
+{
+    test_count++;
+
+    char *env[] = { "LAZY=1", "PATH=/bin:/usr/bin", NULL };
+    struct exec_state *state = exec_init(env);
+
+    int lazy = state->vars->pending == env && !state->functions && !state->paths &&
+               !state->shell_pid;
+    run_line("/bin/true", state);
+    lazy = lazy && state->vars->pending == env && !state->paths;
+    run_line("true", state);
+    lazy = lazy && state->vars->pending == env;
+    run_line("LAZY=$LAZY$LAZY env >/dev/null", state);
+
+    const char *value = vars_get(state->vars, "LAZY", 4);
+    if (lazy && !state->vars->pending && state->paths && value && strcmp(value, "1") == 0)
+    {
+        printf("%sTest Lazy initialization: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Lazy initialization: FAILED%s\n", RED, RESET);
+
+    exec_free(state);
+}
+
+/* Une commande trouvée n'est plus cherchée dans PATH, seulement revérifiée */
+static void test_path_table(void)
+{
+    test_count++;
+
+    struct path_cache *cache = NULL;
+    unsigned long searched = 0;
+    unsigned long known = 0;
+    unsigned long changed = 0;
+    const char *path = "/nonexistent:/bin:/usr/bin";
+
+    int found = path_search(&cache, path, "sh", AT_FDCWD, &searched) != NULL;
+    found = found && path_search(&cache, path, "sh", AT_FDCWD, &known) != NULL;
+    found = found && path_search(&cache, "/nonexistent:/bin", "sh", AT_FDCWD, &changed) != NULL;
+    path_cache_free(cache);
+
+    cache = NULL;
+    unsigned long preloaded = 0;
+    long count = path_preload(&cache, path);
+    const char *ls = path_search(&cache, path, "ls", AT_FDCWD, &preloaded);
+    int table = count > 0 && ls && strcmp(ls + strlen(ls) - 3, "/ls") == 0 && preloaded == 1;
+    path_cache_free(cache);
+
+    if (found && searched == 2 && known == 1 && changed == 2 && table)
+    {
+        printf("%sTest PATH table: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest PATH table: FAILED (probes %lu %lu %lu, %ld commands)%s\n", RED,
+               searched, known, changed, count, RESET);
+}
+
+static void test_stats(void)
+{
+    test_count++;
+
+    struct exec_state *state = exec_init(environ);
+    run_line("echo a > /dev/null; /bin/true; true | /bin/true", state);
+
+    struct shell_stats *stats = &state->stats;
+    /* le true du pipeline tourne dans un fils : seul echo est compté */
+    int counted = stats->builtins == 1 && stats->forks == 3 && stats->execs == 1 &&
+                  stats->redirections == 1;
+    run_line("stats -r", state);
+
+    if (counted && stats->builtins == 0 && stats->forks == 0 && stats->wait_ns == 0)
+    {
+        printf("%sTest Stats counters: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Stats counters: FAILED%s\n", RED, RESET);
+
+    exec_free(state);
+}
+
+/* Les spans d'un fils forké arrivent dans l'anneau partagé du shell */
+static void test_trace(void)
+{
+    test_count++;
+
+    struct exec_state *state = exec_init(environ);
+    trace_start("test_trace.json", 16);
+    run_line("echo traced | cat > /dev/null", state);
+    trace_finish();
+    exec_free(state);
+
+    char buffer[8192];
+    read_test_file("test_trace.json", buffer, sizeof(buffer));
+
+    if (!trace_enabled() && strstr(buffer, "\"traceEvents\"") &&
+        strstr(buffer, "\"name\":\"echo\"") && strstr(buffer, "\"cat\":\"wait\""))
+    {
+        printf("%sTest Trace export: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Trace export: FAILED%s\n", RED, RESET);
+}
+
+/* Le temps d'un corps de fonction va à ses lignes, pas à l'appel */
+static void test_profile(void)
+{
+    test_count++;
+
+    struct exec_state *state = exec_init(environ);
+    state->profile = profile_new(NULL);
+    run_line("f() {\n/bin/true\necho a > /dev/null\n}; f; f", state);
+
+    struct profile *profile = state->profile;
+    int ok = profile && profile->line_capacity > 4 && profile->depth == 0 &&
+             profile->lines[4].calls == 2 && profile->lines[4].forks == 0 &&
+             profile->lines[2].calls == 2 && profile->lines[2].forks == 2 &&
+             profile->lines[3].calls == 2 && strcmp(profile->lines[2].name, "/bin/true") == 0;
+    profile_finish(profile, NULL);
+
+    /* La ligne porte le nom de la commande expansée, pas le mot écrit */
+    state->profile = profile = profile_new(NULL);
+    run_line("c=/bin/true; g() {\n$c\n}; g", state);
+    ok = ok && profile && profile->line_capacity > 2 && profile->lines[2].name &&
+         strcmp(profile->lines[2].name, "/bin/true") == 0;
+    profile_finish(profile, NULL);
+    state->profile = NULL;
+
+    if (ok)
+    {
+        printf("%sTest Profile lines: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Profile lines: FAILED%s\n", RED, RESET);
+
+    exec_free(state);
+}
+
+/* time -j : une ligne par étage du pipeline, même pour un builtin */
+static void test_time(void)
+{
+    test_count++;
+
+    struct exec_state *state = exec_init(environ);
+    char buffer[4096];
+    run_capture_stderr("time -j echo a | /bin/cat > /dev/null", state, buffer, sizeof(buffer));
+
+    if (state->timing == NULL && state->last_return == 0 &&
+        strstr(buffer, "{\"command\": \"echo\"") &&
+        strstr(buffer, "{\"command\": \"/bin/cat\"") && strstr(buffer, "\"nivcsw\""))
+    {
+        printf("%sTest Time stages: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Time stages: FAILED%s\n", RED, RESET);
+
+    exec_free(state);
+}
+
+/* PIPESIZE : suffixes, valeurs invalides, borne de pipe-max-size. Sous
+ * time, un écrivain dont le lecteur s'arrête reçoit toujours SIGPIPE. */
+static void test_pipe_capacity(void)
+{
+    test_count++;
+
+    long max = pipe_capacity("1000000000");
+    int parsed = pipe_capacity("4096") == 4096 && pipe_capacity("64k") == 65536 &&
+                 pipe_capacity("x") == 0 && pipe_capacity("1kb") == 0 &&
+                 pipe_capacity("-1") == 0 && pipe_capacity(NULL) == 0 && max > 0 &&
+                 pipe_capacity("1000m") == max;
+
+    struct exec_state *state = exec_init(environ);
+    char buffer[4096];
+    run_capture_stderr("PIPESIZE=128k; time -j yes | head -c 300000 > /dev/null", state,
+                       buffer, sizeof(buffer));
+
+    if (parsed && state->last_return == 0 && strstr(buffer, "\"status\": 141") &&
+        strstr(buffer, "\"blocked_pct\""))
+    {
+        printf("%sTest Pipe capacity: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Pipe capacity: FAILED (parsed %d, '%s')%s\n", RED, parsed, buffer, RESET);
+
+    exec_free(state);
+}
+
+static void test_pipe_placement(void)
+{
+    test_count++;
+
+    cpu_set_t sets[4];
+    int parsed = pipe_placement("0-2:4::6,8:9", sets, 3) == 2 && CPU_COUNT(&sets[0]) == 3 &&
+                 CPU_ISSET(2, &sets[0]) && CPU_ISSET(4, &sets[1]) &&
+                 CPU_COUNT(&sets[1]) == 1 && CPU_COUNT(&sets[2]) == 0 &&
+                 pipe_placement("1-", sets, 2) == 0 && pipe_placement("3-1", sets, 2) == 0 &&
+                 pipe_placement("0,", sets, 2) == 0 && pipe_placement("0:x", sets, 2) == 0 &&
+                 pipe_placement(" 1", sets, 2) == 0 && pipe_placement("", sets, 2) == 0;
+
+    /* La politique cache place chaque étage sur un seul CPU autorisé */
+    cpu_set_t allowed;
+    int cached = sched_getaffinity(0, sizeof(allowed), &allowed) == 0 &&
+                 pipe_placement(PIPE_PLACE_CACHE, sets, 4) == 4;
+    for (int i = 0; cached && i < 4; i++)
+    {
+        cpu_set_t both;
+        CPU_AND(&both, &sets[i], &allowed);
+        cached = CPU_COUNT(&sets[i]) == 1 && CPU_COUNT(&both) == 1;
+    }
+
+    /* Le premier étage lit sa propre affinité */
+    int cpu = 0;
+    while (cpu < CPU_SETSIZE && !CPU_ISSET(cpu, &allowed))
+        cpu++;
+    char line[128];
+    char expected[64];
+    snprintf(line, sizeof(line), "PIPECPUS=%d; cat /proc/self/status | "
+             "grep Cpus_allowed_list > test_cpus.txt", cpu);
+    snprintf(expected, sizeof(expected), "Cpus_allowed_list:\t%d\n", cpu);
+
+    struct exec_state *state = exec_init(environ);
+    run_line(line, state);
+
+    char buffer[128];
+    read_test_file("test_cpus.txt", buffer, sizeof(buffer));
+
+    if (parsed && cached && strcmp(buffer, expected) == 0)
+    {
+        printf("%sTest Pipe placement: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Pipe placement: FAILED (parsed %d, cached %d, '%s')%s\n", RED,
+               parsed, cached, buffer, RESET);
+
+    exec_free(state);
+}
+
+/* Un >(...) est attendu avec la commande : le fichier est écrit quand la
+ * ligne se termine, et aucun fd ne reste ouvert dans le shell */
+static size_t count_fds(void)
+{
+    size_t count = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir)
+        return 0;
+    while (readdir(dir))
+        count++;
+    closedir(dir);
+    return count;
+}
+
+static void test_process_substitution(void)
+{
+    test_count++;
+
+    struct exec_state *state = exec_init(environ);
+    size_t fds = count_fds();
+    run_line("echo abc > >(tr a-z A-Z > test_procsub.txt)", state);
+    int written = state->last_return;
+    run_line("f() { read x < \"$1\"; [ \"$x\" = ABC ]; }; f <(cat test_procsub.txt)", state);
+
+    char buffer[64];
+    read_test_file("test_procsub.txt", buffer, sizeof(buffer));
+
+    if (written == 0 && state->last_return == 0 && strcmp(buffer, "ABC\n") == 0 &&
+        state->procsubs.count == 0 && count_fds() == fds)
+    {
+        printf("%sTest Process substitution: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Process substitution: FAILED (status %d, '%s')%s\n", RED,
+               state->last_return, buffer, RESET);
+
+    exec_free(state);
+}
+
+/* Une fois la ligne gardée et ses tampons dimensionnés, la répéter un
+ * million de fois n'alloue rien. Le test doit être lié avec les options
+ * ALLOC_WRAP du Makefile pour que les allocations soient comptées. */
+static void test_steady_state(void)
+{
+    test_count++;
+
+    struct exec_state *state = exec_init(environ);
+    char line[] = "x=steady; : $x a b; true && [ $x = steady ] || false\n";
+
+    input_process(line, 0, state);
+    input_process(line, 0, state);
+    unsigned long before = alloc_total();
+    for (int i = 0; i < 1000000; i++)
+        input_process(line, 0, state);
+    unsigned long allocations = alloc_total() - before;
+
+    /* Les allocations d'un autre état ne comptent que dans ses stats */
+    struct exec_state *other = exec_init(environ);
+    unsigned long own = state->stats.allocs[ALLOC_EXPAND];
+    char busy[] = "y=$(echo a); echo $y > /dev/null\n";
+    input_process(busy, 0, other);
+    int separate = other->stats.allocs[ALLOC_EXPAND] > 0 &&
+                   state->stats.allocs[ALLOC_EXPAND] == own;
+    exec_free(other);
+
+    if (alloc_counting() && allocations == 0 && separate && state->last_return == 0 &&
+        state->input_line == 1000003)
+    {
+        printf("%sTest Steady-state allocations: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Steady-state allocations: FAILED (counting %d, %lu allocations, "
+               "separate %d)%s\n", RED, alloc_counting(), allocations, separate, RESET);
+
+    exec_free(state);
+}
+
+/* API de libminishell : l'état survit d'un appel à l'autre, la sortie et
+ * les erreurs des builtins arrivent dans les tampons de l'appelant */
+static void test_library(void)
+{
+    test_count++;
+
+    struct minishell *shell = minishell_new(NULL);
+    char out_data[64];
+    char err_data[64];
+    char small_data[4];
+    struct minishell_buffer out = { out_data, sizeof(out_data), 0 };
+    struct minishell_buffer err = { err_data, sizeof(err_data), 0 };
+    struct minishell_buffer small = { small_data, sizeof(small_data), 0 };
+
+    int first = minishell_run(shell, "x=lib; f() { printf '%s-' \"$@\"; }", NULL, NULL);
+    int second = minishell_run(shell, "echo $x; f a b\ncd /nonexistent", &out, &err);
+    int ok = first == 0 && second == 1 && minishell_status(shell) == 1 &&
+             strcmp(out_data, "lib\na-b-") == 0 && out.length == 8 &&
+             strstr(err_data, "cd: /nonexistent") != NULL;
+
+    /* Troncature comme snprintf ; exit ne termine que l'appel */
+    int third = minishell_run(shell, "echo truncated; exit 3", &small, NULL);
+    ok = ok && third == 3 && strcmp(small_data, "tru") == 0 && small.length == 10 &&
+         minishell_run(shell, "echo $x", &out, &err) == 0 && strcmp(out_data, "lib\n") == 0 &&
+         err.length == 0;
+
+    /* Les diagnostics du shell et le rapport de time vont aussi à err */
+    char report_data[512];
+    struct minishell_buffer report = { report_data, sizeof(report_data), 0 };
+    ok = ok && minishell_run(shell, "no_such_command_xyz; echo ${a-b-}", NULL, &report) == 1 &&
+         strstr(report_data, "no_such_command_xyz: command not found") &&
+         strstr(report_data, "bad substitution") &&
+         minishell_run(shell, "time -p true", NULL, &report) == 0 &&
+         strstr(report_data, "real ") &&
+         minishell_run(shell, "fi", NULL, &report) == 2 && strstr(report_data, "syntax error");
+
+    /* Les erreurs d'un étage en thread aussi, versées après le join */
+    ok = ok && minishell_run(shell, "set -o pipethreads; printf %d x | cat > /dev/null; "
+                             "printf %z | cat", NULL, &report) == 0 &&
+         strcmp(report_data, "printf: %z: invalid format character\n") == 0;
+
+    if (ok)
+    {
+        printf("%sTest Library API: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Library API: FAILED (out '%s', err '%s')%s\n", RED, out_data,
+               err_data, RESET);
+
+    minishell_free(shell);
+}
+
+/* Des shells indépendants dans des threads d'un même processus : chacun son
+ * répertoire, son environnement et ses redirections de commandes composées */
+#define CONCURRENT_SHELLS 16
+
+struct concurrent_shell {
+    int id;
+    char dir[64];
+    char expected[PATH_MAX + 64];
+    char output[PATH_MAX + 64];
+    int status;
+};
+
+static void *run_concurrent_shell(void *arg)
+{
+    struct concurrent_shell *job = arg;
+    struct minishell *shell = minishell_new(NULL);
+    struct minishell_buffer out = { job->output, sizeof(job->output), 0 };
+    char script[512];
+
+    snprintf(script, sizeof(script),
+             "cd %s && export ID=%d && i=0\n"
+             "while [ $i -lt 20 ]; do { echo $ID; pwd; } > out; env > env.txt; i=$((i + 1)); done\n"
+             "read a < out; grep '^ID=' env.txt > id.txt; read e < id.txt\n"
+             "pwd > p; read d < p; echo \"$a $e $d\"; echo *.txt\n",
+             job->dir, job->id);
+    job->status = shell ? minishell_run(shell, script, &out, NULL) : -1;
+    minishell_free(shell);
+    return NULL;
+}
+
+static void test_concurrent_states(void)
+{
+    test_count++;
+
+    struct concurrent_shell jobs[CONCURRENT_SHELLS];
+    pthread_t threads[CONCURRENT_SHELLS];
+    char before[1024];
+    char after[1024];
+    int ok = getcwd(before, sizeof(before)) != NULL;
+
+    for (int i = 0; i < CONCURRENT_SHELLS; i++)
+    {
+        char resolved[PATH_MAX];
+        jobs[i].id = i;
+        strcpy(jobs[i].dir, "/tmp/minishell_stateXXXXXX");
+        jobs[i].output[0] = '\0';
+        ok = ok && mkdtemp(jobs[i].dir) && realpath(jobs[i].dir, resolved);
+        snprintf(jobs[i].expected, sizeof(jobs[i].expected), "%d ID=%d %s\nenv.txt id.txt\n",
+                 i, i, ok ? resolved : "");
+    }
+    for (int i = 0; ok && i < CONCURRENT_SHELLS; i++)
+        pthread_create(&threads[i], NULL, run_concurrent_shell, &jobs[i]);
+
+    for (int i = 0; ok && i < CONCURRENT_SHELLS; i++)
+    {
+        pthread_join(threads[i], NULL);
+        if (jobs[i].status != 0 || strcmp(jobs[i].output, jobs[i].expected) != 0)
+        {
+            printf("Shell %d: status %d, got '%s'\n", i, jobs[i].status, jobs[i].output);
+            ok = 0;
+        }
+    }
+    for (int i = 0; i < CONCURRENT_SHELLS; i++)
+    {
+        const char *files[] = { "out", "env.txt", "id.txt", "p" };
+        char path[128];
+        for (size_t f = 0; f < sizeof(files) / sizeof(files[0]); f++)
+        {
+            snprintf(path, sizeof(path), "%s/%s", jobs[i].dir, files[f]);
+            unlink(path);
+        }
+        rmdir(jobs[i].dir);
+    }
+
+    /* cd dans les shells ne touche pas au répertoire du processus */
+    if (ok && getcwd(after, sizeof(after)) && strcmp(before, after) == 0)
+    {
+        printf("%sTest Concurrent states: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest Concurrent states: FAILED%s\n", RED, RESET);
+}
+
 static void test_builtins(void)
 {
     run_test("echo test builtin", "test builtin\n", "Echo builtin");
@@ -154,9 +756,25 @@ int main(void)
 
     test_echo();
     test_pipe();
+    test_pipe_threads();
     test_redirections();
     test_and_or();
     test_sequences();
+    test_expansion();
+    test_arith_cache();
+    test_function_frames();
+    test_lazy_init();
+    test_path_table();
+    test_stats();
+    test_trace();
+    test_profile();
+    test_time();
+    test_pipe_capacity();
+    test_pipe_placement();
+    test_process_substitution();
+    test_steady_state();
+    test_library();
+    test_concurrent_states();
     test_builtins();
 
     printf("\nTests summary: %d/%d passed\n", tests_passed, test_count);
@@ -104,6 +104,124 @@ void test_ionumber(void)
     lexer_free(lexer);
 }
 
+static void assert_flags(struct token *token, int expected, const char *test_name)
+{
+    test_count++;
+    if (token && token->flags == expected)
+    {
+        printf("%sTest %s: PASSED%s\n", GREEN, test_name, RESET);
+        tests_passed++;
+    }
+    else
+        printf("%sTest %s: FAILED - Expected flags %d, got %d%s\n", RED, test_name,
+               expected, token ? token->flags : -1, RESET);
+}
+
+void test_word_flags(void)
+{
+    struct lexer *lexer = lexer_init("*.c '*' \"$x\"? plain");
+    struct token *token;
+
+    token = lexer_next_token(lexer);
+    assert_flags(token, WORD_GLOB, "Flags - unquoted star");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_flags(token, WORD_QUOTED, "Flags - quoted star");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_flags(token, WORD_QUOTED | WORD_DOLLAR | WORD_GLOB, "Flags - mixed word");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_flags(token, 0, "Flags - plain word");
+    token_free(token);
+
+    lexer_free(lexer);
+}
+
+void test_heredoc_operators(void)
+{
+    struct lexer *lexer = lexer_init("cat <<EOF <<-END\n");
+    struct token *token;
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_WORD, "cat", "Heredoc - cat");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_OPERATOR, "<<", "Heredoc - <<");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_WORD, "EOF", "Heredoc - EOF");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_OPERATOR, "<<-", "Heredoc - <<-");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_WORD, "END", "Heredoc - END");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_NEWLINE, NULL, "Heredoc - newline");
+    token_free(token);
+
+    lexer_free(lexer);
+}
+
+void test_case_in_substitution(void)
+{
+    struct lexer *lexer = lexer_init("echo $(case a in (b) x;; a) y;; esac) next");
+    struct token *token;
+
+    token = lexer_next_token(lexer);
+    token_free(token);
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_WORD, "$(case a in (b) x;; a) y;; esac)",
+                 "Case in substitution - word");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_WORD, "next", "Case in substitution - next");
+    token_free(token);
+
+    lexer_free(lexer);
+}
+
+void test_process_substitution(void)
+{
+    struct lexer *lexer = lexer_init("diff <(sort a) >(cat -n \")\") < (x)");
+    struct token *token;
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_WORD, "diff", "Process substitution - diff");
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_WORD, "<(sort a)", "Process substitution - <(...)");
+    test_count++;
+    if (token && token->flags == WORD_PROCESS)
+        tests_passed++;
+    else
+        printf("%sTest Process substitution - flags: FAILED%s\n", RED, RESET);
+    token_free(token);
+
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_WORD, ">(cat -n \")\")", "Process substitution - >(...)");
+    token_free(token);
+
+    /* Séparé par un espace, '<' reste une redirection */
+    token = lexer_next_token(lexer);
+    assert_token(token, TOKEN_OPERATOR, "<", "Process substitution - redirection");
+    token_free(token);
+
+    lexer_free(lexer);
+}
+
 void test_complex_command(void)
 {
     struct lexer *lexer = lexer_init("echo hello > output.txt");
@@ -140,6 +258,10 @@ int main(void)
     test_assignment();
     test_operators();
     test_ionumber();
+    test_heredoc_operators();
+    test_word_flags();
+    test_case_in_substitution();
+    test_process_substitution();
     test_complex_command();
     
     printf("\nTests summary: %d/%d passed\n", tests_passed, test_count);
@@ -3,6 +3,7 @@
 #include <string.h>
 #include "../src/lexer/lexer.h"
 #include "../src/parser/parser.h"
+#include "../src/expand/case.h"
 
 #define GREEN "\033[0;32m"
 #define RED "\033[0;31m"
@@ -254,6 +255,89 @@ void test_complex_input(void)
     lexer_free(lexer);
 }
 
+void test_compound_commands(void)
+{
+    struct lexer *lexer = lexer_init("while true; do for x in a b; do echo $x; done; done > out");
+    struct parser *parser = parser_init(lexer);
+    struct ast_node *node = parse_input(parser);
+
+    test_count++;
+    if (node && node->type == NODE_WHILE &&
+        node->data.compound->condition->type == NODE_COMMAND &&
+        node->data.compound->body->type == NODE_FOR &&
+        strcmp(node->data.compound->body->data.compound->variable, "x") == 0 &&
+        node->data.compound->body->data.compound->command->args_count == 2 &&
+        node->data.compound->command->redirections_count == 1)
+    {
+        printf("%sTest Compound commands: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+    {
+        printf("%sTest Compound commands: FAILED%s\n", RED, RESET);
+    }
+
+    ast_node_free(node);
+    parser_free(parser);
+    lexer_free(lexer);
+}
+
+void test_case_patterns(void)
+{
+    struct lexer *lexer = lexer_init("case $x in a|b) echo ab;; c*) ;; \"$y\") echo y;; esac");
+    struct parser *parser = parser_init(lexer);
+    struct ast_node *node = parse_input(parser);
+
+    test_count++;
+    /* Deux littéraux hachés, un motif glob, un motif gardé pour l'exécution */
+    if (node && node->type == NODE_CASE && node->data.compound->arm_count == 3 &&
+        node->data.compound->arms[1] == NULL &&
+        node->data.compound->matcher->count == 4 &&
+        node->data.compound->matcher->others_count == 2 &&
+        node->data.compound->command->args_count == 2)
+    {
+        printf("%sTest Case patterns: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+    {
+        printf("%sTest Case patterns: FAILED%s\n", RED, RESET);
+    }
+
+    ast_node_free(node);
+    parser_free(parser);
+    lexer_free(lexer);
+}
+
+void test_time_pipeline(void)
+{
+    struct lexer *lexer = lexer_init("time -j ! a | b; echo time");
+    struct parser *parser = parser_init(lexer);
+    struct ast_node *node = parse_input(parser);
+
+    test_count++;
+    /* time englobe ! et tout le pipeline ; ailleurs, c'est un mot ordinaire */
+    if (node && node->type == NODE_SEQUENCE &&
+        node->data.binary.left->type == NODE_TIME &&
+        strcmp(node->data.binary.left->data.binary.operator, "-j") == 0 &&
+        node->data.binary.left->data.binary.left->type == NODE_NOT &&
+        node->data.binary.left->data.binary.left->data.binary.left->type == NODE_PIPELINE &&
+        node->data.binary.right->type == NODE_COMMAND &&
+        strcmp(node->data.binary.right->data.command->args[1], "time") == 0)
+    {
+        printf("%sTest Time pipeline: PASSED%s\n", GREEN, RESET);
+        tests_passed++;
+    }
+    else
+    {
+        printf("%sTest Time pipeline: FAILED%s\n", RED, RESET);
+    }
+
+    ast_node_free(node);
+    parser_free(parser);
+    lexer_free(lexer);
+}
+
 int main(void)
 {
     printf("Running parser tests...\n\n");
@@ -265,6 +349,9 @@ int main(void)
     test_and_or();
     test_command_sequence();
     test_complex_input();
+    test_compound_commands();
+    test_case_patterns();
+    test_time_pipeline();
 
     printf("\nTests summary: %d/%d passed\n", tests_passed, test_count);
     return tests_passed == test_count ? 0 : 1;
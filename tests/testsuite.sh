@@ -20,10 +20,13 @@ setup() {
     cleanup
 }
 
-# Fonction pour comparer la sortie du minishell avec celle de bash --posix
+# Fonction pour comparer la sortie du minishell avec celle de bash --posix.
+# Avec un troisième argument "-c", la commande est passée par -c au lieu de
+# l'entrée standard, suivie de $0 et des paramètres donnés en plus.
 test_command() {
     local test_name="$1"
     local command="$2"
+    local mode="$3"
     
     setup
 
@@ -32,13 +35,18 @@ test_command() {
         echo "test content" > input.txt
     fi
     
-    # Exécuter la commande avec bash --posix
-    echo "$command" | bash --posix > bash_output 2>bash_error
-    local bash_status=$?
-    
-    # Exécuter la commande avec minishell
-    echo "$command" | ./minishell > minishell_output 2>minishell_error
-    local minishell_status=$?
+    # Exécuter la commande avec bash --posix puis avec minishell
+    if [ "$mode" = "-c" ]; then
+        bash --posix -c "$command" "${@:4}" > bash_output 2>bash_error
+        local bash_status=$?
+        ./minishell -c "$command" "${@:4}" > minishell_output 2>minishell_error
+        local minishell_status=$?
+    else
+        echo "$command" | bash --posix > bash_output 2>bash_error
+        local bash_status=$?
+        echo "$command" | ./minishell > minishell_output 2>minishell_error
+        local minishell_status=$?
+    fi
     
     # Comparer les sorties et les statuts
     if diff bash_output minishell_output >/dev/null && 
@@ -80,10 +88,27 @@ test_command "Simple input redirection" "echo sample > input.txt && cat < input.
 test_command "Simple append redirection" "echo first > test.txt && echo second >> test.txt && cat test.txt"
 test_command "Simple error redirection" "ls nonexistentfile 2> error.txt"
 
+# Test des here-documents
+echo -e "\nTesting here-documents..."
+test_command "Simple here-document" $'cat <<EOF\nhello\n  world\nEOF'
+test_command "Here-document with tabs stripped" $'cat <<-EOF\n\thello\n\tEOF'
+test_command "Here-document in pipe" $'cat <<EOF | tr a-z A-Z\nhello\nEOF\necho done'
+test_command "Two here-documents" $'cat <<A <<B\nfirst\nA\nsecond\nB'
+test_command "Large here-document" "wc -c <<EOF
+$(yes 0123456789abcdef | head -n 4096)
+EOF"
+
 # Test des pipes simples
 echo -e "\nTesting pipes..."
 test_command "Simple pipe" "echo hello | cat"
 test_command "Simple grep pipe" "echo hello | grep hello"
+test_command "Three stage pipe" "echo hello | cat | tr a-z A-Z"
+test_command "Pipe capacity" "PIPESIZE=1m; seq 1 20000 | cat | tail -n 1; PIPESIZE=bad; echo x | cat"
+test_command "Pipe placement" "PIPECPUS=cache; seq 1 5 | cat | tail -n 1; PIPECPUS=0:bad; echo x | tr x y"
+test_command "Process substitution input" "diff <(printf 'a\\nb\\n') <(printf 'a\\nc\\n'); echo \$?; while read l; do echo got \$l; done < <(seq 3)"
+test_command "Process substitution reader exits" "head -n 1 <(yes); cat <(echo \$((1 + 2)))"
+test_command "Pipe status from last stage" "true | false"
+
 
 # Test des opérateurs logiques simples
 echo -e "\nTesting logical operators..."
@@ -96,9 +121,186 @@ test_command "Simple OR skip" "true || echo nope"
 echo -e "\nTesting command sequences..."
 test_command "Two command sequence" "echo a ; echo b"
 
+# Test des quotes et des substitutions de commandes
+echo -e "\nTesting quoting and command substitution..."
+test_command "Single and double quotes" "echo 'a  b' \"c  d\" e\\ f"
+test_command "Comments" $'# it\'s a comment\necho a#b \'#c\' # d\necho e'
+test_command "Builtin substitution" "echo x\$(echo hello)y"
+test_command "Printf substitution" "echo \$(printf '%s-%d ' a 1 b 2)"
+test_command "Pwd substitution" "cd /tmp && echo \"\$(pwd)\""
+test_command "External substitution" "echo \$(echo one two | tr a-z A-Z)"
+test_command "Quoted substitution keeps spaces" "echo \"\$(printf 'a  b\\n\\n')\"end"
+test_command "Nested substitution" "echo \"x \$(echo \"y \$(echo z)\")\""
+test_command "Case in substitution" "echo \$(case a in a) echo yes;; esac); x=\$(case b in (a) echo A;; (b) echo B;; esac); echo \$x"
+test_command "Assignment status from substitution" "x=\$(false); echo \$?; x=\$(exit 3); echo \$?; false; x=1; echo \$?"
+test_command "Assignment status in condition" "if v=\$(false); then echo yes; else echo no; fi; if v=\$(true); then echo yes; fi"
+test_command "Substitution status" "echo \$(false) && echo ok"
+test_command "Substitution assignments stay local" "x=1; y=\$(echo \$((x=5)) \$((x+=1))); echo x=\$x y=\$y; y=\$(echo src/lexer/*.h); echo \$y"
+
+# Test du développement des chemins
+echo -e "\nTesting pathname expansion..."
+test_command "Star in directory" "echo src/lexer/*"
+test_command "Several components" "echo src/*/*.h"
+test_command "Bracket and question mark" "echo src/lexer/lexer.[ch] src/ma?n.c src/[!e]*/"
+test_command "Quoted pattern is literal" "echo 'src/*' \"src/*\" src/\\*"
+test_command "No match keeps the word" "echo src/nomatch*"
+test_command "Pattern from a variable" "p='src/*.h'; echo \$p \"\$p\""
+
 # Test des variables d'environnement
 echo -e "\nTesting environment variables..."
 test_command "Print env variable" "FOO=bar env | grep FOO"
+test_command "Home variable" "echo \$HOME"
+test_command "Braced variable" "x=abc; echo \${x}def"
+test_command "Last status" "false; echo \$?; true; echo \$?"
+test_command "Unset variable" "x=1; unset x; echo [\$x]"
+test_command "Field splitting" "x='a   b'; echo \$x; echo \"\$x\""
+test_command "Split on non-whitespace IFS" "IFS=:; x=a::b; printf '[%s]' \$x; echo; x=:a; printf '[%s]' \$x; echo; x=a:; printf '[%s]' \$x; echo; IFS=' :'; x=' :b'; printf '[%s]' \$x; echo; x='a : b'; printf '[%s]' \$x; echo"
+test_command "Export variable" "export FOO=baz; env | grep ^FOO="
+test_command "Prefix assignment is temporary" "FOO=tmp true; echo [\$FOO]"
+test_command "Arithmetic precedence" "echo \$((1+2*3)) \$(( (1+2)*3 )) \$((-7%3)) \$((1<<4)) \$((0x10 + 010))"
+test_command "Arithmetic assignment" "x=5; echo \$((x*2)) \$((x+=3)) \$((x++)) \$((++x)) \$x"
+test_command "Arithmetic logic" "echo \$((1 ? 2 : 3)) \$((0 || 5)) \$((!0)) \$((~0)) \$((6 ^ 3)) \$((2 >= 3))"
+test_command "Arithmetic short-circuit" "a=1; echo \$((0 && (a=5))) \$a"
+test_command "Arithmetic with parameters" "y=4; echo \$(( \$y * \$y )) \"\$((y, y+1))\""
+test_command "Heredoc expansion" "x=v; cat <<EOF
+\$x \\\$x '\$x'
+EOF"
+
+# Test des commandes composées
+echo -e "\nTesting compound commands..."
+test_command "If elif else" "x=2; if [ \$x -eq 1 ]; then echo one; elif [ \$x -eq 2 ]; then echo two; else echo other; fi"
+test_command "While counter" "i=0; while [ \$i -lt 5 ]; do i=\$((i+1)); echo \$i; done"
+test_command "Until loop" "i=3; until [ \$i -eq 0 ]; do echo \$i; i=\$((i-1)); done"
+test_command "For over words" "for x in a 'b c' d; do echo \$x; done"
+test_command "For over a pattern" "for f in src/lexer/*; do echo \$f; done"
+test_command "Break and continue" "for i in 1 2 3; do for j in 1 2 3; do if [ \$j = 2 ]; then continue 2; fi; if [ \$i = 3 ]; then break 2; fi; echo \$i\$j; done; done"
+test_command "Loop redirection" "for x in a b; do echo \$x; done > test_out.txt; while [ -s test_out.txt ]; do cat; break; done < test_out.txt"
+test_command "Multi-line if" "if true
+then
+    echo yes
+fi"
+test_command "Negation and test" "! false && [ ! -d /nonexistent ] && test abc != abd; echo \$?"
+test_command "Loop status" "while false; do :; done; echo \$?; if false; then :; fi; echo \$?"
+
+# Test de case
+echo -e "\nTesting case..."
+test_command "Case literal and alternatives" "for w in apple banana kiwi; do case \$w in apple|banana) echo fruit \$w;; *) echo other \$w;; esac; done"
+test_command "Case prefix, suffix and class" "for w in cherry a/b.c A1 x.txt; do case \$w in ch*) echo prefix;; *.c) echo suffix;; [A-Z][0-9]) echo class;; *.t?t) echo glob;; esac; done"
+test_command "Case quoted patterns" "for w in '*' 'x y' ''; do case \$w in \\*) echo star;; \"x y\") echo space;; '') echo empty;; esac; done"
+test_command "Case dynamic patterns" "p=ba; s='*'; case banana in \$p*) echo a;; esac; case abc in \"a\$s\") echo b;; a\$s) echo c;; esac"
+test_command "Case status and layout" "case y in x) echo no;; esac; echo \$?
+case x in
+    (x) false
+    ;;
+esac
+echo \$?"
+
+# Test des fonctions
+echo -e "\nTesting functions..."
+test_command "Function definition and call" "greet() { echo \"hello \$1, \$# args\"; }; greet world a b"
+test_command "Local variables and return" "f() { local x=inner; echo \$x; return 3; }; x=outer; f; echo \$? \$x"
+test_command "Positional parameters" "f() { echo \"\$@\"; shift; for a; do echo \"<\$a>\"; done; }; f 1 '2 3' '' 4"
+test_command "Quoted at and star" "c() { echo \$#; }; f() { c \"\$@\"; c \"\$*\"; c \$@; }; f a 'b c'; f"
+test_command "Recursive function" "fact() { if [ \$1 -le 1 ]; then echo 1; else echo \$(( \$1 * \$(fact \$(( \$1 - 1 ))) )); fi; }; fact 10"
+test_command "Return from a loop" "f() { for i in 1 2 3; do if [ \$i = 2 ]; then return 7; fi; echo \$i; done; }; f; echo \$?"
+test_command "Redefinition and unset" "f() { echo one; }; f; f() { echo two; }; f; unset -f f; echo done"
+test_command "Function with redirection" "f() { echo to file; } > test_out.txt; f; cat test_out.txt"
+test_command "Prefix assignment on a call" "f() { echo \$V; }; V=tmp f; echo [\$V]"
+
+# Test du builtin read
+echo -e "\nTesting read..."
+test_command "Read lines from a file" "printf 'one\\n  two  \\na\\\\tb\\n' > test.txt; while read line; do echo \"[\$line]\"; done < test.txt"
+test_command "Read raw and split" "printf 'a b c\\nd\\\\e f\\n' > test.txt; while read -r x y; do echo \"<\$x|\$y>\"; done < test.txt"
+test_command "Read leaves the rest of the file" "printf '1\\n2\\n3\\n4\\n' > test.txt; { read a; read b; cat; } < test.txt; echo \$a\$b"
+test_command "Read with IFS" "echo 'a:b:c:d' > test.txt; IFS=: read x y < test.txt; echo \"\$x \$y\"; printf 'x,  y ,z\\n' | { IFS=', ' read m n o; echo \"[\$m][\$n][\$o]\"; }"
+test_command "Read from a pipe" "printf 'a b\\nc d\\nlast' | while read u v; do echo \"\$v \$u\"; done"
+test_command "Read status at end of input" "read z < /dev/null; echo \$? [\$z]; echo '  kept  ' | { read; echo \"[\$REPLY]\"; }"
+
+# Test des modes d'entrée
+echo -e "\nTesting input modes..."
+test_command "Command string" "echo one; echo two" -c
+test_command "Command string arguments" "echo \"\$0 \$# \$1\"; for a; do echo \"<\$a>\"; done" -c name 'a b' c
+test_command "Command string status" "false || exit 3" -c
+test_command "Multi-line constructs on stdin" "for i in 1 2
+do
+    if [ \$i = 2 ]
+    then
+        echo two
+    fi
+done
+cat <<EOF
+body
+EOF
+echo after"
+
+# Le "fi" arrive plus tard, seul sur sa ligne : la commande doit
+# s'exécuter dès son arrivée, avant la suite de l'entrée
+delayed_input() {
+    printf 'if true; then\n    echo ran > test.txt\n'
+    sleep 0.2
+    echo fi
+    for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20; do
+        [ -f test.txt ] && break
+        sleep 0.1
+    done
+    if [ -f test.txt ]; then echo 'echo early'; else echo 'echo late'; fi
+}
+setup
+if [ "$(delayed_input | ./minishell)" = early ]; then
+    echo -e "${GREEN}[OK]${NC} Delayed closing keyword"
+    ((TESTS_PASSED++))
+else
+    echo -e "${RED}[KO]${NC} Delayed closing keyword"
+    ((TESTS_FAILED++))
+fi
+
+# Test du mode serveur : la commande passe par tests/client et doit donner
+# la même sortie et le même statut que bash --posix -c
+echo -e "\nTesting server mode..."
+SERVER_SOCKET="$(mktemp -u /tmp/minishell_test.XXXXXX)"
+./minishell --server "$SERVER_SOCKET" &
+SERVER_PID=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S "$SERVER_SOCKET" ] && break
+    sleep 0.1
+done
+
+test_server() {
+    local test_name="$1"
+    local command="$2"
+
+    setup
+    bash --posix -c "$command" > bash_output 2>bash_error < /dev/null
+    local bash_status=$?
+    ./tests/client "$SERVER_SOCKET" "$command" > minishell_output 2>minishell_error < /dev/null
+    local minishell_status=$?
+
+    if diff bash_output minishell_output >/dev/null &&
+       diff bash_error minishell_error >/dev/null &&
+       [ $bash_status -eq $minishell_status ]; then
+        echo -e "${GREEN}[OK]${NC} $test_name"
+        ((TESTS_PASSED++))
+    else
+        echo -e "${RED}[KO]${NC} $test_name"
+        echo "Command: $command"
+        echo "Expected status: $bash_status"
+        echo "Got status: $minishell_status"
+        ((TESTS_FAILED++))
+    fi
+}
+
+test_server "Server command" "echo served | tr a-z A-Z; false || exit 4"
+test_server "Server requests are isolated" "cd /tmp; x=1; f() { echo \$x; }; f"
+test_server "Server state does not leak" "echo [\$x] \$(pwd)"
+if ./tests/client -s "$SERVER_SOCKET" | grep -q '"requests": 3'; then
+    echo -e "${GREEN}[OK]${NC} Server stats"
+    ((TESTS_PASSED++))
+else
+    echo -e "${RED}[KO]${NC} Server stats"
+    ((TESTS_FAILED++))
+fi
+kill $SERVER_PID
+wait $SERVER_PID 2>/dev/null
 
 # Test des built-ins
 echo -e "\nTesting built-ins..."